@@ -15,31 +15,108 @@
 #include "db.h"
 #include "core_workload.h"
 #include "utils/countdown_latch.h"
+#include "utils/op_counter.h"
+#include "utils/open_loop.h"
 #include "utils/rate_limit.h"
 #include "utils/utils.h"
 
 namespace ycsbc {
 
-inline int ClientThread(ycsbc::DB *db, ycsbc::CoreWorkload *wl, const int num_ops, bool is_loading,
-                        bool init_db, bool cleanup_db, utils::CountDownLatch *latch, utils::RateLimiter *rlim) {
+// Keeps up to outstanding operations in flight through the asynchronous
+// calls of db, starting a new one whenever one completes, until work has no
+// operations left. Under an open-loop schedule or a rate limit it polls until
+// the next operation is due rather than sleeping, so waiting on it is not
+// charged to operations in flight. An open-loop operation that finds
+// outstanding in flight when due is late, which its response time shows.
+inline int AsyncClientLoop(ycsbc::DB *db, ycsbc::CoreWorkload *wl, utils::OpCounter *work,
+                           bool is_loading, int outstanding, utils::RateLimiter *rlim,
+                           utils::OpenLoopScheduler *sched) {
+  int ops = 0;
+  int in_flight = 0;
+  auto done = [&ops, &in_flight](bool) {
+    in_flight--;
+    ops++;
+  };
+  bool more = true;  // work may have operations left
+  bool claimed = false;  // an operation is claimed but not started
+  utils::OpenLoopScheduler::Clock::time_point due;  // when the claimed operation may start
+  while (more || in_flight > 0) {
+    bool early = false;  // the claimed operation is not due yet
+    while (in_flight < outstanding) {
+      if (!claimed) {
+        more = more && work->Claim();
+        if (!more) {
+          break;
+        }
+        claimed = true;
+        if (sched) {
+          due = sched->Next();
+        } else if (rlim) {
+          due = rlim->Reserve(1);
+        }
+      }
+      if (sched || rlim) {
+        if (in_flight > 0 && due > utils::OpenLoopScheduler::Clock::now()) {
+          early = true;
+          break;
+        }
+        utils::OpenLoopScheduler::WaitUntil(due);
+        if (sched) {
+          db->SetIntendedStart(due);
+        }
+      }
+      claimed = false;
+      in_flight++;
+      if (is_loading) {
+        wl->DoInsertAsync(*db, done);
+      } else {
+        wl->DoTransactionAsync(*db, done);
+      }
+    }
+    if (early) {
+      db->PollUntil(due);
+    } else if (in_flight > 0) {
+      db->Poll();
+    }
+  }
+  return ops;
+}
+
+// Runs operations claimed from work, which the phase's client threads share,
+// and returns how many it ran. Counts ready down once db is initialized and
+// waits for start before the first operation.
+inline int ClientThread(ycsbc::DB *db, ycsbc::CoreWorkload *wl, utils::OpCounter *work, bool is_loading,
+                        bool init_db, bool cleanup_db, utils::CountDownLatch *ready,
+                        utils::CountDownLatch *start, utils::CountDownLatch *latch,
+                        utils::RateLimiter *rlim, utils::OpenLoopScheduler *sched, int outstanding) {
 
   try {
     if (init_db) {
       db->Init();
     }
+    ready->CountDown();
+    start->Await();
 
     int ops = 0;
-    for (int i = 0; i < num_ops; ++i) {
-      if (rlim) {
-        rlim->Consume(1);
-      }
+    if (outstanding > 1) {
+      ops = AsyncClientLoop(db, wl, work, is_loading, outstanding, rlim, sched);
+    } else {
+      while (work->Claim()) {
+        if (sched) {
+          utils::OpenLoopScheduler::Clock::time_point intended_start = sched->Next();
+          utils::OpenLoopScheduler::WaitUntil(intended_start);
+          db->SetIntendedStart(intended_start);
+        } else if (rlim) {
+          rlim->Consume(1);
+        }
 
-      if (is_loading) {
-        wl->DoInsert(*db);
-      } else {
-        wl->DoTransaction(*db);
+        if (is_loading) {
+          wl->DoInsert(*db);
+        } else {
+          wl->DoTransaction(*db);
+        }
+        ops++;
       }
-      ops++;
     }
 
     if (cleanup_db) {
@@ -17,6 +17,7 @@
 #include "utils/utils.h"
 
 #include <algorithm>
+#include <memory>
 #include <random>
 #include <string>
 
@@ -287,6 +288,75 @@ bool CoreWorkload::DoTransaction(DB &db) {
   return (status == DB::kOK);
 }
 
+namespace {
+
+// Arguments of an asynchronous operation, kept alive by its callback.
+struct AsyncOp {
+  std::string key;
+  std::vector<std::string> fields;
+  std::vector<ycsbc::DB::Field> values;
+  std::vector<ycsbc::DB::Field> result;
+  std::vector<std::vector<ycsbc::DB::Field>> scan_result;
+};
+
+} // namespace
+
+void CoreWorkload::DoInsertAsync(DB &db, std::function<void(bool)> done) {
+  auto op = std::make_shared<AsyncOp>();
+  op->key = BuildKeyName(insert_key_sequence_->Next());
+  BuildValues(op->values);
+  db.InsertAsync(table_name_, op->key, op->values,
+                 [op, done](DB::Status s) { done(s == DB::kOK); });
+}
+
+void CoreWorkload::DoTransactionAsync(DB &db, std::function<void(bool)> done) {
+  auto op = std::make_shared<AsyncOp>();
+  auto finish = [op, done](DB::Status s) { done(s == DB::kOK); };
+  Operation operation = op_chooser_.Next();
+  if (operation == INSERT) {
+    uint64_t key_num = transaction_insert_key_sequence_->Next();
+    op->key = BuildKeyName(key_num);
+    BuildValues(op->values);
+    db.InsertAsync(table_name_, op->key, op->values, [this, key_num, finish](DB::Status s) {
+      transaction_insert_key_sequence_->Acknowledge(key_num);
+      finish(s);
+    });
+    return;
+  }
+  op->key = BuildKeyName(NextTransactionKeyNum());
+  const std::vector<std::string> *fields = nullptr;
+  if (!read_all_fields() && operation != UPDATE) {
+    op->fields.push_back(NextFieldName());
+    fields = &op->fields;
+  }
+  if (operation == UPDATE || operation == READMODIFYWRITE) {
+    if (write_all_fields()) {
+      BuildValues(op->values);
+    } else {
+      BuildSingleValue(op->values);
+    }
+  }
+  switch (operation) {
+    case READ:
+      db.ReadAsync(table_name_, op->key, fields, op->result, finish);
+      break;
+    case UPDATE:
+      db.UpdateAsync(table_name_, op->key, op->values, finish);
+      break;
+    case SCAN:
+      db.ScanAsync(table_name_, op->key, scan_len_chooser_->Next(), fields, op->scan_result,
+                   finish);
+      break;
+    case READMODIFYWRITE:
+      db.ReadAsync(table_name_, op->key, fields, op->result, [this, &db, op, finish](DB::Status) {
+        db.UpdateAsync(table_name_, op->key, op->values, finish);
+      });
+      break;
+    default:
+      throw utils::Exception("Operation request is not recognized!");
+  }
+}
+
 DB::Status CoreWorkload::TransactionRead(DB &db) {
   uint64_t key_num = NextTransactionKeyNum();
   const std::string key = BuildKeyName(key_num);
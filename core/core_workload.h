@@ -10,6 +10,7 @@
 #ifndef YCSB_C_CORE_WORKLOAD_H_
 #define YCSB_C_CORE_WORKLOAD_H_
 
+#include <functional>
 #include <vector>
 #include <string>
 #include "db.h"
@@ -177,6 +178,15 @@ class CoreWorkload {
   virtual bool DoInsert(DB &db);
   virtual bool DoTransaction(DB &db);
 
+  ///
+  /// Asynchronous counterparts of DoInsert and DoTransaction: start one
+  /// operation through the asynchronous calls of db, and call done with
+  /// whether it succeeded once it has completed. A read-modify-write issues
+  /// its update from the completion of its read.
+  ///
+  virtual void DoInsertAsync(DB &db, std::function<void(bool)> done);
+  virtual void DoTransactionAsync(DB &db, std::function<void(bool)> done);
+
   bool read_all_fields() const { return read_all_fields_; }
   bool write_all_fields() const { return write_all_fields_; }
 
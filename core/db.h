@@ -11,6 +11,8 @@
 
 #include "utils/properties.h"
 
+#include <chrono>
+#include <functional>
 #include <vector>
 #include <string>
 
@@ -100,6 +102,67 @@ class DB {
   ///
   virtual Status Delete(const std::string &table, const std::string &key) = 0;
 
+  ///
+  /// Receives the status of an asynchronous operation.
+  ///
+  typedef std::function<void(Status)> Callback;
+  ///
+  /// Whether the asynchronous operations below run in the background, so that
+  /// one thread can keep several of them in flight.
+  ///
+  virtual bool SupportsAsync() { return false; }
+  ///
+  /// Asynchronous counterparts of the operations above. Each starts the
+  /// operation and returns; the callback runs on the calling thread, either
+  /// before the call returns or from a later Poll. The arguments must stay
+  /// valid until then. The defaults run the operation synchronously.
+  ///
+  virtual void ReadAsync(const std::string &table, const std::string &key,
+                         const std::vector<std::string> *fields,
+                         std::vector<Field> &result, Callback callback) {
+    callback(Read(table, key, fields, result));
+  }
+  virtual void ScanAsync(const std::string &table, const std::string &key,
+                         int record_count, const std::vector<std::string> *fields,
+                         std::vector<std::vector<Field>> &result, Callback callback) {
+    callback(Scan(table, key, record_count, fields, result));
+  }
+  virtual void UpdateAsync(const std::string &table, const std::string &key,
+                           std::vector<Field> &values, Callback callback) {
+    callback(Update(table, key, values));
+  }
+  virtual void InsertAsync(const std::string &table, const std::string &key,
+                           std::vector<Field> &values, Callback callback) {
+    callback(Insert(table, key, values));
+  }
+  virtual void DeleteAsync(const std::string &table, const std::string &key,
+                           Callback callback) {
+    callback(Delete(table, key));
+  }
+  ///
+  /// Runs the callbacks of completed asynchronous operations, waiting for at
+  /// least one if operations are in flight but none has completed yet.
+  ///
+  virtual void Poll() { }
+  ///
+  /// Like Poll, but returns by the deadline even if nothing has completed.
+  /// Bindings whose Poll waits override it; the default just runs Poll.
+  ///
+  virtual void PollUntil(std::chrono::steady_clock::time_point) { Poll(); }
+  ///
+  /// Sets when the next operation was meant to start under an open-loop
+  /// schedule, so that its response time counts from then rather than from
+  /// when it actually started. Later operations count from their own start.
+  ///
+  virtual void SetIntendedStart(std::chrono::steady_clock::time_point) { }
+  ///
+  /// Reports statistics of the database itself, appended to the periodic
+  /// status output.
+  ///
+  /// @return The statistics, or an empty string if there are none.
+  ///
+  virtual std::string GetStatusMsg() { return ""; }
+
   virtual ~DB() { }
 
   void SetProps(utils::Properties *props) {
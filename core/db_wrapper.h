@@ -8,6 +8,9 @@
 #ifndef YCSB_C_DB_WRAPPER_H_
 #define YCSB_C_DB_WRAPPER_H_
 
+#include <algorithm>
+#include <chrono>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -20,7 +23,9 @@ namespace ycsbc {
 
 class DBWrapper : public DB {
  public:
-  DBWrapper(DB *db, Measurements *measurements) : db_(db), measurements_(measurements) {}
+  DBWrapper(DB *db, Measurements *measurements, LatencyInterval interval, LatencyClock clock)
+      : db_(db), measurements_(measurements), interval_(interval),
+        timer_(clock == LatencyClock::TSC && utils::Tsc::Available()) {}
   ~DBWrapper() {
     delete db_;
   }
@@ -32,65 +37,134 @@ class DBWrapper : public DB {
   }
   Status Read(const std::string &table, const std::string &key,
               const std::vector<std::string> *fields, std::vector<Field> &result) {
+    std::optional<Clock::time_point> intended_start = TakeIntendedStart();
     timer_.Start();
     Status s = db_->Read(table, key, fields, result);
     uint64_t elapsed = timer_.End();
-    if (s == kOK) {
-      measurements_->Report(READ, elapsed);
-    } else {
-      measurements_->Report(READ_FAILED, elapsed);
-    }
+    Report(s == kOK ? READ : READ_FAILED, elapsed, intended_start);
     return s;
   }
   Status Scan(const std::string &table, const std::string &key, int record_count,
               const std::vector<std::string> *fields, std::vector<std::vector<Field>> &result) {
+    std::optional<Clock::time_point> intended_start = TakeIntendedStart();
     timer_.Start();
     Status s = db_->Scan(table, key, record_count, fields, result);
     uint64_t elapsed = timer_.End();
-    if (s == kOK) {
-      measurements_->Report(SCAN, elapsed);
-    } else {
-      measurements_->Report(SCAN_FAILED, elapsed);
-    }
+    Report(s == kOK ? SCAN : SCAN_FAILED, elapsed, intended_start);
     return s;
   }
   Status Update(const std::string &table, const std::string &key, std::vector<Field> &values) {
+    std::optional<Clock::time_point> intended_start = TakeIntendedStart();
     timer_.Start();
     Status s = db_->Update(table, key, values);
     uint64_t elapsed = timer_.End();
-    if (s == kOK) {
-      measurements_->Report(UPDATE, elapsed);
-    } else {
-      measurements_->Report(UPDATE_FAILED, elapsed);
-    }
+    Report(s == kOK ? UPDATE : UPDATE_FAILED, elapsed, intended_start);
     return s;
   }
   Status Insert(const std::string &table, const std::string &key, std::vector<Field> &values) {
+    std::optional<Clock::time_point> intended_start = TakeIntendedStart();
     timer_.Start();
     Status s = db_->Insert(table, key, values);
     uint64_t elapsed = timer_.End();
-    if (s == kOK) {
-      measurements_->Report(INSERT, elapsed);
-    } else {
-      measurements_->Report(INSERT_FAILED, elapsed);
-    }
+    Report(s == kOK ? INSERT : INSERT_FAILED, elapsed, intended_start);
     return s;
   }
   Status Delete(const std::string &table, const std::string &key) {
+    std::optional<Clock::time_point> intended_start = TakeIntendedStart();
     timer_.Start();
     Status s = db_->Delete(table, key);
     uint64_t elapsed = timer_.End();
-    if (s == kOK) {
-      measurements_->Report(DELETE, elapsed);
-    } else {
-      measurements_->Report(DELETE_FAILED, elapsed);
-    }
+    Report(s == kOK ? DELETE : DELETE_FAILED, elapsed, intended_start);
     return s;
   }
+  bool SupportsAsync() {
+    return db_->SupportsAsync();
+  }
+  void ReadAsync(const std::string &table, const std::string &key,
+                 const std::vector<std::string> *fields, std::vector<Field> &result,
+                 Callback callback) {
+    db_->ReadAsync(table, key, fields, result, Measured(READ, READ_FAILED, std::move(callback)));
+  }
+  void ScanAsync(const std::string &table, const std::string &key, int record_count,
+                 const std::vector<std::string> *fields, std::vector<std::vector<Field>> &result,
+                 Callback callback) {
+    db_->ScanAsync(table, key, record_count, fields, result,
+                   Measured(SCAN, SCAN_FAILED, std::move(callback)));
+  }
+  void UpdateAsync(const std::string &table, const std::string &key, std::vector<Field> &values,
+                   Callback callback) {
+    db_->UpdateAsync(table, key, values, Measured(UPDATE, UPDATE_FAILED, std::move(callback)));
+  }
+  void InsertAsync(const std::string &table, const std::string &key, std::vector<Field> &values,
+                   Callback callback) {
+    db_->InsertAsync(table, key, values, Measured(INSERT, INSERT_FAILED, std::move(callback)));
+  }
+  void DeleteAsync(const std::string &table, const std::string &key, Callback callback) {
+    db_->DeleteAsync(table, key, Measured(DELETE, DELETE_FAILED, std::move(callback)));
+  }
+  void Poll() {
+    db_->Poll();
+  }
+  void PollUntil(std::chrono::steady_clock::time_point deadline) {
+    db_->PollUntil(deadline);
+  }
+  void SetIntendedStart(std::chrono::steady_clock::time_point intended_start) {
+    intended_start_ = intended_start;
+  }
+  std::string GetStatusMsg() {
+    return db_->GetStatusMsg();
+  }
  private:
+  using Clock = std::chrono::steady_clock;
+
   DB *db_;
   Measurements *measurements_;
-  utils::Timer<uint64_t, std::nano> timer_;
+  LatencyInterval interval_;
+  utils::LatencyTimer timer_;
+  // of the next operation only
+  std::optional<Clock::time_point> intended_start_;
+
+  std::optional<Clock::time_point> TakeIntendedStart() {
+    std::optional<Clock::time_point> intended_start;
+    intended_start.swap(intended_start_);
+    return intended_start;
+  }
+
+  // Reports the service time of an operation that just completed, its
+  // response time from intended_start instead or as well, per interval_.
+  // Without an intended start the two are the same.
+  void Report(Operation op, uint64_t elapsed, std::optional<Clock::time_point> intended_start) {
+    uint64_t response = elapsed;
+    if (intended_start && interval_ != LatencyInterval::OP) {
+      auto since = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - *intended_start);
+      response = std::max<uint64_t>(elapsed, since.count());
+    }
+    switch (interval_) {
+      case LatencyInterval::OP:
+        measurements_->Report(op, elapsed);
+        break;
+      case LatencyInterval::INTENDED:
+        measurements_->Report(op, response);
+        break;
+      case LatencyInterval::BOTH:
+        measurements_->Report(op, elapsed);
+        measurements_->ReportIntended(op, response);
+        break;
+    }
+  }
+
+  // Wraps callback to report the latency of an asynchronous operation, from
+  // its start until its completion is delivered.
+  Callback Measured(Operation op, Operation failed_op, Callback callback) {
+    std::optional<Clock::time_point> intended_start = TakeIntendedStart();
+    utils::LatencyTimer timer = timer_;
+    timer.Start();
+    return [=](Status s) mutable {
+      uint64_t elapsed = timer.End();
+      Report(s == kOK ? op : failed_op, elapsed, intended_start);
+      callback(s);
+    };
+  }
 };
 
 } // ycsbc
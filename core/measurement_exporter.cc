@@ -0,0 +1,182 @@
+//
+//  measurement_exporter.cc
+//  YCSB-cpp
+//
+
+#include "measurement_exporter.h"
+#include "utils/utils.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+  const std::string EXPORT_FORMAT = "measurement.export";
+  const std::string EXPORT_FORMAT_DEFAULT = "none";
+  // defaults to measurements.csv, measurements.jsonl or, for hdrlog, the
+  // prefix measurements
+  const std::string EXPORT_FILE = "measurement.export.file";
+  // hdrlog writes the interval histograms, which only the hdrhistogram
+  // measurements keep
+  const std::string MEASUREMENT_TYPE = "measurementtype";
+  const std::string MEASUREMENT_TYPE_HDR = "hdrhistogram";
+
+  const size_t OUT_BUFFER_SIZE = 1 << 20;
+
+  const char CSV_HEADER[] =
+      "phase,timestamp_ms,interval_sec,series,count,ops_per_sec,"
+      "min_us,avg_us,max_us,p50_us,p90_us,p99_us,p99.9_us,p99.99_us";
+
+  int64_t TimestampMs(std::chrono::system_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+  }
+
+#ifdef HDRMEASUREMENT
+  hdr_timespec ToTimespec(std::chrono::system_clock::time_point time) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    hdr_timespec ts;
+    ts.tv_sec = ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+    return ts;
+  }
+#endif
+} // anonymous
+
+namespace ycsbc {
+
+MeasurementExporter *MeasurementExporter::Create(utils::Properties *props) {
+  std::string format = props->GetProperty(EXPORT_FORMAT, EXPORT_FORMAT_DEFAULT);
+  if (format == "none") {
+    return nullptr;
+  } else if (format == "csv") {
+    return new MeasurementExporter(Format::CSV,
+                                   props->GetProperty(EXPORT_FILE, "measurements.csv"));
+  } else if (format == "jsonl") {
+    return new MeasurementExporter(Format::JSONL,
+                                   props->GetProperty(EXPORT_FILE, "measurements.jsonl"));
+  } else if (format == "hdrlog") {
+#ifdef HDRMEASUREMENT
+    if (props->GetProperty(MEASUREMENT_TYPE, MEASUREMENT_TYPE_HDR) != MEASUREMENT_TYPE_HDR) {
+      throw utils::Exception("measurement.export=hdrlog needs measurementtype=hdrhistogram");
+    }
+    return new MeasurementExporter(Format::HDRLOG,
+                                   props->GetProperty(EXPORT_FILE, "measurements"));
+#else
+    throw utils::Exception("measurement.export=hdrlog needs HdrHistogram (HDRMEASUREMENT)");
+#endif
+  }
+  throw utils::Exception("Unknown measurement.export: " + format);
+}
+
+MeasurementExporter::MeasurementExporter(Format format, const std::string &path)
+    : format_(format), path_(path) {
+  if (format_ == Format::HDRLOG) {
+#ifdef HDRMEASUREMENT
+    hdr_log_writer_init(&hdr_writer_);
+#endif
+  } else {
+    out_buffer_.resize(OUT_BUFFER_SIZE);
+    out_.rdbuf()->pubsetbuf(out_buffer_.data(), out_buffer_.size());
+    out_.open(path_);
+    if (!out_.is_open()) {
+      throw utils::Exception("failed to open: " + path_);
+    }
+    if (format_ == Format::CSV) {
+      out_ << CSV_HEADER << '\n';
+    }
+  }
+  writer_ = std::thread(&MeasurementExporter::Work, this);
+}
+
+MeasurementExporter::~MeasurementExporter() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  writer_.join();
+  out_.close();
+#ifdef HDRMEASUREMENT
+  for (auto &log : hdr_logs_) {
+    std::fclose(log.second);
+  }
+#endif
+}
+
+void MeasurementExporter::Export(const std::string &phase, IntervalStats interval) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    queue_.emplace_back(phase, std::move(interval));
+  }
+  cv_.notify_one();
+}
+
+void MeasurementExporter::Work() {
+  std::unique_lock<std::mutex> lock(mu_);
+  while (true) {
+    cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return;
+    }
+    std::deque<std::pair<std::string, IntervalStats>> batch;
+    batch.swap(queue_);
+    lock.unlock();
+    for (auto &[phase, interval] : batch) {
+      Write(phase, interval);
+    }
+    // so that the files can be followed while the benchmark runs
+    out_.flush();
+#ifdef HDRMEASUREMENT
+    for (auto &log : hdr_logs_) {
+      std::fflush(log.second);
+    }
+#endif
+    lock.lock();
+  }
+}
+
+void MeasurementExporter::Write(const std::string &phase, const IntervalStats &interval) {
+  int64_t timestamp = TimestampMs(interval.end);
+  out_ << std::fixed << std::setprecision(3);
+  for (size_t i = 0; i < interval.series.size(); i++) {
+    const SeriesStats &series = interval.series[i];
+    double ops_per_sec = interval.seconds > 0 ? series.count / interval.seconds : 0;
+    if (format_ == Format::CSV) {
+      out_ << phase << ',' << timestamp << ',' << interval.seconds << ',' << series.name << ','
+           << series.count << ',' << ops_per_sec << ','
+           << series.min / 1000.0 << ',' << series.avg / 1000.0 << ',' << series.max / 1000.0 << ','
+           << series.p50 / 1000.0 << ',' << series.p90 / 1000.0 << ',' << series.p99 / 1000.0 << ','
+           << series.p999 / 1000.0 << ',' << series.p9999 / 1000.0 << '\n';
+    } else if (format_ == Format::JSONL) {
+      out_ << "{\"phase\":\"" << phase << "\",\"timestamp_ms\":" << timestamp
+           << ",\"interval_sec\":" << interval.seconds << ",\"series\":\"" << series.name
+           << "\",\"count\":" << series.count << ",\"ops_per_sec\":" << ops_per_sec
+           << ",\"min_us\":" << series.min / 1000.0 << ",\"avg_us\":" << series.avg / 1000.0
+           << ",\"max_us\":" << series.max / 1000.0 << ",\"p50_us\":" << series.p50 / 1000.0
+           << ",\"p90_us\":" << series.p90 / 1000.0 << ",\"p99_us\":" << series.p99 / 1000.0
+           << ",\"p99.9_us\":" << series.p999 / 1000.0
+           << ",\"p99.99_us\":" << series.p9999 / 1000.0 << "}\n";
+    } else {
+#ifdef HDRMEASUREMENT
+      hdr_timespec start = ToTimespec(
+          interval.end - std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                             std::chrono::duration<double>(interval.seconds)));
+      hdr_timespec end = ToTimespec(interval.end);
+      std::FILE *&log = hdr_logs_[phase + "." + series.name];
+      if (log == nullptr) {
+        std::string path = path_ + "." + phase + "." + series.name + ".hlog";
+        log = std::fopen(path.c_str(), "w");
+        if (log == nullptr) {
+          std::cerr << "failed to open: " << path << std::endl;
+          exit(1);
+        }
+        std::setvbuf(log, nullptr, _IOFBF, OUT_BUFFER_SIZE);
+        hdr_log_write_header(&hdr_writer_, log, ("YCSB-cpp " + series.name).c_str(), &start);
+      }
+      hdr_log_write(&hdr_writer_, log, &start, &end, interval.histograms[i].get());
+#endif
+    }
+  }
+}
+
+} // ycsbc
@@ -0,0 +1,82 @@
+//
+//  measurement_exporter.h
+//  YCSB-cpp
+//
+
+#ifndef YCSB_C_MEASUREMENT_EXPORTER_H_
+#define YCSB_C_MEASUREMENT_EXPORTER_H_
+
+#include "measurements.h"
+#include "utils/properties.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef HDRMEASUREMENT
+#include <hdr/hdr_histogram_log.h>
+#endif
+
+namespace ycsbc {
+
+///
+/// Writes the intervals taken by the status thread to files for tools to
+/// read (measurement.export): a row per series and interval as CSV or JSON
+/// lines, or HdrHistogram interval logs with one file per phase and series.
+/// Formatting and buffered writing happen on a thread of its own.
+///
+class MeasurementExporter {
+ public:
+  ///
+  /// Returns the exporter that props ask for, or nullptr if none.
+  /// Throws utils::Exception for an unknown format, an unwritable file, or
+  /// hdrlog without the hdrhistogram measurements.
+  ///
+  static MeasurementExporter *Create(utils::Properties *props);
+  ///
+  /// Writes out what is queued, then closes the files.
+  ///
+  ~MeasurementExporter();
+  ///
+  /// Queues interval, of the phase named, for writing.
+  ///
+  void Export(const std::string &phase, IntervalStats interval);
+
+ private:
+  enum class Format {
+    CSV,
+    JSONL,
+    HDRLOG
+  };
+
+  MeasurementExporter(Format format, const std::string &path);
+
+  const Format format_;
+  const std::string path_;  // of the file, or the prefix of the hdrlog files
+  std::ofstream out_;
+  std::vector<char> out_buffer_;
+#ifdef HDRMEASUREMENT
+  hdr_log_writer hdr_writer_;
+  std::map<std::string, std::FILE *> hdr_logs_;  // by "<phase>.<series>"
+#endif
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<std::pair<std::string, IntervalStats>> queue_;
+  bool stop_ = false;
+  std::thread writer_;
+
+  void Work();
+  void Write(const std::string &phase, const IntervalStats &interval);
+};
+
+} // ycsbc
+
+#endif // YCSB_C_MEASUREMENT_EXPORTER_H_
@@ -8,6 +8,7 @@
 #include "measurements.h"
 #include "utils/utils.h"
 
+#include <algorithm>
 #include <limits>
 #include <numeric>
 #include <sstream>
@@ -19,98 +20,397 @@ namespace {
 #else
   const std::string MEASUREMENT_TYPE_DEFAULT = "basic";
 #endif
+  const std::string MEASUREMENT_INTERVAL = "measurement.interval";
+  const std::string MEASUREMENT_INTERVAL_DEFAULT = "op";
+  const std::string MEASUREMENT_CLOCK = "measurement.clock";
+  const std::string MEASUREMENT_CLOCK_DEFAULT = "steady";
+
+  // Name of the index-th series: ops' service times, then their response times
+  std::string SeriesName(int index) {
+    if (index < ycsbc::MAXOPTYPE) {
+      return ycsbc::kOperationString[index];
+    }
+    return std::string("INTENDED-") + ycsbc::kOperationString[index - ycsbc::MAXOPTYPE];
+  }
+
+  // Adds count values of value nanoseconds to the summary buckets: up to
+  // 1 us, then up to 2 us, 4 us and so on
+  void AddToBuckets(std::vector<uint64_t> &buckets, uint64_t value, uint64_t count) {
+    size_t bucket = 0;
+    for (uint64_t bound = 1000; value > bound && bound < (uint64_t{1} << 62); bound *= 2) {
+      bucket++;
+    }
+    if (buckets.size() <= bucket) {
+      buckets.resize(bucket + 1);
+    }
+    buckets[bucket] += count;
+  }
+
+  // Fills in failures from the -FAILED series of each
+  void CountFailures(std::vector<ycsbc::SeriesSummary> &summary) {
+    for (ycsbc::SeriesSummary &series : summary) {
+      series.failures = 0;
+      for (const ycsbc::SeriesSummary &failed : summary) {
+        if (failed.name == series.name + "-FAILED") {
+          series.failures = failed.count;
+        }
+      }
+    }
+  }
+
+  std::string BucketBound(size_t bucket) {
+    uint64_t us = uint64_t{1} << bucket;
+    if (us >= 1000000 && us % 1000000 == 0) {
+      return std::to_string(us / 1000000) + "s";
+    }
+    return std::to_string(us) + "us";
+  }
+
 } // anonymous
 
 namespace ycsbc {
 
-BasicMeasurements::BasicMeasurements() : count_{}, latency_sum_{}, latency_max_{} {
-  std::fill(std::begin(latency_min_), std::end(latency_min_), std::numeric_limits<uint64_t>::max());
+BasicMeasurements::BasicMeasurements() : interval_start_(std::chrono::steady_clock::now()) {}
+
+BasicMeasurements::Shard::~Shard() {
+  for (Stats &s : stats) {
+    delete s.histogram.load(std::memory_order_relaxed);
+  }
 }
 
 void BasicMeasurements::Report(Operation op, uint64_t latency) {
-  count_[op].fetch_add(1, std::memory_order_relaxed);
-  latency_sum_[op].fetch_add(latency, std::memory_order_relaxed);
-  uint64_t prev_min = latency_min_[op].load(std::memory_order_relaxed);
-  while (prev_min > latency
-         && !latency_min_[op].compare_exchange_weak(prev_min, latency, std::memory_order_relaxed));
-  uint64_t prev_max = latency_max_[op].load(std::memory_order_relaxed);
-  while (prev_max < latency
-         && !latency_max_[op].compare_exchange_weak(prev_max, latency, std::memory_order_relaxed));
+  Record(op, latency);
+}
+
+void BasicMeasurements::ReportIntended(Operation op, uint64_t latency) {
+  Record(MAXOPTYPE + op, latency);
+}
+
+void BasicMeasurements::Record(int index, uint64_t latency) {
+  Stats &stats = shards_.Local().stats[index];
+  stats.count.store(stats.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  stats.latency_sum.store(stats.latency_sum.load(std::memory_order_relaxed) + latency,
+                          std::memory_order_relaxed);
+  if (latency < stats.latency_min.load(std::memory_order_relaxed))
+    stats.latency_min.store(latency, std::memory_order_relaxed);
+  if (latency > stats.latency_max.load(std::memory_order_relaxed))
+    stats.latency_max.store(latency, std::memory_order_relaxed);
+  utils::HistogramRecorder *histogram = stats.histogram.load(std::memory_order_acquire);
+  if (histogram == nullptr) {
+    histogram = new utils::HistogramRecorder();
+    stats.histogram.store(histogram, std::memory_order_release);
+  }
+  histogram->Record(latency);
+}
+
+void BasicMeasurements::Merge(Totals (&totals)[2 * MAXOPTYPE], bool histograms) {
+  shards_.ForEach([&](Shard &shard) {
+    for (int i = 0; i < 2 * MAXOPTYPE; i++) {
+      Stats &stats = shard.stats[i];
+      totals[i].count += stats.count.load(std::memory_order_relaxed);
+      totals[i].latency_sum += stats.latency_sum.load(std::memory_order_relaxed);
+      totals[i].latency_min = std::min(totals[i].latency_min,
+                                       stats.latency_min.load(std::memory_order_relaxed));
+      totals[i].latency_max = std::max(totals[i].latency_max,
+                                       stats.latency_max.load(std::memory_order_relaxed));
+      utils::HistogramRecorder *histogram = stats.histogram.load(std::memory_order_acquire);
+      if (histograms && histogram != nullptr) {
+        histogram->AddTo(totals[i].histogram);
+      }
+    }
+  });
 }
 
 std::string BasicMeasurements::GetStatusMsg() {
+  Totals totals[2 * MAXOPTYPE];
+  Merge(totals, false);
+
   std::ostringstream msg_stream;
   msg_stream.precision(2);
   uint64_t total_cnt = 0;
   msg_stream << std::fixed << " operations;";
-  for (int i = 0; i < MAXOPTYPE; i++) {
-    Operation op = static_cast<Operation>(i);
-    uint64_t cnt = count_[op].load(std::memory_order_relaxed);
+  for (int i = 0; i < 2 * MAXOPTYPE; i++) {
+    uint64_t cnt = totals[i].count;
     if (cnt == 0)
       continue;
-    msg_stream << " [" << kOperationString[op] << ":"
+    msg_stream << " [" << SeriesName(i) << ":"
                << " Count=" << cnt
-               << " Max=" << latency_max_[op].load(std::memory_order_relaxed) / 1000.0
-               << " Min=" << latency_min_[op].load(std::memory_order_relaxed) / 1000.0
-               << " Avg="
-               << ((cnt > 0)
-                   ? static_cast<double>(latency_sum_[op].load(std::memory_order_relaxed)) / cnt
-                   : 0) / 1000.0
+               << " Max=" << totals[i].latency_max / 1000.0
+               << " Min=" << totals[i].latency_min / 1000.0
+               << " Avg=" << static_cast<double>(totals[i].latency_sum) / cnt / 1000.0
                << "]";
-    total_cnt += cnt;
+    if (i < MAXOPTYPE)
+      total_cnt += cnt;
   }
   return std::to_string(total_cnt) + msg_stream.str();
 }
 
+IntervalStats BasicMeasurements::TakeInterval() {
+  std::lock_guard<std::mutex> lock(interval_mutex_);
+  Totals totals[2 * MAXOPTYPE];
+  Merge(totals, true);
+  auto now = std::chrono::steady_clock::now();
+  IntervalStats interval;
+  interval.end = std::chrono::system_clock::now();
+  interval.seconds = std::chrono::duration<double>(now - interval_start_).count();
+  interval.operations = 0;
+  interval_start_ = now;
+
+  for (int i = 0; i < 2 * MAXOPTYPE; i++) {
+    // the interval is what was added since its start; min and max come from
+    // its histogram, within the exact bounds of the totals
+    Totals &start = interval_start_totals_[i];
+    uint64_t cnt = totals[i].count - start.count;
+    uint64_t latency_sum = totals[i].latency_sum - start.latency_sum;
+    utils::Histogram histogram = totals[i].histogram;
+    histogram.Subtract(start.histogram);
+    uint64_t latency_min = std::max(histogram.Min(), totals[i].latency_min);
+    uint64_t latency_max = std::min(histogram.Max(), totals[i].latency_max);
+    start = std::move(totals[i]);
+    if (cnt == 0)
+      continue;
+    interval.series.push_back({SeriesName(i), cnt, latency_min, latency_max,
+                               static_cast<double>(latency_sum) / cnt,
+                               histogram.ValueAtPercentile(50), histogram.ValueAtPercentile(90),
+                               histogram.ValueAtPercentile(99), histogram.ValueAtPercentile(99.9),
+                               histogram.ValueAtPercentile(99.99)});
+    if (i < MAXOPTYPE)
+      interval.operations += cnt;
+  }
+  return interval;
+}
+
+std::vector<SeriesSummary> BasicMeasurements::GetSummary() {
+  Totals totals[2 * MAXOPTYPE];
+  Merge(totals, true);
+  std::vector<SeriesSummary> summary;
+  for (int i = 0; i < 2 * MAXOPTYPE; i++) {
+    const utils::Histogram &histogram = totals[i].histogram;
+    uint64_t cnt = totals[i].count;
+    if (cnt == 0)
+      continue;
+    // bucket midpoints, within the exact bounds
+    auto percentile = [&](double p) {
+      return std::clamp(histogram.ValueAtPercentile(p), totals[i].latency_min,
+                        totals[i].latency_max);
+    };
+    SeriesSummary series = {SeriesName(i), cnt, 0,
+                            static_cast<double>(totals[i].latency_sum) / cnt,
+                            totals[i].latency_min, totals[i].latency_max,
+                            percentile(50), percentile(90), percentile(95), percentile(99),
+                            percentile(99.9), percentile(99.99), {}};
+    histogram.ForEach([&series](uint64_t value, uint64_t count) {
+      AddToBuckets(series.buckets, value, count);
+    });
+    summary.push_back(std::move(series));
+  }
+  CountFailures(summary);
+  return summary;
+}
+
 void BasicMeasurements::Reset() {
-  std::fill(std::begin(count_), std::end(count_), 0);
-  std::fill(std::begin(latency_sum_), std::end(latency_sum_), 0);
-  std::fill(std::begin(latency_min_), std::end(latency_min_), std::numeric_limits<uint64_t>::max());
-  std::fill(std::begin(latency_max_), std::end(latency_max_), 0);
+  shards_.ForEach([](Shard &shard) {
+    for (Stats &stats : shard.stats) {
+      stats.count.store(0, std::memory_order_relaxed);
+      stats.latency_sum.store(0, std::memory_order_relaxed);
+      stats.latency_min.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+      stats.latency_max.store(0, std::memory_order_relaxed);
+      utils::HistogramRecorder *histogram = stats.histogram.load(std::memory_order_acquire);
+      if (histogram != nullptr) {
+        histogram->Reset();
+      }
+    }
+  });
+  std::lock_guard<std::mutex> lock(interval_mutex_);
+  for (Totals &start : interval_start_totals_) {
+    start = Totals();
+  }
+  interval_start_ = std::chrono::steady_clock::now();
 }
 
 #ifdef HDRMEASUREMENT
-HdrHistogramMeasurements::HdrHistogramMeasurements() {
-  for (int op = 0; op < MAXOPTYPE; op++) {
-    if (hdr_init(10, 100LL * 1000 * 1000 * 1000, 3, &histogram_[op]) != 0) {
-      utils::Exception("hdr init failed");
+namespace {
+  hdr_histogram *NewHistogram() {
+    hdr_histogram *histogram;
+    if (hdr_init(10, 100LL * 1000 * 1000 * 1000, 3, &histogram) != 0) {
+      throw utils::Exception("hdr init failed");
+    }
+    return histogram;
+  }
+} // anonymous
+
+HdrHistogramMeasurements::Shard::Shard() {
+  for (auto &slot : histogram) {
+    slot.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+HdrHistogramMeasurements::Shard::~Shard() {
+  for (auto &slot : histogram) {
+    if (hdr_histogram *h = slot.load(std::memory_order_relaxed)) {
+      hdr_close(h);
     }
   }
 }
 
+HdrHistogramMeasurements::HdrHistogramMeasurements()
+    : interval_start_(std::chrono::steady_clock::now()) {
+  for (int i = 0; i < 2 * MAXOPTYPE; i++) {
+    merged_[i] = NewHistogram();
+  }
+}
+
 void HdrHistogramMeasurements::Report(Operation op, uint64_t latency) {
-  hdr_record_value_atomic(histogram_[op], latency);
+  Record(op, latency);
+}
+
+void HdrHistogramMeasurements::ReportIntended(Operation op, uint64_t latency) {
+  Record(MAXOPTYPE + op, latency);
+}
+
+void HdrHistogramMeasurements::Record(int index, uint64_t latency) {
+  std::atomic<hdr_histogram *> &slot = shards_.Local().histogram[index];
+  hdr_histogram *histogram = slot.load(std::memory_order_acquire);
+  if (histogram == nullptr) {
+    histogram = NewHistogram();
+    slot.store(histogram, std::memory_order_release);
+  }
+  // atomic for the merging reader only; no other thread writes here
+  hdr_record_value_atomic(histogram, latency);
+}
+
+void HdrHistogramMeasurements::Merge() {
+  for (int i = 0; i < 2 * MAXOPTYPE; i++) {
+    hdr_reset(merged_[i]);
+  }
+  shards_.ForEach([this](Shard &shard) {
+    for (int i = 0; i < 2 * MAXOPTYPE; i++) {
+      hdr_histogram *histogram = shard.histogram[i].load(std::memory_order_acquire);
+      if (histogram != nullptr) {
+        hdr_add(merged_[i], histogram);
+      }
+    }
+  });
 }
 
 std::string HdrHistogramMeasurements::GetStatusMsg() {
+  std::lock_guard<std::mutex> lock(merge_mutex_);
+  Merge();
   std::ostringstream msg_stream;
   msg_stream.precision(2);
   uint64_t total_cnt = 0;
   msg_stream << std::fixed << " operations;";
-  for (int i = 0; i < MAXOPTYPE; i++) {
-    Operation op = static_cast<Operation>(i);
-    uint64_t cnt = histogram_[op]->total_count;
+  for (int i = 0; i < 2 * MAXOPTYPE; i++) {
+    hdr_histogram *histogram = merged_[i];
+    uint64_t cnt = histogram->total_count;
     if (cnt == 0)
       continue;
-    msg_stream << " [" << kOperationString[op] << ":"
+    msg_stream << " [" << SeriesName(i) << ":"
                << " Count=" << cnt
-               << " Max=" << hdr_max(histogram_[op]) / 1000.0
-               << " Min=" << hdr_min(histogram_[op]) / 1000.0
-               << " Avg=" << hdr_mean(histogram_[op]) / 1000.0
-               << " 90=" << hdr_value_at_percentile(histogram_[op], 90) / 1000.0
-               << " 99=" << hdr_value_at_percentile(histogram_[op], 99) / 1000.0
-               << " 99.9=" << hdr_value_at_percentile(histogram_[op], 99.9) / 1000.0
-               << " 99.99=" << hdr_value_at_percentile(histogram_[op], 99.99) / 1000.0
+               << " Max=" << hdr_max(histogram) / 1000.0
+               << " Min=" << hdr_min(histogram) / 1000.0
+               << " Avg=" << hdr_mean(histogram) / 1000.0
+               << " 90=" << hdr_value_at_percentile(histogram, 90) / 1000.0
+               << " 99=" << hdr_value_at_percentile(histogram, 99) / 1000.0
+               << " 99.9=" << hdr_value_at_percentile(histogram, 99.9) / 1000.0
+               << " 99.99=" << hdr_value_at_percentile(histogram, 99.99) / 1000.0
                << "]";
-    total_cnt += cnt;
+    if (i < MAXOPTYPE)
+      total_cnt += cnt;
   }
   return std::to_string(total_cnt) + msg_stream.str();
 }
 
+IntervalStats HdrHistogramMeasurements::TakeInterval() {
+  std::lock_guard<std::mutex> lock(merge_mutex_);
+  Merge();
+  auto now = std::chrono::steady_clock::now();
+  IntervalStats interval;
+  interval.end = std::chrono::system_clock::now();
+  interval.seconds = std::chrono::duration<double>(now - interval_start_).count();
+  interval.operations = 0;
+  interval_start_ = now;
+
+  for (int i = 0; i < 2 * MAXOPTYPE; i++) {
+    if (merged_[i]->total_count == 0)
+      continue;
+    if (interval_start_merged_[i] == nullptr) {
+      interval_start_merged_[i] = NewHistogram();
+    }
+    // the interval is what was added since its start; it goes to the caller
+    hdr_histogram *histogram = NewHistogram();
+    for (int32_t j = 0; j < histogram->counts_len; j++) {
+      histogram->counts[j] = merged_[i]->counts[j] - interval_start_merged_[i]->counts[j];
+    }
+    hdr_reset_internal_counters(histogram);
+    hdr_reset(interval_start_merged_[i]);
+    hdr_add(interval_start_merged_[i], merged_[i]);
+    std::shared_ptr<hdr_histogram> owner(histogram, hdr_close);
+    uint64_t cnt = histogram->total_count;
+    if (cnt == 0)
+      continue;
+    interval.series.push_back({SeriesName(i), cnt, static_cast<uint64_t>(hdr_min(histogram)),
+                               static_cast<uint64_t>(hdr_max(histogram)), hdr_mean(histogram),
+                               static_cast<uint64_t>(hdr_value_at_percentile(histogram, 50)),
+                               static_cast<uint64_t>(hdr_value_at_percentile(histogram, 90)),
+                               static_cast<uint64_t>(hdr_value_at_percentile(histogram, 99)),
+                               static_cast<uint64_t>(hdr_value_at_percentile(histogram, 99.9)),
+                               static_cast<uint64_t>(hdr_value_at_percentile(histogram, 99.99))});
+    interval.histograms.push_back(owner);
+    if (i < MAXOPTYPE)
+      interval.operations += cnt;
+  }
+  return interval;
+}
+
+std::vector<SeriesSummary> HdrHistogramMeasurements::GetSummary() {
+  std::lock_guard<std::mutex> lock(merge_mutex_);
+  Merge();
+  std::vector<SeriesSummary> summary;
+  for (int i = 0; i < 2 * MAXOPTYPE; i++) {
+    hdr_histogram *histogram = merged_[i];
+    uint64_t cnt = histogram->total_count;
+    if (cnt == 0)
+      continue;
+    SeriesSummary series = {SeriesName(i), cnt, 0, hdr_mean(histogram),
+                            static_cast<uint64_t>(hdr_min(histogram)),
+                            static_cast<uint64_t>(hdr_max(histogram)),
+                            static_cast<uint64_t>(hdr_value_at_percentile(histogram, 50)),
+                            static_cast<uint64_t>(hdr_value_at_percentile(histogram, 90)),
+                            static_cast<uint64_t>(hdr_value_at_percentile(histogram, 95)),
+                            static_cast<uint64_t>(hdr_value_at_percentile(histogram, 99)),
+                            static_cast<uint64_t>(hdr_value_at_percentile(histogram, 99.9)),
+                            static_cast<uint64_t>(hdr_value_at_percentile(histogram, 99.99)),
+                            {}};
+    hdr_iter iter;
+    hdr_iter_init(&iter, histogram);
+    while (hdr_iter_next(&iter)) {
+      if (iter.count != 0) {
+        AddToBuckets(series.buckets, iter.value, iter.count);
+      }
+    }
+    summary.push_back(std::move(series));
+  }
+  CountFailures(summary);
+  return summary;
+}
+
 void HdrHistogramMeasurements::Reset() {
-  for (int op = 0; op < MAXOPTYPE; op++) {
-    hdr_reset(histogram_[op]);
+  shards_.ForEach([](Shard &shard) {
+    for (auto &slot : shard.histogram) {
+      hdr_histogram *h = slot.load(std::memory_order_acquire);
+      if (h != nullptr) {
+        hdr_reset(h);
+      }
+    }
+  });
+  std::lock_guard<std::mutex> lock(merge_mutex_);
+  for (hdr_histogram *h : interval_start_merged_) {
+    if (h != nullptr) {
+      hdr_reset(h);
+    }
   }
+  interval_start_ = std::chrono::steady_clock::now();
 }
 #endif
 
@@ -131,4 +431,101 @@ Measurements *CreateMeasurements(utils::Properties *props) {
   return measurements;
 }
 
+std::string IntervalStatusMsg(const IntervalStats &interval) {
+  std::ostringstream msg_stream;
+  msg_stream.precision(2);
+  msg_stream << std::fixed << interval.operations << " operations in " << interval.seconds
+             << " sec; " << (interval.seconds > 0 ? interval.operations / interval.seconds : 0)
+             << " current ops/sec;";
+  for (const SeriesStats &series : interval.series) {
+    msg_stream << " [" << series.name << ":"
+               << " Count=" << series.count
+               << " Max=" << series.max / 1000.0
+               << " Min=" << series.min / 1000.0
+               << " Avg=" << series.avg / 1000.0
+               << " 50=" << series.p50 / 1000.0
+               << " 99=" << series.p99 / 1000.0
+               << " 99.9=" << series.p999 / 1000.0
+               << "]";
+  }
+  return msg_stream.str();
+}
+
+std::string SummaryMsg(const std::string &phase, const std::vector<SeriesSummary> &summary) {
+  std::ostringstream msg_stream;
+  msg_stream.precision(2);
+  msg_stream << std::fixed;
+  for (const SeriesSummary &series : summary) {
+    msg_stream << phase << " latency(us) " << series.name << ":"
+               << " Count=" << series.count
+               << " Failures=" << series.failures
+               << " Avg=" << series.avg / 1000.0
+               << " Min=" << series.min / 1000.0
+               << " 50=" << series.p50 / 1000.0
+               << " 90=" << series.p90 / 1000.0
+               << " 95=" << series.p95 / 1000.0
+               << " 99=" << series.p99 / 1000.0
+               << " 99.9=" << series.p999 / 1000.0
+               << " 99.99=" << series.p9999 / 1000.0
+               << " Max=" << series.max / 1000.0 << "\n";
+    // buckets from the first with values
+    msg_stream << phase << " histogram " << series.name << ":";
+    size_t first = 0;
+    while (series.buckets[first] == 0) {
+      first++;
+    }
+    for (size_t i = first; i < series.buckets.size(); i++) {
+      msg_stream << " <=" << BucketBound(i) << "=" << series.buckets[i];
+    }
+    msg_stream << "\n";
+  }
+  return msg_stream.str();
+}
+
+std::string SummaryJson(const std::vector<SeriesSummary> &summary) {
+  std::ostringstream json;
+  json.precision(3);
+  json << std::fixed << "{";
+  for (size_t i = 0; i < summary.size(); i++) {
+    const SeriesSummary &series = summary[i];
+    json << (i == 0 ? "" : ",") << "\"" << series.name << "\":{"
+         << "\"count\":" << series.count << ",\"failures\":" << series.failures
+         << ",\"avg_us\":" << series.avg / 1000.0 << ",\"min_us\":" << series.min / 1000.0
+         << ",\"p50_us\":" << series.p50 / 1000.0 << ",\"p90_us\":" << series.p90 / 1000.0
+         << ",\"p95_us\":" << series.p95 / 1000.0 << ",\"p99_us\":" << series.p99 / 1000.0
+         << ",\"p99.9_us\":" << series.p999 / 1000.0
+         << ",\"p99.99_us\":" << series.p9999 / 1000.0 << ",\"max_us\":" << series.max / 1000.0
+         << ",\"histogram\":[";
+    // [upper bound in us, count] of every bucket through that of max
+    for (size_t j = 0; j < series.buckets.size(); j++) {
+      json << (j == 0 ? "" : ",") << "[" << (uint64_t{1} << j) << "," << series.buckets[j] << "]";
+    }
+    json << "]}";
+  }
+  json << "}";
+  return json.str();
+}
+
+LatencyInterval GetLatencyInterval(utils::Properties *props) {
+  std::string interval = props->GetProperty(MEASUREMENT_INTERVAL, MEASUREMENT_INTERVAL_DEFAULT);
+  if (interval == "op") {
+    return LatencyInterval::OP;
+  } else if (interval == "intended") {
+    return LatencyInterval::INTENDED;
+  } else if (interval == "both") {
+    return LatencyInterval::BOTH;
+  }
+  throw utils::Exception("Unknown measurement.interval: " + interval);
+}
+
+LatencyClock GetLatencyClock(utils::Properties *props) {
+  std::string clock = props->GetProperty(MEASUREMENT_CLOCK, MEASUREMENT_CLOCK_DEFAULT);
+  if (clock == "steady") {
+    return LatencyClock::STEADY;
+  } else if (clock == "tsc") {
+    return LatencyClock::TSC;
+  }
+  throw utils::Exception("Unknown measurement.clock: " + clock);
+}
+
 } // ycsbc
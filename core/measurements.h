@@ -9,9 +9,17 @@
 #define YCSB_C_MEASUREMENTS_H_
 
 #include "core_workload.h"
+#include "utils/histogram.h"
 #include "utils/properties.h"
+#include "utils/thread_shards.h"
 
 #include <atomic>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #ifdef HDRMEASUREMENT
 #include <hdr/hdr_histogram.h>
@@ -21,10 +29,97 @@ typedef unsigned int uint;
 
 namespace ycsbc {
 
+///
+/// Which latency DBWrapper reports for operations with an intended start
+/// under an open-loop schedule (measurement.interval): service time from the
+/// actual start ("op"), response time from the intended start ("intended"),
+/// or both, the latter through ReportIntended ("both").
+///
+enum class LatencyInterval {
+  OP,
+  INTENDED,
+  BOTH
+};
+
+///
+/// What DBWrapper times operations with (measurement.clock): steady_clock, or
+/// the invariant TSC where the CPU has one, falling back to steady_clock.
+///
+enum class LatencyClock {
+  STEADY,
+  TSC
+};
+
+///
+/// Latencies of one series over an interval, in nanoseconds.
+///
+struct SeriesStats {
+  std::string name;  // of the op, INTENDED-<op> for response times
+  uint64_t count;
+  uint64_t min;
+  uint64_t max;
+  double avg;
+  uint64_t p50;
+  uint64_t p90;
+  uint64_t p99;
+  uint64_t p999;
+  uint64_t p9999;
+};
+
+///
+/// What was reported over an interval, as taken by Measurements::TakeInterval.
+///
+struct IntervalStats {
+  std::chrono::system_clock::time_point end;
+  double seconds;
+  uint64_t operations;  // of ops, not counting their response times again
+  std::vector<SeriesStats> series;  // of the series with values
+#ifdef HDRMEASUREMENT
+  std::vector<std::shared_ptr<hdr_histogram>> histograms;  // of series, in order
+#endif
+};
+
+///
+/// Latencies of one series since Reset, for the end-of-phase summary, in
+/// nanoseconds.
+///
+struct SeriesSummary {
+  std::string name;
+  uint64_t count;
+  uint64_t failures;  // count of <name>-FAILED
+  double avg;
+  uint64_t min;
+  uint64_t max;
+  uint64_t p50;
+  uint64_t p90;
+  uint64_t p95;
+  uint64_t p99;
+  uint64_t p999;
+  uint64_t p9999;
+  // counts of latencies up to 1 us, then from there up to 2 us, 4 us and so
+  // on, through the bucket of max
+  std::vector<uint64_t> buckets;
+};
+
 class Measurements {
  public:
   virtual void Report(Operation op, uint64_t latency) = 0;
+  ///
+  /// Reports the response time of an operation, measured from its intended
+  /// start, apart from its service time. Shown as INTENDED-<op>.
+  ///
+  virtual void ReportIntended(Operation op, uint64_t latency) = 0;
   virtual std::string GetStatusMsg() = 0;
+  ///
+  /// Returns the statistics of the operations reported since the previous
+  /// call or Reset, and starts the next interval. For a single caller, such
+  /// as the status thread.
+  ///
+  virtual IntervalStats TakeInterval() = 0;
+  ///
+  /// Returns the statistics of every series with values since Reset.
+  ///
+  virtual std::vector<SeriesSummary> GetSummary() = 0;
   virtual void Reset() = 0;
 };
 
@@ -32,13 +127,43 @@ class BasicMeasurements : public Measurements {
  public:
   BasicMeasurements();
   void Report(Operation op, uint64_t latency) override;
+  void ReportIntended(Operation op, uint64_t latency) override;
   std::string GetStatusMsg() override;
+  IntervalStats TakeInterval() override;
+  std::vector<SeriesSummary> GetSummary() override;
   void Reset() override;
  private:
-  std::atomic<uint> count_[MAXOPTYPE];
-  std::atomic<uint64_t> latency_sum_[MAXOPTYPE];
-  std::atomic<uint64_t> latency_min_[MAXOPTYPE];
-  std::atomic<uint64_t> latency_max_[MAXOPTYPE];
+  // Statistics of one series, updated by one thread only, so with plain
+  // loads and stores rather than read-modify-writes
+  struct Stats {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> latency_sum{0};
+    std::atomic<uint64_t> latency_min{std::numeric_limits<uint64_t>::max()};
+    std::atomic<uint64_t> latency_max{0};
+    // created by the thread when it first records to the series
+    std::atomic<utils::HistogramRecorder *> histogram{nullptr};
+  };
+  // A thread's statistics: service times of each op, then response times of
+  // each op, on cache lines of their own
+  struct alignas(64) Shard {
+    Stats stats[2 * MAXOPTYPE];
+    ~Shard();
+  };
+  // Statistics of one series over all shards
+  struct Totals {
+    uint64_t count = 0;
+    uint64_t latency_sum = 0;
+    uint64_t latency_min = std::numeric_limits<uint64_t>::max();
+    uint64_t latency_max = 0;
+    utils::Histogram histogram;
+  };
+  utils::ThreadShards<Shard> shards_;
+  std::mutex interval_mutex_;
+  Totals interval_start_totals_[2 * MAXOPTYPE];
+  std::chrono::steady_clock::time_point interval_start_;
+
+  void Record(int index, uint64_t latency);
+  void Merge(Totals (&totals)[2 * MAXOPTYPE], bool histograms);
 };
 
 #ifdef HDRMEASUREMENT
@@ -46,14 +171,47 @@ class HdrHistogramMeasurements : public Measurements {
  public:
   HdrHistogramMeasurements();
   void Report(Operation op, uint64_t latency) override;
+  void ReportIntended(Operation op, uint64_t latency) override;
   std::string GetStatusMsg() override;
+  IntervalStats TakeInterval() override;
+  std::vector<SeriesSummary> GetSummary() override;
   void Reset() override;
  private:
-  hdr_histogram *histogram_[MAXOPTYPE];
+  // A thread's histograms: service times of each op, then response times of
+  // each op, each created by the thread when it first records to it
+  struct alignas(64) Shard {
+    std::atomic<hdr_histogram *> histogram[2 * MAXOPTYPE];
+    Shard();
+    ~Shard();
+  };
+  utils::ThreadShards<Shard> shards_;
+  std::mutex merge_mutex_;
+  hdr_histogram *merged_[2 * MAXOPTYPE];  // of all shards, as of the last merge
+  // merged_ at the start of the current interval, created once its series
+  // has values
+  hdr_histogram *interval_start_merged_[2 * MAXOPTYPE] = {};
+  std::chrono::steady_clock::time_point interval_start_;
+
+  void Record(int index, uint64_t latency);
+  void Merge();
 };
 #endif
 
 Measurements *CreateMeasurements(utils::Properties *props);
+///
+/// Formats interval like GetStatusMsg, with throughput and percentiles.
+///
+std::string IntervalStatusMsg(const IntervalStats &interval);
+///
+/// Formats the summary of a phase, such as "Run", as lines of text.
+///
+std::string SummaryMsg(const std::string &phase, const std::vector<SeriesSummary> &summary);
+///
+/// Formats summary as a JSON object keyed by series name.
+///
+std::string SummaryJson(const std::vector<SeriesSummary> &summary);
+LatencyInterval GetLatencyInterval(utils::Properties *props);
+LatencyClock GetLatencyClock(utils::Properties *props);
 
 } // ycsbc
 
@@ -0,0 +1,203 @@
+//
+//  thread_pool_db.h
+//  YCSB-cpp
+//
+
+#ifndef YCSB_C_THREAD_POOL_DB_H_
+#define YCSB_C_THREAD_POOL_DB_H_
+
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "db.h"
+#include "utils/affinity.h"
+#include "utils/utils.h"
+
+namespace ycsbc {
+
+///
+/// Gives bindings with blocking calls only an asynchronous interface: each
+/// asynchronous operation runs on one of a pool of worker threads, every
+/// worker with a DB instance of its own, and its callback runs from Poll on
+/// the client thread. Synchronous calls go to the first instance. Workers
+/// move to placement, usually that of the client thread, before their first
+/// operation.
+///
+class ThreadPoolDB : public DB {
+ public:
+  explicit ThreadPoolDB(std::vector<DB *> dbs, utils::Placement placement = {})
+      : dbs_(std::move(dbs)), placement_(std::move(placement)) {
+    for (DB *db : dbs_) {
+      workers_.emplace_back(&ThreadPoolDB::Work, this, db);
+    }
+  }
+  ~ThreadPoolDB() {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      stop_ = true;
+    }
+    task_cv_.notify_all();
+    for (std::thread &worker : workers_) {
+      worker.join();
+    }
+    for (DB *db : dbs_) {
+      delete db;
+    }
+  }
+  void Init() {
+    for (DB *db : dbs_) {
+      db->Init();
+    }
+  }
+  void Cleanup() {
+    for (DB *db : dbs_) {
+      db->Cleanup();
+    }
+  }
+  Status Read(const std::string &table, const std::string &key,
+              const std::vector<std::string> *fields, std::vector<Field> &result) {
+    return dbs_[0]->Read(table, key, fields, result);
+  }
+  Status Scan(const std::string &table, const std::string &key, int record_count,
+              const std::vector<std::string> *fields, std::vector<std::vector<Field>> &result) {
+    return dbs_[0]->Scan(table, key, record_count, fields, result);
+  }
+  Status Update(const std::string &table, const std::string &key, std::vector<Field> &values) {
+    return dbs_[0]->Update(table, key, values);
+  }
+  Status Insert(const std::string &table, const std::string &key, std::vector<Field> &values) {
+    return dbs_[0]->Insert(table, key, values);
+  }
+  Status Delete(const std::string &table, const std::string &key) {
+    return dbs_[0]->Delete(table, key);
+  }
+  bool SupportsAsync() {
+    return true;
+  }
+  void ReadAsync(const std::string &table, const std::string &key,
+                 const std::vector<std::string> *fields, std::vector<Field> &result,
+                 Callback callback) {
+    Submit([=, &result](DB &db) { return db.Read(table, key, fields, result); },
+           std::move(callback));
+  }
+  void ScanAsync(const std::string &table, const std::string &key, int record_count,
+                 const std::vector<std::string> *fields, std::vector<std::vector<Field>> &result,
+                 Callback callback) {
+    Submit([=, &result](DB &db) { return db.Scan(table, key, record_count, fields, result); },
+           std::move(callback));
+  }
+  void UpdateAsync(const std::string &table, const std::string &key, std::vector<Field> &values,
+                   Callback callback) {
+    Submit([=, &values](DB &db) { return db.Update(table, key, values); }, std::move(callback));
+  }
+  void InsertAsync(const std::string &table, const std::string &key, std::vector<Field> &values,
+                   Callback callback) {
+    Submit([=, &values](DB &db) { return db.Insert(table, key, values); }, std::move(callback));
+  }
+  void DeleteAsync(const std::string &table, const std::string &key, Callback callback) {
+    Submit([=](DB &db) { return db.Delete(table, key); }, std::move(callback));
+  }
+  void Poll() {
+    std::unique_lock<std::mutex> lock(mu_);
+    done_cv_.wait(lock, [this] { return !done_.empty() || in_flight_ == 0; });
+    RunDone(lock);
+  }
+  void PollUntil(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mu_);
+    done_cv_.wait_until(lock, deadline, [this] { return !done_.empty() || in_flight_ == 0; });
+    RunDone(lock);
+  }
+  void SetIntendedStart(std::chrono::steady_clock::time_point intended_start) {
+    intended_start_ = intended_start;
+  }
+  std::string GetStatusMsg() {
+    return dbs_[0]->GetStatusMsg();
+  }
+
+ private:
+  struct Task {
+    std::function<Status(DB &)> op;
+    Callback callback;
+    std::optional<std::chrono::steady_clock::time_point> intended_start;
+  };
+
+  std::vector<DB *> dbs_;
+  const utils::Placement placement_;
+  std::vector<std::thread> workers_;
+  std::mutex mu_;
+  std::condition_variable task_cv_;
+  std::condition_variable done_cv_;
+  std::deque<Task> tasks_;
+  std::deque<std::pair<Callback, Status>> done_;
+  int in_flight_ = 0;  // submitted and not yet completed
+  bool stop_ = false;
+  // for the next submitted task only; client thread only
+  std::optional<std::chrono::steady_clock::time_point> intended_start_;
+
+  void Submit(std::function<Status(DB &)> op, Callback callback) {
+    std::optional<std::chrono::steady_clock::time_point> intended_start;
+    intended_start.swap(intended_start_);
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      tasks_.push_back({std::move(op), std::move(callback), intended_start});
+      in_flight_++;
+    }
+    task_cv_.notify_one();
+  }
+
+  // Runs the callbacks of the completed operations, outside the lock
+  void RunDone(std::unique_lock<std::mutex> &lock) {
+    std::deque<std::pair<Callback, Status>> done;
+    done.swap(done_);
+    lock.unlock();
+    for (auto &[callback, status] : done) {
+      callback(status);
+    }
+  }
+
+  void Work(DB *db) {
+    try {
+      utils::ApplyPlacement(placement_);
+    } catch (const utils::Exception &e) {
+      std::cerr << "Caught exception: " << e.what() << std::endl;
+      exit(1);
+    }
+    std::unique_lock<std::mutex> lock(mu_);
+    while (true) {
+      task_cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      Task task = std::move(tasks_.front());
+      tasks_.pop_front();
+      lock.unlock();
+      Status status;
+      try {
+        if (task.intended_start) {
+          db->SetIntendedStart(*task.intended_start);
+        }
+        status = task.op(*db);
+      } catch (const utils::Exception &e) {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        exit(1);
+      }
+      lock.lock();
+      done_.emplace_back(std::move(task.callback), status);
+      in_flight_--;
+      done_cv_.notify_one();
+    }
+  }
+};
+
+} // ycsbc
+
+#endif // YCSB_C_THREAD_POOL_DB_H_
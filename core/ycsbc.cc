@@ -6,6 +6,7 @@
 //  Copyright (c) 2014 Jinglei Ren <jinglei@ren.systems>.
 //
 
+#include <algorithm>
 #include <cstring>
 #include <ctime>
 
@@ -16,21 +17,32 @@
 #include <future>
 #include <chrono>
 #include <iomanip>
+#include <limits>
+#include <fstream>
+#include <sstream>
 
 #include "client.h"
 #include "core_workload.h"
 #include "db_factory.h"
+#include "measurement_exporter.h"
 #include "measurements.h"
+#include "thread_pool_db.h"
+#include "utils/affinity.h"
 #include "utils/countdown_latch.h"
+#include "utils/op_counter.h"
+#include "utils/open_loop.h"
 #include "utils/rate_limit.h"
 #include "utils/timer.h"
+#include "utils/tsc.h"
 #include "utils/utils.h"
 
 void UsageMessage(const char *command);
 bool StrStartWith(const char *str, const char *pre);
 void ParseCommandLine(int argc, const char *argv[], ycsbc::utils::Properties &props);
 
-void StatusThread(ycsbc::Measurements *measurements, ycsbc::utils::CountDownLatch *latch, int interval) {
+void StatusThread(ycsbc::Measurements *measurements, ycsbc::DB *db,
+                  ycsbc::utils::CountDownLatch *latch, int interval, bool print,
+                  ycsbc::MeasurementExporter *exporter, std::string phase) {
   using namespace std::chrono;
   time_point<system_clock> start = system_clock::now();
   bool done = false;
@@ -39,10 +51,21 @@ void StatusThread(ycsbc::Measurements *measurements, ycsbc::utils::CountDownLatc
     std::time_t now_c = system_clock::to_time_t(now);
     duration<double> elapsed_time = now - start;
 
-    std::cout << std::put_time(std::localtime(&now_c), "%F %T") << ' '
-              << static_cast<long long>(elapsed_time.count()) << " sec: ";
+    ycsbc::IntervalStats interval_stats = measurements->TakeInterval();
+    if (print) {
+      std::cout << std::put_time(std::localtime(&now_c), "%F %T") << ' '
+                << static_cast<long long>(elapsed_time.count()) << " sec: ";
 
-    std::cout << measurements->GetStatusMsg() << std::endl;
+      std::cout << measurements->GetStatusMsg() << " | " << ycsbc::IntervalStatusMsg(interval_stats);
+      std::string db_msg = db->GetStatusMsg();
+      if (!db_msg.empty()) {
+        std::cout << ' ' << db_msg;
+      }
+      std::cout << std::endl;
+    }
+    if (exporter) {
+      exporter->Export(phase, std::move(interval_stats));
+    }
 
     if (done) {
       break;
@@ -51,7 +74,22 @@ void StatusThread(ycsbc::Measurements *measurements, ycsbc::utils::CountDownLatc
   };
 }
 
-void RateLimitThread(std::string rate_file, std::vector<ycsbc::utils::RateLimiter *> rate_limiters,
+// Runs f(args...) on a new thread like std::async, with the thread moved to placement first
+template <typename F, typename... Args>
+auto PlacedAsync(const ycsbc::utils::Placement &placement, F f, Args... args) {
+  return std::async(std::launch::async, [placement, f, args...] {
+    try {
+      ycsbc::utils::ApplyPlacement(placement);
+    } catch (const ycsbc::utils::Exception &e) {
+      std::cerr << "Caught exception: " << e.what() << std::endl;
+      exit(1);
+    }
+    return f(args...);
+  });
+}
+
+template <typename Limiter>
+void RateLimitThread(std::string rate_file, std::vector<Limiter *> rate_limiters,
                      ycsbc::utils::CountDownLatch *latch) {
   std::ifstream ifs;
   ifs.open(rate_file);
@@ -103,6 +141,59 @@ int main(const int argc, const char *argv[]) {
     exit(1);
   }
 
+  // what operations are timed with (measurement.clock): "steady" for steady_clock, or "tsc" for the
+  // invariant TSC of x86-64 cpus, cheaper to read, falling back to steady_clock without one
+  ycsbc::LatencyClock latency_clock;
+  try {
+    // checked here rather than where each DB is created, which cannot report it
+    ycsbc::GetLatencyInterval(&props);
+    latency_clock = ycsbc::GetLatencyClock(&props);
+  } catch (const ycsbc::utils::Exception &e) {
+    std::cerr << e.what() << std::endl;
+    exit(1);
+  }
+  if (latency_clock == ycsbc::LatencyClock::TSC) {
+    if (ycsbc::utils::Tsc::Available()) {
+      std::cout << "Latency clock: tsc, " << ycsbc::utils::Tsc::SelfTest() << std::endl;
+    } else {
+      std::cout << "Latency clock: steady_clock, no invariant tsc" << std::endl;
+    }
+  }
+
+  // cpus to pin client threads to, one each in turn, as a list such as "0-3,8"; unpinned if empty
+  const std::string client_cpus = props.GetProperty("client.cpus", "");
+  // memory policy of pinned client threads: "none", "local" to prefer the node of their cpu, or
+  // "bind" to allow only that node
+  const std::string numa_policy = props.GetProperty("client.numa_policy", "none");
+  // cpus of the status and rate limit threads, those of client.cpus if empty
+  const std::string aux_cpus = props.GetProperty("client.aux_cpus", "");
+  std::vector<ycsbc::utils::Placement> client_placements(num_threads);
+  ycsbc::utils::Placement aux_placement;
+  try {
+    std::vector<int> cpus = ycsbc::utils::ParseCpuList(client_cpus);
+    ycsbc::utils::NumaPolicy numa = ycsbc::utils::ParseNumaPolicy(numa_policy);
+    for (int i = 0; i < num_threads && !cpus.empty(); i++) {
+      client_placements[i].cpus = {cpus[i % cpus.size()]};
+      client_placements[i].numa = numa;
+    }
+    aux_placement.cpus = aux_cpus.empty() ? cpus : ycsbc::utils::ParseCpuList(aux_cpus);
+  } catch (const ycsbc::utils::Exception &e) {
+    std::cerr << e.what() << std::endl;
+    exit(1);
+  }
+  if (!client_cpus.empty() || !aux_cpus.empty()) {
+    for (int i = 0; i < num_threads; i++) {
+      std::cout << "Client thread " << i << ": "
+                << ycsbc::utils::PlacementString(client_placements[i]) << std::endl;
+    }
+    std::cout << "Status and rate limit threads: "
+              << ycsbc::utils::PlacementString(aux_placement) << std::endl;
+  }
+
+  // operations each client thread keeps in flight; bindings without asynchronous calls get a pool
+  // of that many blocking instances per client thread, whose workers share its placement
+  const int outstanding = std::stoi(props.GetProperty("client.outstanding", "1"));
+
   std::vector<ycsbc::DB *> dbs;
   for (int i = 0; i < num_threads; i++) {
     ycsbc::DB *db = ycsbc::DBFactory::CreateDB(&props, measurements);
@@ -110,6 +201,13 @@ int main(const int argc, const char *argv[]) {
       std::cerr << "Unknown database name " << props["dbname"] << std::endl;
       exit(1);
     }
+    if (outstanding > 1 && !db->SupportsAsync()) {
+      std::vector<ycsbc::DB *> pool{db};
+      for (int j = 1; j < outstanding; j++) {
+        pool.push_back(ycsbc::DBFactory::CreateDB(&props, measurements));
+      }
+      db = new ycsbc::ThreadPoolDB(pool, client_placements[i]);
+    }
     dbs.push_back(db);
   }
 
@@ -120,29 +218,70 @@ int main(const int argc, const char *argv[]) {
   const bool show_status = (props.GetProperty("status", "false") == "true");
   const int status_interval = std::stoi(props.GetProperty("status.interval", "10"));
 
+  // per-interval measurements written to a file every status.interval, with or without status
+  ycsbc::MeasurementExporter *exporter = nullptr;
+  try {
+    exporter = ycsbc::MeasurementExporter::Create(&props);
+  } catch (const ycsbc::utils::Exception &e) {
+    std::cerr << e.what() << std::endl;
+    exit(1);
+  }
+
+  // JSON file for the end-of-phase latency summaries printed after each phase; none if empty
+  const std::string summary_file = props.GetProperty("measurement.summary.file", "");
+  std::ofstream summary_out;
+  if (!summary_file.empty()) {
+    summary_out.open(summary_file);
+    if (!summary_out.is_open()) {
+      std::cerr << "failed to open: " << summary_file << std::endl;
+      exit(1);
+    }
+  }
+  std::ostringstream summary_json;
+  auto report_phase = [&](const std::string &phase, double runtime, int ops) {
+    std::vector<ycsbc::SeriesSummary> summary = measurements->GetSummary();
+    std::cout << ycsbc::SummaryMsg(phase, summary) << std::flush;
+    std::string key = phase;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+    summary_json << (summary_json.tellp() > 0 ? "," : "") << "\"" << key
+                 << "\":{\"runtime_sec\":" << runtime << ",\"operations\":" << ops
+                 << ",\"ops_per_sec\":" << ops / runtime
+                 << ",\"series\":" << ycsbc::SummaryJson(summary) << "}";
+  };
+
+  // seconds after which each phase stops, however many of its operations are left; unlimited
+  // if <= 0. With it, an operation count of 0 means no limit on operations.
+  const double max_execution_time = std::stod(props.GetProperty("maxexecutiontime", "0"));
+  auto phase_ops = [max_execution_time](int64_t ops) {
+    return ops <= 0 && max_execution_time > 0 ? std::numeric_limits<int64_t>::max() : ops;
+  };
+
   // load phase
   if (do_load) {
-    const int total_ops = stoi(props[ycsbc::CoreWorkload::RECORD_COUNT_PROPERTY]);
+    const int64_t total_ops = std::stoll(props[ycsbc::CoreWorkload::RECORD_COUNT_PROPERTY]);
 
     ycsbc::utils::CountDownLatch latch(num_threads);
+    ycsbc::utils::CountDownLatch ready(num_threads);
+    ycsbc::utils::CountDownLatch start(1);
     ycsbc::utils::Timer<double> timer;
 
-    timer.Start();
-    std::future<void> status_future;
-    if (show_status) {
-      status_future = std::async(std::launch::async, StatusThread,
-                                 measurements, &latch, status_interval);
-    }
+    ycsbc::utils::OpCounter work(phase_ops(total_ops), max_execution_time);
     std::vector<std::future<int>> client_threads;
     for (int i = 0; i < num_threads; ++i) {
-      int thread_ops = total_ops / num_threads;
-      if (i < total_ops % num_threads) {
-        thread_ops++;
-      }
-
-      client_threads.emplace_back(std::async(std::launch::async, ycsbc::ClientThread, dbs[i], &wl,
-                                             thread_ops, true, true, !do_transaction, &latch, nullptr));
+      client_threads.emplace_back(PlacedAsync(client_placements[i], ycsbc::ClientThread, dbs[i],
+                                              &wl, &work, true, true, !do_transaction, &ready,
+                                              &start, &latch, nullptr, nullptr, outstanding));
+    }
+    // the phase, its deadline and its runtime start once every DB is initialized
+    ready.Await();
+    std::future<void> status_future;
+    if (show_status || exporter) {
+      status_future = PlacedAsync(aux_placement, StatusThread, measurements, dbs[0], &latch,
+                                  status_interval, show_status, exporter, std::string("load"));
     }
+    work.Start();
+    timer.Start();
+    start.CountDown();
     assert((int)client_threads.size() == num_threads);
 
     int sum = 0;
@@ -152,13 +291,14 @@ int main(const int argc, const char *argv[]) {
     }
     double runtime = timer.End();
 
-    if (show_status) {
+    if (status_future.valid()) {
       status_future.wait();
     }
 
     std::cout << "Load runtime(sec): " << runtime << std::endl;
     std::cout << "Load operations(ops): " << sum << std::endl;
     std::cout << "Load throughput(ops/sec): " << sum / runtime << std::endl;
+    report_phase("Load", runtime, sum);
   }
 
   measurements->Reset();
@@ -171,38 +311,108 @@ int main(const int argc, const char *argv[]) {
     const int64_t ops_limit = std::stoi(props.GetProperty("limit.ops", "0"));
     // rate file path for dynamic rate limiting, format "time_stamp_sec new_ops_per_second" per line
     std::string rate_file = props.GetProperty("limit.file", "");
+    // how the limit applies: "closed" delays each operation until the previous one has completed
+    // and the rate allows; "constant" and "poisson" give each operation an intended start from the
+    // rate alone (open loop), evenly spaced or as Poisson arrivals, so that its response time
+    // counts from then (see measurement.interval)
+    const std::string arrival = props.GetProperty("limit.arrival", "closed");
+    if (arrival != "closed" && arrival != "constant" && arrival != "poisson") {
+      std::cerr << "Unknown limit.arrival " << arrival << std::endl;
+      exit(1);
+    }
+    const bool open_loop = arrival != "closed" && (ops_limit > 0 || rate_file != "");
 
-    const int total_ops = stoi(props[ycsbc::CoreWorkload::OPERATION_COUNT_PROPERTY]);
+    // operations run before the measured ones, in addition to operationcount, until either limit
+    // is reached (no warm-up if both are 0); they count towards neither measurements nor
+    // throughput. The rate limit applies to them, the rate file only from measurement start.
+    const int64_t warmup_ops = std::stoll(props.GetProperty("warmup.ops", "0"));
+    const double warmup_time = std::stod(props.GetProperty("warmup.time", "0"));
+    const bool warmup = warmup_ops > 0 || warmup_time > 0;
 
-    ycsbc::utils::CountDownLatch latch(num_threads);
-    ycsbc::utils::Timer<double> timer;
+    const int64_t total_ops = std::stoll(props[ycsbc::CoreWorkload::OPERATION_COUNT_PROPERTY]);
 
-    timer.Start();
-    std::future<void> status_future;
-    if (show_status) {
-      status_future = std::async(std::launch::async, StatusThread,
-                                 measurements, &latch, status_interval);
-    }
-    std::vector<std::future<int>> client_threads;
     std::vector<ycsbc::utils::RateLimiter *> rate_limiters;
+    std::vector<ycsbc::utils::OpenLoopScheduler *> schedulers;
     for (int i = 0; i < num_threads; ++i) {
-      int thread_ops = total_ops / num_threads;
-      if (i < total_ops % num_threads) {
-        thread_ops++;
+      int64_t per_thread_ops = ops_limit / num_threads;
+      if (open_loop) {
+        schedulers.push_back(new ycsbc::utils::OpenLoopScheduler(per_thread_ops, arrival == "poisson",
+                                                                 i));
+      } else if (ops_limit > 0 || rate_file != "") {
+        rate_limiters.push_back(new ycsbc::utils::RateLimiter(per_thread_ops, per_thread_ops));
       }
-      ycsbc::utils::RateLimiter *rlim = nullptr;
-      if (ops_limit > 0 || rate_file != "") {
-        int64_t per_thread_ops = ops_limit / num_threads;
-        rlim = new ycsbc::utils::RateLimiter(per_thread_ops, per_thread_ops);
+    }
+    auto rlim = [&rate_limiters](int i) {
+      return rate_limiters.empty() ? nullptr : rate_limiters[i];
+    };
+    auto sched = [&schedulers](int i) {
+      return schedulers.empty() ? nullptr : schedulers[i];
+    };
+
+    if (warmup) {
+      ycsbc::utils::OpCounter work(warmup_ops > 0 ? warmup_ops : std::numeric_limits<int64_t>::max(),
+                                   warmup_time);
+      ycsbc::utils::CountDownLatch latch(num_threads);
+      ycsbc::utils::CountDownLatch ready(num_threads);
+      ycsbc::utils::CountDownLatch start(1);
+      std::vector<std::future<int>> client_threads;
+      for (int i = 0; i < num_threads; ++i) {
+        client_threads.emplace_back(PlacedAsync(client_placements[i], ycsbc::ClientThread, dbs[i],
+                                                &wl, &work, false, !do_load, false, &ready, &start,
+                                                &latch, rlim(i), sched(i), outstanding));
+      }
+      // the schedule would otherwise count the time Init took as backlog
+      ready.Await();
+      for (auto x : schedulers) {
+        x->Restart();
+      }
+      work.Start();
+      start.CountDown();
+      int sum = 0;
+      for (auto &n : client_threads) {
+        sum += n.get();
+      }
+      // every warm-up operation has completed and reported by now
+      measurements->Reset();
+      for (auto x : schedulers) {
+        x->Restart();
       }
-      rate_limiters.push_back(rlim);
-      client_threads.emplace_back(std::async(std::launch::async, ycsbc::ClientThread, dbs[i], &wl,
-                                             thread_ops, false, !do_load, true, &latch, rlim));
+      std::cout << "Warm-up operations(ops): " << sum << std::endl;
+    }
+
+    ycsbc::utils::CountDownLatch latch(num_threads);
+    ycsbc::utils::CountDownLatch ready(num_threads);
+    ycsbc::utils::CountDownLatch start(1);
+    ycsbc::utils::Timer<double> timer;
+
+    ycsbc::utils::OpCounter work(phase_ops(total_ops), max_execution_time);
+    std::vector<std::future<int>> client_threads;
+    for (int i = 0; i < num_threads; ++i) {
+      client_threads.emplace_back(PlacedAsync(client_placements[i], ycsbc::ClientThread, dbs[i],
+                                              &wl, &work, false, !do_load && !warmup, true, &ready,
+                                              &start, &latch, rlim(i), sched(i), outstanding));
+    }
+    // the schedule, the deadline and the runtime start once every DB is initialized
+    ready.Await();
+    for (auto x : schedulers) {
+      x->Restart();
     }
+    std::future<void> status_future;
+    if (show_status || exporter) {
+      status_future = PlacedAsync(aux_placement, StatusThread, measurements, dbs[0], &latch,
+                                  status_interval, show_status, exporter, std::string("run"));
+    }
+    work.Start();
+    timer.Start();
+    start.CountDown();
 
     std::future<void> rlim_future;
-    if (rate_file != "") {
-      rlim_future = std::async(std::launch::async, RateLimitThread, rate_file, rate_limiters, &latch);
+    if (rate_file != "" && open_loop) {
+      rlim_future = PlacedAsync(aux_placement, RateLimitThread<ycsbc::utils::OpenLoopScheduler>,
+                                rate_file, schedulers, &latch);
+    } else if (rate_file != "") {
+      rlim_future = PlacedAsync(aux_placement, RateLimitThread<ycsbc::utils::RateLimiter>,
+                                rate_file, rate_limiters, &latch);
     }
 
     assert((int)client_threads.size() == num_threads);
@@ -214,18 +424,23 @@ int main(const int argc, const char *argv[]) {
     }
     double runtime = timer.End();
 
-    if (show_status) {
+    if (status_future.valid()) {
       status_future.wait();
     }
 
     std::cout << "Run runtime(sec): " << runtime << std::endl;
     std::cout << "Run operations(ops): " << sum << std::endl;
     std::cout << "Run throughput(ops/sec): " << sum / runtime << std::endl;
+    report_phase("Run", runtime, sum);
   }
 
   for (int i = 0; i < num_threads; i++) {
     delete dbs[i];
   }
+  delete exporter;
+  if (summary_out.is_open()) {
+    summary_out << "{" << summary_json.str() << "}" << std::endl;
+  }
 }
 
 void ParseCommandLine(int argc, const char *argv[], ycsbc::utils::Properties &props) {
@@ -1,57 +1,778 @@
 #include "kvssd.h"
 
+#include <unistd.h>
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+
+#include "core/core_workload.h"
+
+#include "kvssd_file_db.h"
 #include "kvssd_hashmap_db.h"
 #include "kvssd_hashmap_db_impl.h"
+#include "kvssd_keyspace.h"
+#include "kvssd_lockfree_db.h"
+#include "kvssd_sharded_db.h"
+#include "kvssd_snapshot.h"
+#include "kvssd_timing.h"
 
 namespace {
-const std::string PROP_BACKEND = "hashmap";
+const std::string PROP_BACKEND = "kvssd.backend";
+const std::string PROP_BACKEND_DEFAULT = "hashmap";
+
+const std::string PROP_INITIAL_CAPACITY = "kvssd.initial_capacity";
+const std::string PROP_INITIAL_CAPACITY_DEFAULT = "0";
+
+const std::string PROP_MAX_LOAD_FACTOR = "kvssd.max_load_factor";
+const std::string PROP_MAX_LOAD_FACTOR_DEFAULT = "1.0";
+
+const std::string PROP_SHARDS = "kvssd.shards";
+const std::string PROP_SHARDS_DEFAULT = "1";
+
+const std::string PROP_LOCKFREE_CAPACITY = "kvssd.lockfree.capacity";
+const std::string PROP_LOCKFREE_CAPACITY_DEFAULT = "4194304";
+
+const std::string PROP_FILE_PATH = "kvssd.file.path";
+const std::string PROP_FILE_PATH_DEFAULT = "/tmp/ycsb-kvssd.log";
+
+const std::string PROP_FILE_DESTROY = "kvssd.file.destroy";
+const std::string PROP_FILE_DESTROY_DEFAULT = "false";
+
+const std::string PROP_FILE_GC_THRESHOLD = "kvssd.file.gc_threshold";
+const std::string PROP_FILE_GC_THRESHOLD_DEFAULT = "0.5";
+
+const std::string PROP_FILE_DIRECT_IO = "kvssd.file.direct_io";
+const std::string PROP_FILE_DIRECT_IO_DEFAULT = "false";
+
+const std::string PROP_IO_ENGINE = "kvssd.io_engine";
+const std::string PROP_IO_ENGINE_DEFAULT = "psync";
+
+const std::string PROP_TIMING = "kvssd.timing";
+const std::string PROP_TIMING_DEFAULT = "none";
+
+const std::string PROP_TIMING_READ_US = "kvssd.timing.read_us";
+const std::string PROP_TIMING_READ_US_DEFAULT = "80";
+
+const std::string PROP_TIMING_WRITE_US = "kvssd.timing.write_us";
+const std::string PROP_TIMING_WRITE_US_DEFAULT = "20";
+
+const std::string PROP_TIMING_DELETE_US = "kvssd.timing.delete_us";
+const std::string PROP_TIMING_DELETE_US_DEFAULT = "10";
+
+const std::string PROP_TIMING_CHANNEL_MBPS = "kvssd.timing.channel_mbps";
+const std::string PROP_TIMING_CHANNEL_MBPS_DEFAULT = "800";
+
+const std::string PROP_TIMING_CHANNELS = "kvssd.timing.channels";
+const std::string PROP_TIMING_CHANNELS_DEFAULT = "8";
+
+const std::string PROP_TIMING_DIES = "kvssd.timing.dies_per_channel";
+const std::string PROP_TIMING_DIES_DEFAULT = "4";
+
+const std::string PROP_TIMING_WA = "kvssd.timing.write_amplification";
+const std::string PROP_TIMING_WA_DEFAULT = "1.0";
+
+const std::string PROP_TIMING_GC_BLOCK_KB = "kvssd.timing.gc_block_kb";
+const std::string PROP_TIMING_GC_BLOCK_KB_DEFAULT = "256";
+
+const std::string PROP_TIMING_GC_STALL_US = "kvssd.timing.gc_stall_us";
+const std::string PROP_TIMING_GC_STALL_US_DEFAULT = "3000";
+
+const std::string PROP_FILTER = "kvssd.filter";
+const std::string PROP_FILTER_DEFAULT = "none";
+
+const std::string PROP_FILTER_COUNTERS_PER_KEY = "kvssd.filter.counters_per_key";
+const std::string PROP_FILTER_COUNTERS_PER_KEY_DEFAULT = "10";
+
+const std::string PROP_KEYSPACES = "kvssd.keyspaces";
+const std::string PROP_KEYSPACES_DEFAULT = "false";
+
+// Overridden per table by kvssd.keyspace.capacity_mb.<table>.
+const std::string PROP_KEYSPACE_CAPACITY_MB = "kvssd.keyspace.capacity_mb";
+const std::string PROP_KEYSPACE_CAPACITY_MB_DEFAULT = "0";
+
+// Key spaces have images of their own, named after them.
+const std::string PROP_SNAPSHOT_PATH = "kvssd.snapshot_path";
+const std::string PROP_SNAPSHOT_PATH_DEFAULT = "";
+
+const std::string PROP_ASYNC_WORKERS = "kvssd.async_workers";
+const std::string PROP_ASYNC_WORKERS_DEFAULT = "0";
+
+const std::string PROP_BATCH_SIZE = "kvssd.batch_size";
+const std::string PROP_BATCH_SIZE_DEFAULT = "1";
+
+const std::string PROP_FORMAT = "kvssd.format";
+const std::string PROP_FORMAT_DEFAULT = "packed";
+
+const std::string PROP_PRINT_MEMORY = "kvssd.print_memory_usage";
+const std::string PROP_PRINT_MEMORY_DEFAULT = "false";
+
+const std::string PROP_PRINT_IO = "kvssd.print_io_stats";
+const std::string PROP_PRINT_IO_DEFAULT = "false";
+
+std::shared_ptr<kvssd::TimingModel> NewTimingModel(const ycsbc::utils::Properties &props) {
+    std::string model = props.GetProperty(PROP_TIMING, PROP_TIMING_DEFAULT);
+    if (model == "none") {
+        return nullptr;
+    }
+    if (model != "nand") {
+        throw ycsbc::utils::Exception("Unknown kvssd timing model: " + model);
+    }
+    auto micros = [&props](const std::string &name, const std::string &default_value) {
+        return static_cast<uint64_t>(std::stod(props.GetProperty(name, default_value)) * 1000);
+    };
+    kvssd::NandTimingModel::Config config;
+    config.read_ns = micros(PROP_TIMING_READ_US, PROP_TIMING_READ_US_DEFAULT);
+    config.write_ns = micros(PROP_TIMING_WRITE_US, PROP_TIMING_WRITE_US_DEFAULT);
+    config.delete_ns = micros(PROP_TIMING_DELETE_US, PROP_TIMING_DELETE_US_DEFAULT);
+    // 1 MB/s is 1e-3 bytes/ns.
+    config.bus_bytes_per_ns =
+        std::stod(props.GetProperty(PROP_TIMING_CHANNEL_MBPS, PROP_TIMING_CHANNEL_MBPS_DEFAULT)) /
+        1000;
+    config.channels =
+        std::stoul(props.GetProperty(PROP_TIMING_CHANNELS, PROP_TIMING_CHANNELS_DEFAULT));
+    config.dies_per_channel =
+        std::stoul(props.GetProperty(PROP_TIMING_DIES, PROP_TIMING_DIES_DEFAULT));
+    config.write_amplification =
+        std::stod(props.GetProperty(PROP_TIMING_WA, PROP_TIMING_WA_DEFAULT));
+    config.gc_block_bytes =
+        std::stoul(props.GetProperty(PROP_TIMING_GC_BLOCK_KB, PROP_TIMING_GC_BLOCK_KB_DEFAULT)) *
+        1024;
+    config.gc_stall_ns = micros(PROP_TIMING_GC_STALL_US, PROP_TIMING_GC_STALL_US_DEFAULT);
+    if (config.bus_bytes_per_ns <= 0) {
+        throw ycsbc::utils::Exception("kvssd.timing.channel_mbps must be positive");
+    }
+    return std::make_shared<kvssd::NandTimingModel>(config);
+}
+
+// The backend of a device, or of one of its key spaces; a key space of the
+// file backend lives in a file of its own, named after it. The key spaces of
+// a device share its timing model.
+kvssd::KVSSD *NewKvssdBackend(const ycsbc::utils::Properties &props,
+                              const std::shared_ptr<kvssd::TimingModel> &timing,
+                              const std::string &key_space = "") {
+    std::string backend = props.GetProperty(PROP_BACKEND, PROP_BACKEND_DEFAULT);
+    size_t capacity =
+        std::stoul(props.GetProperty(PROP_INITIAL_CAPACITY, PROP_INITIAL_CAPACITY_DEFAULT));
+    float max_load_factor =
+        std::stof(props.GetProperty(PROP_MAX_LOAD_FACTOR, PROP_MAX_LOAD_FACTOR_DEFAULT));
+    if (backend == "hashmap") {
+        size_t shards = std::stoul(props.GetProperty(PROP_SHARDS, PROP_SHARDS_DEFAULT));
+        size_t workers =
+            std::stoul(props.GetProperty(PROP_ASYNC_WORKERS, PROP_ASYNC_WORKERS_DEFAULT));
+        std::string filter = props.GetProperty(PROP_FILTER, PROP_FILTER_DEFAULT);
+        if (filter != "none" && filter != "bloom") {
+            throw ycsbc::utils::Exception("Unknown kvssd filter: " + filter);
+        }
+        // Without a pre-sized index the filter is sized for the records loaded.
+        size_t filter_keys = capacity;
+        if (filter_keys == 0) {
+            filter_keys =
+                std::stoul(props.GetProperty(ycsbc::CoreWorkload::RECORD_COUNT_PROPERTY, "0"));
+        }
+        double counters_per_key = std::stod(props.GetProperty(
+            PROP_FILTER_COUNTERS_PER_KEY, PROP_FILTER_COUNTERS_PER_KEY_DEFAULT));
+        if (shards > 1) {
+            auto *sharded = new kvssd_hashmap::Sharded_KVSSD(shards, workers);
+            sharded->SetTimingModel(timing);
+            sharded->Reserve(capacity, max_load_factor);
+            if (filter == "bloom") {
+                sharded->EnableFilter(filter_keys, counters_per_key);
+            }
+            return sharded;
+        }
+        auto *hashmap = new kvssd_hashmap::Hashmap_KVSSD(workers);
+        hashmap->SetTimingModel(timing);
+        hashmap->Reserve(capacity, max_load_factor);
+        if (filter == "bloom") {
+            hashmap->EnableFilter(filter_keys, counters_per_key);
+        }
+        return hashmap;
+    }
+    if (backend == "lockfree") {
+        // The lock-free table has a fixed number of slots and never rehashes.
+        size_t slots = std::stoul(
+            props.GetProperty(PROP_LOCKFREE_CAPACITY, PROP_LOCKFREE_CAPACITY_DEFAULT));
+        return new kvssd_lockfree::LockFree_KVSSD(slots);
+    }
+    if (backend == "file") {
+        bool destroy = ycsbc::utils::StrToBool(
+            props.GetProperty(PROP_FILE_DESTROY, PROP_FILE_DESTROY_DEFAULT));
+        double gc_threshold = std::stod(
+            props.GetProperty(PROP_FILE_GC_THRESHOLD, PROP_FILE_GC_THRESHOLD_DEFAULT));
+        bool direct_io = ycsbc::utils::StrToBool(
+            props.GetProperty(PROP_FILE_DIRECT_IO, PROP_FILE_DIRECT_IO_DEFAULT));
+        std::string path = props.GetProperty(PROP_FILE_PATH, PROP_FILE_PATH_DEFAULT);
+        if (!key_space.empty()) {
+            path += "." + key_space;
+        }
+        auto *file = new kvssd_file::File_KVSSD(
+            path, destroy, gc_threshold, props.GetProperty(PROP_IO_ENGINE, PROP_IO_ENGINE_DEFAULT),
+            direct_io);
+        file->Reserve(capacity, max_load_factor);
+        return file;
+    }
+    throw ycsbc::utils::Exception("Unknown kvssd backend: " + backend);
+}
+
+// The workload that images are taken with and restored into.
+kvssd::SnapshotWorkload SnapshotWorkloadOf(const ycsbc::utils::Properties &props) {
+    using ycsbc::CoreWorkload;
+    return {std::stoull(props.GetProperty(CoreWorkload::RECORD_COUNT_PROPERTY, "0")),
+            static_cast<uint32_t>(std::stoul(props.GetProperty(
+                CoreWorkload::FIELD_COUNT_PROPERTY, CoreWorkload::FIELD_COUNT_DEFAULT)))};
+}
+
+// Restores a device from its snapshot image, if there is one; returns
+// whether it did.
+bool RestoreSnapshot(kvssd::KVSSD &kvssd, const std::string &path,
+                     const kvssd::SnapshotWorkload &workload) {
+    if (access(path.c_str(), F_OK) != 0) {
+        return false;
+    }
+    uint64_t records;
+    kvssd::kvs_result ret = kvssd::LoadSnapshot(kvssd, path, workload, records);
+    if (ret == kvssd::kvs_result::KVS_ERR_PARAM_INVALID) {
+        throw ycsbc::utils::Exception("Cannot load kvssd snapshot " + path +
+                                      ": taken with another recordcount or fieldcount");
+    }
+    if (ret != kvssd::kvs_result::KVS_SUCCESS) {
+        throw ycsbc::utils::Exception("Cannot load kvssd snapshot " + path + ": " +
+                                      std::string(kvssd::kvstrerror[static_cast<int>(ret)]));
+    }
+    std::cout << "KVSSD restored " << records << " records from " << path << std::endl;
+    return true;
+}
+
+void SaveSnapshot(kvssd::KVSSD &kvssd, const std::string &path,
+                  const kvssd::SnapshotWorkload &workload) {
+    uint64_t records;
+    if (kvssd::kvs_result ret = kvssd::DumpSnapshot(kvssd, path, workload, records);
+        ret != kvssd::kvs_result::KVS_SUCCESS) {
+        throw ycsbc::utils::Exception("Cannot dump kvssd snapshot " + path + ": " +
+                                      std::string(kvssd::kvstrerror[static_cast<int>(ret)]));
+    }
+    std::cout << "KVSSD dumped " << records << " records to " << path << std::endl;
+}
+
+// Statistics are printed per key space, labelled with its name.
+void PrintMemoryUsage(kvssd::KVSSD &kvssd, const std::string &label) {
+    kvssd::kvs_memory_usage usage;
+    if (kvssd.GetMemoryUsage(usage) != kvssd::kvs_result::KVS_SUCCESS) {
+        std::cerr << "kvssd backend does not report memory usage" << std::endl;
+        return;
+    }
+    std::cout << label << " records: " << usage.records << ", key bytes: " << usage.key_bytes
+              << ", value bytes: " << usage.value_bytes
+              << ", allocated bytes: " << usage.allocated_bytes;
+    if (usage.records) {
+        std::cout << ", allocated bytes/record: " << usage.allocated_bytes / usage.records;
+    }
+    std::cout << std::endl;
+}
+
+// Device time is submit-to-complete in the kernel; host time is the rest of
+// the engine's work per request.
+void PrintIoStats(kvssd::KVSSD &kvssd, const std::string &label) {
+    kvssd::kvs_io_stats stats;
+    if (kvssd.GetIoStats(stats) != kvssd::kvs_result::KVS_SUCCESS) {
+        std::cerr << "kvssd backend does not report I/O statistics" << std::endl;
+        return;
+    }
+    auto print = [&label](const char *name, uint64_t count, uint64_t device_ns,
+                          uint64_t host_ns) {
+        std::cout << label << " " << name << ": " << count;
+        if (count) {
+            std::cout << ", avg device(us): " << device_ns / 1000.0 / count
+                      << ", avg host(us): " << host_ns / 1000.0 / count;
+        }
+        std::cout << std::endl;
+    };
+    print("reads", stats.reads, stats.read_device_ns, stats.read_host_ns);
+    print("writes", stats.writes, stats.write_device_ns, stats.write_host_ns);
+}
+
+// Adds the filter outcomes of a device to total; false if it has no filter.
+bool SumFilterStats(kvssd::KVSSD &kvssd, kvssd::kvs_filter_stats &total) {
+    kvssd::kvs_filter_stats stats;
+    if (kvssd.GetFilterStats(stats) != kvssd::kvs_result::KVS_SUCCESS) {
+        return false;
+    }
+    total.negatives += stats.negatives;
+    total.false_positives += stats.false_positives;
+    total.memory_bytes += stats.memory_bytes;
+    return true;
+}
+
+// The false-positive rate is over the lookups of absent keys.
+std::string FilterStatusMsg(const kvssd::kvs_filter_stats &stats) {
+    uint64_t misses = stats.negatives + stats.false_positives;
+    std::ostringstream msg;
+    msg << "[KVSSD-FILTER: Negatives=" << stats.negatives
+        << " FalsePositives=" << stats.false_positives << " FPRate="
+        << (misses ? static_cast<double>(stats.false_positives) / misses : 0.0) << "]";
+    return msg.str();
+}
 }  // anonymous namespace
 
+// Row layout for kvssd.format=fixed, or nullptr for the packed format.
+std::unique_ptr<kvssd_hashmap::FieldLayout> NewFieldLayout(const ycsbc::utils::Properties &props) {
+    std::string format = props.GetProperty(PROP_FORMAT, PROP_FORMAT_DEFAULT);
+    if (format == "packed") {
+        return nullptr;
+    }
+    if (format != "fixed") {
+        throw ycsbc::utils::Exception("Unknown kvssd format: " + format);
+    }
+    using ycsbc::CoreWorkload;
+    return std::make_unique<kvssd_hashmap::FieldLayout>(
+        props.GetProperty(CoreWorkload::FIELD_NAME_PREFIX, CoreWorkload::FIELD_NAME_PREFIX_DEFAULT),
+        std::stoul(props.GetProperty(CoreWorkload::FIELD_COUNT_PROPERTY,
+                                     CoreWorkload::FIELD_COUNT_DEFAULT)),
+        std::stoul(props.GetProperty(CoreWorkload::FIELD_LENGTH_PROPERTY,
+                                     CoreWorkload::FIELD_LENGTH_DEFAULT)));
+}
+
+// The emulated device is shared by every client thread, like a real KV-SSD.
+// With kvssd.keyspaces, each table is a key space of the device with its own
+// index and quota, created by the first client to use it; otherwise tables
+// share one namespace.
+//
+// With kvssd.batch_size > 1 the asynchronous writes a client keeps in flight
+// are collected into batch commands of that many requests. Each completes,
+// with its own result, once its batch has been issued, so its latency is its
+// wait in the batch plus the command's. A batch is issued early when a read
+// hits one of its keys, before scans and synchronous writes, before a write
+// to another key space, and when Poll (but not PollUntil) has nothing else to
+// wait for. Pending batches are invisible to other clients, so a read that
+// misses issues every client's batch and tries again. Reads of absent keys
+// return kNotFound.
+//
+// With kvssd.format=fixed, reads of some fields and updates of some fields
+// only transfer those fields' slots. They drain pending writes first.
+//
+// The asynchronous calls submit requests of their own, completed by Poll,
+// which with kvssd.async_workers > 0 lets a client keep several in flight
+// (client.outstanding), each reported when it completes.
+// Scans, reads while batching, and field access by layout complete
+// synchronously instead.
+//
+// With kvssd.snapshot_path, the device is restored from the image there when
+// it is created for a run without -load, if one exists; otherwise its records
+// are dumped there once the last client is cleaned up. A -load run thus
+// leaves an image that later -run runs start from, each on the same data. The
+// image records recordcount and fieldcount, and only restores into runs with
+// the same ones. Only the hashmap backend, with
+// or without shards, supports snapshots.
 class KvssdDbWrapper : public ycsbc::DB {
    private:
-    std::unique_ptr<kvssd::KVSSD> kvssd;
+    static std::unique_ptr<kvssd::KVSSD> kvssd;
+    static std::unique_ptr<kvssd::KeySpaceTable> key_spaces;
+    static int ref_cnt;
+    static std::mutex mu;
+    // Whether the device, or any of its key spaces, came from an image.
+    static std::atomic<bool> restored;
+
+    std::unique_ptr<kvssd_hashmap::FieldLayout> layout;
+    // Key spaces this client has opened, by table name.
+    std::unordered_map<std::string, kvssd::KVSSD *> opened;
+    // The owner and FlushBatches, on a read miss, are its only users.
+    struct ClientBatch {
+        explicit ClientBatch(size_t capacity) : rows(capacity) {}
+        std::mutex mu;
+        kvssd_hashmap::RowBatch rows;
+        kvssd::KVSSD *space = nullptr;  // of the pending rows
+    };
+    static std::set<ClientBatch *> batches;  // guarded by mu
+
+    std::unique_ptr<ClientBatch> batch;
+    std::vector<char> read_buffer;
+    std::vector<char> scan_buffer;
+
+    // An asynchronous request of this client.
+    struct AsyncOp {
+        Callback callback;
+        kvssd::KVSSD *space;
+        std::string key;
+        std::vector<ycsbc::DB::Field> *result;  // of a read, with the buffer it reads into
+        std::vector<char> buffer;
+    };
+    kvssd::CompletionQueue async_cq;
+    std::unordered_map<void *, std::unique_ptr<AsyncOp>> async_ops;  // by tag
+    std::vector<std::unique_ptr<AsyncOp>> free_async_ops;  // kept for their buffers
+
+    kvssd::KVSSD &KeySpace(const std::string &table) {
+        if (!key_spaces) {
+            return *kvssd;
+        }
+        if (auto it = opened.find(table); it != opened.end()) {
+            return *it->second;
+        }
+        std::string capacity_mb = props_->GetProperty(
+            PROP_KEYSPACE_CAPACITY_MB + "." + table,
+            props_->GetProperty(PROP_KEYSPACE_CAPACITY_MB, PROP_KEYSPACE_CAPACITY_MB_DEFAULT));
+        kvssd::kvs_result ret = key_spaces->Create(
+            table, static_cast<uint64_t>(std::stod(capacity_mb) * 1024 * 1024));
+        if (ret != kvssd::kvs_result::KVS_ERR_KS_EXIST) {
+            kvssd_hashmap::CheckAPI(ret);
+        }
+        kvssd::KVSSD *handle;
+        kvssd_hashmap::CheckAPI(key_spaces->Open(table, handle));
+        opened.emplace(table, handle);
+        return *handle;
+    }
+
+    // Issues the pending batch, if any.
+    void Drain() {
+        if (batch) {
+            const std::lock_guard<std::mutex> lock(batch->mu);
+            if (batch->space) {
+                batch->rows.Flush(*batch->space);
+            }
+        }
+    }
+
+    static void FlushBatches() {
+        const std::lock_guard<std::mutex> lock(mu);
+        for (ClientBatch *client : batches) {
+            const std::lock_guard<std::mutex> client_lock(client->mu);
+            if (client->space) {
+                client->rows.Flush(*client->space);
+            }
+        }
+    }
+
+    // Runs read, which returns whether the row exists; if it does not while
+    // batches may hold it, issues them and runs read again.
+    template <typename F>
+    bool ReadThroughBatches(F read) {
+        if (read()) {
+            return true;
+        }
+        if (!batch) {
+            return false;
+        }
+        FlushBatches();
+        return read();
+    }
+
+    // Queues a write in this client's batch through queue, which adds it to
+    // the batch's rows and returns its tag.
+    template <typename F>
+    void *Batch(kvssd::KVSSD &space, F queue) {
+        const std::lock_guard<std::mutex> lock(batch->mu);
+        if (batch->space && batch->space != &space) {
+            batch->rows.Flush(*batch->space);
+        }
+        batch->space = &space;
+        return queue(batch->rows);
+    }
+
+    std::unique_ptr<AsyncOp> NewAsyncOp(kvssd::KVSSD &space, const std::string &key,
+                                        Callback callback) {
+        std::unique_ptr<AsyncOp> op;
+        if (free_async_ops.empty()) {
+            op = std::make_unique<AsyncOp>();
+        } else {
+            op = std::move(free_async_ops.back());
+            free_async_ops.pop_back();
+        }
+        op->callback = std::move(callback);
+        op->space = &space;
+        op->key = key;
+        op->result = nullptr;
+        return op;
+    }
+
+    void CompleteAsync(const kvssd::kvs_completion &completion) {
+        auto it = async_ops.find(completion.private_data);
+        std::unique_ptr<AsyncOp> op = std::move(it->second);
+        async_ops.erase(it);
+        kvssd::kvs_result ret = kvssd_hashmap::TryCompleteRow(completion, op->result);
+        ycsbc::DB::Status status = kOK;
+        if (completion.opcode == kvssd::kvs_opcode::READ &&
+            ret == kvssd::kvs_result::KVS_ERR_BUFFER_SMALL) {
+            bool found = kvssd_hashmap::TryReadRow(*op->space, op->key, *op->result, op->buffer);
+            status = found ? kOK : kNotFound;
+        } else if (completion.opcode == kvssd::kvs_opcode::READ &&
+                   ret == kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST) {
+            status = kNotFound;
+        } else {
+            kvssd_hashmap::CheckAPI(ret);
+        }
+        Callback callback = std::move(op->callback);
+        free_async_ops.push_back(std::move(op));
+        callback(status);
+    }
+
+    // Filter outcomes over the whole device; callers hold mu.
+    static bool GetFilterStats(kvssd::kvs_filter_stats &stats) {
+        stats = {};
+        if (kvssd) {
+            return SumFilterStats(*kvssd, stats);
+        }
+        bool any = false;
+        if (key_spaces) {
+            key_spaces->ForEach([&stats, &any](const std::string &, kvssd::KVSSD &space) {
+                any |= SumFilterStats(space, stats);
+            });
+        }
+        return any;
+    }
+
+    void PrintStats() {
+        bool memory = ycsbc::utils::StrToBool(
+            props_->GetProperty(PROP_PRINT_MEMORY, PROP_PRINT_MEMORY_DEFAULT));
+        bool io =
+            ycsbc::utils::StrToBool(props_->GetProperty(PROP_PRINT_IO, PROP_PRINT_IO_DEFAULT));
+        auto print = [memory, io](kvssd::KVSSD &space, const std::string &label) {
+            if (memory) {
+                PrintMemoryUsage(space, label);
+            }
+            if (io) {
+                PrintIoStats(space, label);
+            }
+        };
+        if (kvssd::kvs_filter_stats stats; GetFilterStats(stats)) {
+            std::cout << FilterStatusMsg(stats) << ", filter bytes: " << stats.memory_bytes
+                      << std::endl;
+        }
+        if (!key_spaces) {
+            print(*kvssd, "KVSSD");
+            return;
+        }
+        key_spaces->ForEach([&print](const std::string &name, kvssd::KVSSD &space) {
+            print(space, "KVSSD " + name);
+        });
+    }
 
    public:
-    explicit KvssdDbWrapper(kvssd::KVSSD *k) : kvssd(k) {};
+    void Init() final {
+        layout = NewFieldLayout(*props_);
+        if (size_t batch_size =
+                std::stoul(props_->GetProperty(PROP_BATCH_SIZE, PROP_BATCH_SIZE_DEFAULT));
+            batch_size > 1) {
+            batch = std::make_unique<ClientBatch>(batch_size);
+        }
+        const std::lock_guard<std::mutex> lock(mu);
+        if (batch) {
+            batches.insert(batch.get());
+        }
+        if (ref_cnt++) {
+            return;
+        }
+        std::shared_ptr<kvssd::TimingModel> timing = NewTimingModel(*props_);
+        const ycsbc::utils::Properties &props = *props_;
+        // A load phase builds the records itself and replaces the image.
+        std::string snapshot;
+        if (!ycsbc::utils::StrToBool(props.GetProperty("doload", "false"))) {
+            snapshot = props.GetProperty(PROP_SNAPSHOT_PATH, PROP_SNAPSHOT_PATH_DEFAULT);
+        }
+        kvssd::SnapshotWorkload workload = SnapshotWorkloadOf(props);
+        restored = false;
+        if (ycsbc::utils::StrToBool(props.GetProperty(PROP_KEYSPACES, PROP_KEYSPACES_DEFAULT))) {
+            key_spaces = std::make_unique<kvssd::KeySpaceTable>(
+                [&props, timing, snapshot, workload](const std::string &name) {
+                    std::unique_ptr<kvssd::KVSSD> space(NewKvssdBackend(props, timing, name));
+                    if (!snapshot.empty() &&
+                        RestoreSnapshot(*space, snapshot + "." + name, workload)) {
+                        restored = true;
+                    }
+                    return space;
+                });
+        } else {
+            kvssd.reset(NewKvssdBackend(props, timing));
+            if (!snapshot.empty()) {
+                restored = RestoreSnapshot(*kvssd, snapshot, workload);
+            }
+        }
+    }
+    void Cleanup() final {
+        Drain();
+        for (auto &[table, handle] : opened) {
+            kvssd_hashmap::CheckAPI(key_spaces->Close(handle));
+        }
+        opened.clear();
+        const std::lock_guard<std::mutex> lock(mu);
+        batches.erase(batch.get());
+        if (--ref_cnt) {
+            return;
+        }
+        PrintStats();
+        std::string snapshot =
+            props_->GetProperty(PROP_SNAPSHOT_PATH, PROP_SNAPSHOT_PATH_DEFAULT);
+        if (!snapshot.empty() && !restored) {
+            kvssd::SnapshotWorkload workload = SnapshotWorkloadOf(*props_);
+            if (key_spaces) {
+                key_spaces->ForEach(
+                    [&snapshot, &workload](const std::string &name, kvssd::KVSSD &space) {
+                        SaveSnapshot(space, snapshot + "." + name, workload);
+                    });
+            } else {
+                SaveSnapshot(*kvssd, snapshot, workload);
+            }
+        }
+        kvssd.reset();
+        key_spaces.reset();
+    }
+    std::string GetStatusMsg() final {
+        const std::lock_guard<std::mutex> lock(mu);
+        kvssd::kvs_filter_stats stats;
+        if (!GetFilterStats(stats)) {
+            return "";
+        }
+        return FilterStatusMsg(stats);
+    }
     ycsbc::DB::Status Read(const std::string &table, const std::string &key,
                            const std::vector<std::string> *fields,
                            std::vector<ycsbc::DB::Field> &result) final {
-        kvssd_hashmap::ReadRow(*this->kvssd, key, result);
-        return kOK;
+        kvssd::KVSSD &space = KeySpace(table);
+        if (batch) {
+            const std::lock_guard<std::mutex> lock(batch->mu);
+            if (batch->space == &space && batch->rows.Contains(key)) {
+                batch->rows.Flush(space);
+            }
+        }
+        if (layout && fields) {
+            bool found = ReadThroughBatches([&] {
+                return kvssd_hashmap::ReadFields(space, key, *layout, *fields, result,
+                                                 read_buffer);
+            });
+            return found ? kOK : kNotFound;
+        }
+        bool found = ReadThroughBatches(
+            [&] { return kvssd_hashmap::TryReadRow(space, key, result, read_buffer); });
+        return found ? kOK : kNotFound;
     }
     ycsbc::DB::Status Scan(const std::string &table, const std::string &key, int len,
                            const std::vector<std::string> *fields,
                            std::vector<std::vector<ycsbc::DB::Field>> &result) final {
-        return kNotImplemented;
+        kvssd::KVSSD &space = KeySpace(table);
+        Drain();
+        if (!kvssd_hashmap::ScanRows(space, key, len, result, scan_buffer, read_buffer)) {
+            return kNotImplemented;
+        }
+        return kOK;
     }
     ycsbc::DB::Status Update(const std::string &table, const std::string &key,
                              std::vector<ycsbc::DB::Field> &values) final {
-        kvssd_hashmap::UpdateRow(*this->kvssd, key, values);
+        kvssd::KVSSD &space = KeySpace(table);
+        Drain();
+        if (layout && values.size() < layout->FieldCount()) {
+            kvssd_hashmap::UpdateFields(space, key, *layout, values, read_buffer);
+            return kOK;
+        }
+        kvssd_hashmap::UpdateRow(space, key, values, layout.get());
         return kOK;
     }
     ycsbc::DB::Status Insert(const std::string &table, const std::string &key,
                              std::vector<ycsbc::DB::Field> &values) final {
-        kvssd_hashmap::InsertRow(*this->kvssd, key, values);
+        kvssd::KVSSD &space = KeySpace(table);
+        Drain();
+        kvssd_hashmap::InsertRow(space, key, values, layout.get());
         return kOK;
     }
     ycsbc::DB::Status Delete(const std::string &table, const std::string &key) final {
-        kvssd_hashmap::DeleteRow(*this->kvssd, key);
+        kvssd::KVSSD &space = KeySpace(table);
+        Drain();
+        kvssd_hashmap::DeleteRow(space, key);
         return kOK;
     }
+    bool SupportsAsync() final { return true; }
+    void ReadAsync(const std::string &table, const std::string &key,
+                   const std::vector<std::string> *fields, std::vector<ycsbc::DB::Field> &result,
+                   Callback callback) final {
+        if (batch || (layout && fields)) {
+            callback(Read(table, key, fields, result));
+            return;
+        }
+        kvssd::KVSSD &space = KeySpace(table);
+        std::unique_ptr<AsyncOp> op = NewAsyncOp(space, key, std::move(callback));
+        op->result = &result;
+        void *tag = kvssd_hashmap::SubmitReadRow(space, key, async_cq, op->buffer);
+        async_ops.emplace(tag, std::move(op));
+    }
+    void UpdateAsync(const std::string &table, const std::string &key,
+                     std::vector<ycsbc::DB::Field> &values, Callback callback) final {
+        if (layout && values.size() < layout->FieldCount()) {
+            callback(Update(table, key, values));
+            return;
+        }
+        kvssd::KVSSD &space = KeySpace(table);
+        std::unique_ptr<AsyncOp> op = NewAsyncOp(space, key, std::move(callback));
+        void *tag;
+        if (batch) {
+            tag = Batch(space, [&](kvssd_hashmap::RowBatch &rows) {
+                return rows.Store(space, key, values, async_cq, layout.get());
+            });
+        } else {
+            tag = kvssd_hashmap::SubmitUpdateRow(space, key, values, async_cq, layout.get());
+        }
+        async_ops.emplace(tag, std::move(op));
+    }
+    void InsertAsync(const std::string &table, const std::string &key,
+                     std::vector<ycsbc::DB::Field> &values, Callback callback) final {
+        kvssd::KVSSD &space = KeySpace(table);
+        std::unique_ptr<AsyncOp> op = NewAsyncOp(space, key, std::move(callback));
+        void *tag;
+        if (batch) {
+            tag = Batch(space, [&](kvssd_hashmap::RowBatch &rows) {
+                return rows.Insert(space, key, values, async_cq, layout.get());
+            });
+        } else {
+            tag = kvssd_hashmap::SubmitInsertRow(space, key, values, async_cq, layout.get());
+        }
+        async_ops.emplace(tag, std::move(op));
+    }
+    void DeleteAsync(const std::string &table, const std::string &key, Callback callback) final {
+        kvssd::KVSSD &space = KeySpace(table);
+        std::unique_ptr<AsyncOp> op = NewAsyncOp(space, key, std::move(callback));
+        void *tag;
+        if (batch) {
+            tag = Batch(space, [&](kvssd_hashmap::RowBatch &rows) {
+                return rows.Delete(space, key, async_cq);
+            });
+        } else {
+            tag = kvssd_hashmap::SubmitDeleteRow(space, key, async_cq);
+        }
+        async_ops.emplace(tag, std::move(op));
+    }
+    void Poll() final {
+        if (async_ops.empty()) {
+            return;
+        }
+        kvssd::kvs_completion completion;
+        if (!async_cq.TryPop(completion)) {
+            Drain();  // what waits in the batch completes once it is issued
+            completion = async_cq.Wait();
+        }
+        do {
+            CompleteAsync(completion);
+        } while (async_cq.TryPop(completion));
+    }
+    // Unlike Poll, leaves the batch pending for the writes due by deadline.
+    void PollUntil(std::chrono::steady_clock::time_point deadline) final {
+        kvssd::kvs_completion completion;
+        if (async_ops.empty() || !async_cq.WaitUntil(deadline, completion)) {
+            return;
+        }
+        do {
+            CompleteAsync(completion);
+        } while (async_cq.TryPop(completion));
+    }
 };
 
-ycsbc::DB *NewKvssdDB() {
-    std::string backend = PROP_BACKEND;
-    ycsbc::DB *ret = nullptr;
-    if (backend == "hashmap") {
-        kvssd::KVSSD *k = new kvssd_hashmap::Hashmap_KVSSD();
-        ret = new KvssdDbWrapper(k);
-    }
-    // TODO
-    //  if (backend == "kvssd") {
-    //      ret = new kvssd::KVSSD();
-    //  }
-    return ret;
-}
+std::unique_ptr<kvssd::KVSSD> KvssdDbWrapper::kvssd;
+std::unique_ptr<kvssd::KeySpaceTable> KvssdDbWrapper::key_spaces;
+int KvssdDbWrapper::ref_cnt = 0;
+std::mutex KvssdDbWrapper::mu;
+std::atomic<bool> KvssdDbWrapper::restored{false};
+std::set<KvssdDbWrapper::ClientBatch *> KvssdDbWrapper::batches;
+
+ycsbc::DB *NewKvssdDB() { return new KvssdDbWrapper(); }
 
 const bool registered = ycsbc::DBFactory::RegisterDB("kvssd", NewKvssdDB);
@@ -3,10 +3,16 @@
 
 #include <pthread.h>
 
+#include <array>
+#include <chrono>
 #include <condition_variable>
 #include <cstdint>
 #include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <optional>
+#include <string_view>
 #include <unordered_map>
 
 #include "core/db_factory.h"
@@ -91,15 +97,287 @@ struct kvs_value {
     uint32_t offset;             // [optional] device stored value offset (byte)
 };
 
+// Checks a request against the device limits in kvssd_const.h. Shared by all
+// emulator backends so they reject the same inputs with the same codes.
+inline kvs_result ValidateRequest(const kvs_key &key,
+                                  std::optional<std::reference_wrapper<const kvs_value>> value) {
+    if (key.length < KVS_MIN_KEY_LENGTH || KVS_MAX_KEY_LENGTH < key.length) {
+        return kvs_result::KVS_ERR_KEY_LENGTH_INVALID;
+    }
+    if (key.key == nullptr) {
+        return kvs_result::KVS_ERR_PARAM_INVALID;
+    }
+    if (value) {
+        if (value->get().length < KVS_MIN_VALUE_LENGTH ||
+            KVS_MAX_VALUE_LENGTH < value->get().length) {
+            return kvs_result::KVS_ERR_VALUE_LENGTH_INVALID;
+        }
+        if (value->get().offset & (KVS_ALIGNMENT_UNIT - 1)) {
+            return kvs_result::KVS_ERR_VALUE_OFFSET_MISALIGNED;
+        }
+        if (value->get().value == nullptr && value->get().length) {
+            return kvs_result::KVS_ERR_PARAM_INVALID;
+        }
+    }
+    return kvs_result::KVS_SUCCESS;
+}
+
+// Key group of an iterator: a key belongs to the group when its first four
+// bytes, masked with bitmask, equal bit_pattern. An all-zero filter selects
+// every key.
+struct kvs_key_group_filter {
+    uint8_t bitmask[4];
+    uint8_t bit_pattern[4];
+};
+
+using kvs_iterator_handle = uint32_t;
+
+// Caller-owned buffer filled by IteratorNext. Keys are packed back to back,
+// each as a uint32_t length followed by the key bytes.
+struct kvs_iterator_list {
+    void *it_list;         // key buffer's start address
+    uint32_t size;         // key buffer size (byte)
+    uint32_t num_entries;  // number of keys packed by the last call
+    bool end;              // no keys of the group follow this batch
+};
+
+// Memory held by an emulated device for its records, to compare the bytes
+// spent per record with a real device.
+struct kvs_memory_usage {
+    uint64_t records;
+    uint64_t key_bytes;        // sum of the stored key lengths
+    uint64_t value_bytes;      // sum of the stored value lengths
+    uint64_t allocated_bytes;  // memory reserved to hold them
+};
+
+// I/O done by a file-backed device, split into time waiting for the kernel
+// to complete requests (device) and time spent around them (host).
+struct kvs_io_stats {
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t read_device_ns;
+    uint64_t read_host_ns;
+    uint64_t write_device_ns;
+    uint64_t write_host_ns;
+};
+
+// Lookups answered by a negative-lookup filter: misses it ruled out without
+// touching the index, and misses it let through (false positives).
+struct kvs_filter_stats {
+    uint64_t negatives;
+    uint64_t false_positives;
+    uint64_t memory_bytes;
+};
+
+enum class kvs_opcode { READ, INSERT, UPDATE, DELETE };
+
+struct kvs_completion {
+    kvs_opcode opcode;
+    kvs_result result;
+    void *private_data;  // passed through unchanged from the submission
+};
+
+// Completions of asynchronous requests, filled by the device and drained by
+// the thread that submitted them. Usually one queue per client thread.
+class CompletionQueue {
+   public:
+    // Notifies under the lock: once the waiter sees the completion it may
+    // destroy the queue.
+    void Push(const kvs_completion &completion) {
+        std::lock_guard<std::mutex> lock(mu);
+        completions.push_back(completion);
+        cv.notify_one();
+    }
+    bool TryPop(kvs_completion &completion) {
+        std::lock_guard<std::mutex> lock(mu);
+        if (completions.empty()) {
+            return false;
+        }
+        completion = completions.front();
+        completions.pop_front();
+        return true;
+    }
+    kvs_completion Wait() {
+        std::unique_lock<std::mutex> lock(mu);
+        cv.wait(lock, [this] { return !completions.empty(); });
+        kvs_completion completion = completions.front();
+        completions.pop_front();
+        return completion;
+    }
+    // Like Wait, but returns false if nothing has completed by deadline.
+    bool WaitUntil(std::chrono::steady_clock::time_point deadline, kvs_completion &completion) {
+        std::unique_lock<std::mutex> lock(mu);
+        if (!cv.wait_until(lock, deadline, [this] { return !completions.empty(); })) {
+            return false;
+        }
+        completion = completions.front();
+        completions.pop_front();
+        return true;
+    }
+
+   private:
+    std::mutex mu;
+    std::condition_variable cv;
+    std::deque<kvs_completion> completions;
+};
+
 class KVSSD {
    public:
     KVSSD() = default;
     virtual ~KVSSD() = default;
 
+    // Read copies the stored value from offset on into the caller's buffer
+    // (value, length) and sets actual_value_size to the stored size. If the
+    // buffer is shorter than the rest of the value, nothing is copied and
+    // KVS_ERR_BUFFER_SMALL is returned.
     virtual kvs_result Read(const kvs_key &, kvs_value &) = 0;
     virtual kvs_result Insert(const kvs_key &, const kvs_value &) = 0;
     virtual kvs_result Update(const kvs_key &, const kvs_value &) = 0;
     virtual kvs_result Delete(const kvs_key &) = 0;
+
+    // Partial access to a stored value. ReadRange is Read for the range
+    // [offset, offset + length): it copies as much of it as the value holds
+    // instead of failing on a short buffer. UpdateRange overwrites the range,
+    // growing the value if the range runs past its end; its offset needs no
+    // alignment but must not lie beyond the end. Append writes at the end.
+    virtual kvs_result ReadRange(const kvs_key &, kvs_value &) {
+        return kvs_result::KVS_ERR_OPTION_INVALID;
+    }
+    virtual kvs_result UpdateRange(const kvs_key &, const kvs_value &) {
+        return kvs_result::KVS_ERR_OPTION_INVALID;
+    }
+    virtual kvs_result Append(const kvs_key &, const kvs_value &) {
+        return kvs_result::KVS_ERR_OPTION_INVALID;
+    }
+
+    // Asynchronous variants, modelled on kvs_retrieve_tuple_async and friends.
+    // A request that fails validation returns its error immediately; otherwise
+    // the outcome is pushed to cq. Key and value buffers must stay valid until
+    // then. Backends without a queue of their own complete the request inline.
+    virtual kvs_result ReadAsync(const kvs_key &key, kvs_value &value, CompletionQueue &cq,
+                                 void *private_data) {
+        if (kvs_result ret = ValidateRequest(key, value); ret != kvs_result::KVS_SUCCESS) {
+            return ret;
+        }
+        cq.Push({kvs_opcode::READ, Read(key, value), private_data});
+        return kvs_result::KVS_SUCCESS;
+    }
+    virtual kvs_result InsertAsync(const kvs_key &key, const kvs_value &value,
+                                   CompletionQueue &cq, void *private_data) {
+        if (kvs_result ret = ValidateRequest(key, value); ret != kvs_result::KVS_SUCCESS) {
+            return ret;
+        }
+        cq.Push({kvs_opcode::INSERT, Insert(key, value), private_data});
+        return kvs_result::KVS_SUCCESS;
+    }
+    virtual kvs_result UpdateAsync(const kvs_key &key, const kvs_value &value,
+                                   CompletionQueue &cq, void *private_data) {
+        if (kvs_result ret = ValidateRequest(key, value); ret != kvs_result::KVS_SUCCESS) {
+            return ret;
+        }
+        cq.Push({kvs_opcode::UPDATE, Update(key, value), private_data});
+        return kvs_result::KVS_SUCCESS;
+    }
+    virtual kvs_result DeleteAsync(const kvs_key &key, CompletionQueue &cq, void *private_data) {
+        if (kvs_result ret = ValidateRequest(key, std::nullopt); ret != kvs_result::KVS_SUCCESS) {
+            return ret;
+        }
+        cq.Push({kvs_opcode::DELETE, Delete(key), private_data});
+        return kvs_result::KVS_SUCCESS;
+    }
+
+    // Batch commands: num requests, the i-th on keys[i] (and values[i]),
+    // with its outcome in results[i]. BatchStore inserts keys that do not
+    // exist and updates the others; BatchInsert, like Insert, fails on keys
+    // that exist. A batch returns KVS_SUCCESS once it has
+    // been executed, whatever its requests' outcomes. The defaults issue the
+    // requests one by one; backends override them to pay per-command costs,
+    // such as taking the index lock, once per batch.
+    virtual kvs_result BatchRead(const kvs_key *keys, kvs_value *values, kvs_result *results,
+                                 size_t num) {
+        if (num && (keys == nullptr || values == nullptr || results == nullptr)) {
+            return kvs_result::KVS_ERR_PARAM_INVALID;
+        }
+        for (size_t i = 0; i < num; i++) {
+            results[i] = Read(keys[i], values[i]);
+        }
+        return kvs_result::KVS_SUCCESS;
+    }
+    virtual kvs_result BatchStore(const kvs_key *keys, const kvs_value *values,
+                                  kvs_result *results, size_t num) {
+        if (num && (keys == nullptr || values == nullptr || results == nullptr)) {
+            return kvs_result::KVS_ERR_PARAM_INVALID;
+        }
+        for (size_t i = 0; i < num; i++) {
+            results[i] = Update(keys[i], values[i]);
+            if (results[i] == kvs_result::KVS_ERR_KS_NOT_EXIST) {
+                results[i] = Insert(keys[i], values[i]);
+            }
+        }
+        return kvs_result::KVS_SUCCESS;
+    }
+    virtual kvs_result BatchInsert(const kvs_key *keys, const kvs_value *values,
+                                   kvs_result *results, size_t num) {
+        if (num && (keys == nullptr || values == nullptr || results == nullptr)) {
+            return kvs_result::KVS_ERR_PARAM_INVALID;
+        }
+        for (size_t i = 0; i < num; i++) {
+            results[i] = Insert(keys[i], values[i]);
+        }
+        return kvs_result::KVS_SUCCESS;
+    }
+    virtual kvs_result BatchDelete(const kvs_key *keys, kvs_result *results, size_t num) {
+        if (num && (keys == nullptr || results == nullptr)) {
+            return kvs_result::KVS_ERR_PARAM_INVALID;
+        }
+        for (size_t i = 0; i < num; i++) {
+            results[i] = Delete(keys[i]);
+        }
+        return kvs_result::KVS_SUCCESS;
+    }
+
+    // Snapshots (see kvssd_snapshot.h). ForEachRecord calls fn for every
+    // stored record. Restore stores num records read back from a snapshot
+    // like Insert, but without device time, and returns the first failure.
+    // Neither may run concurrently with writes.
+    using RecordVisitor = std::function<void(const kvs_key &, const kvs_value &)>;
+    virtual kvs_result ForEachRecord(const RecordVisitor &) {
+        return kvs_result::KVS_ERR_OPTION_INVALID;
+    }
+    virtual kvs_result Restore(const kvs_key *, const kvs_value *, size_t) {
+        return kvs_result::KVS_ERR_OPTION_INVALID;
+    }
+
+    // Caps the bytes of keys and values the device holds, the quota of a key
+    // space: writes that would take it over the cap fail with
+    // KVS_ERR_KS_CAPACITY. A capacity of 0 lifts the cap.
+    virtual kvs_result SetCapacity(uint64_t) { return kvs_result::KVS_ERR_OPTION_INVALID; }
+
+    virtual kvs_result GetMemoryUsage(kvs_memory_usage &) {
+        return kvs_result::KVS_ERR_OPTION_INVALID;
+    }
+
+    virtual kvs_result GetIoStats(kvs_io_stats &) { return kvs_result::KVS_ERR_OPTION_INVALID; }
+
+    virtual kvs_result GetFilterStats(kvs_filter_stats &) {
+        return kvs_result::KVS_ERR_OPTION_INVALID;
+    }
+
+    // Key-group iterators, modelled on kvs_open_iterator and friends. Keys are
+    // returned in ascending byte order, starting at start (inclusive) or at the
+    // first key of the group when start is null, as many per IteratorNext call
+    // as fit in the list buffer. Backends without an ordered index do not
+    // support them.
+    virtual kvs_result OpenIterator(const kvs_key_group_filter &, const kvs_key *start,
+                                    kvs_iterator_handle &) {
+        return kvs_result::KVS_ERR_OPTION_INVALID;
+    }
+    virtual kvs_result IteratorNext(kvs_iterator_handle, kvs_iterator_list &) {
+        return kvs_result::KVS_ERR_OPTION_INVALID;
+    }
+    virtual kvs_result CloseIterator(kvs_iterator_handle) {
+        return kvs_result::KVS_ERR_OPTION_INVALID;
+    }
 };
 
 }  // namespace kvssd
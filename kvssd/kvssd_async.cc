@@ -0,0 +1,74 @@
+#include "kvssd_async.h"
+
+#include "kvssd_hashmap_db.h"
+
+namespace kvssd {
+
+SubmissionQueue::SubmissionQueue(KVSSD &target, size_t num_workers)
+    : target(target),
+      num_workers(num_workers == 0 ? 1 : num_workers),
+      workers(new Worker[this->num_workers]) {
+    for (size_t i = 0; i < this->num_workers; i++) {
+        workers[i].thread = std::thread(&SubmissionQueue::Run, this, std::ref(workers[i]));
+    }
+}
+
+// Requests already queued are executed before the workers exit.
+SubmissionQueue::~SubmissionQueue() {
+    for (size_t i = 0; i < num_workers; i++) {
+        {
+            std::lock_guard<std::mutex> lock(workers[i].mu);
+            workers[i].stop = true;
+        }
+        workers[i].cv.notify_one();
+    }
+    for (size_t i = 0; i < num_workers; i++) {
+        workers[i].thread.join();
+    }
+}
+
+kvs_result SubmissionQueue::Submit(kvs_opcode opcode, const kvs_key &key, kvs_value *value,
+                                   CompletionQueue &cq, void *private_data) {
+    kvs_result ret = value ? ValidateRequest(key, *value) : ValidateRequest(key, std::nullopt);
+    if (ret != kvs_result::KVS_SUCCESS) {
+        return ret;
+    }
+    Worker &worker = workers[std::hash<kvs_key>{}(key) % num_workers];
+    {
+        std::lock_guard<std::mutex> lock(worker.mu);
+        worker.requests.push_back({opcode, &key, value, &cq, private_data});
+    }
+    worker.cv.notify_one();
+    return kvs_result::KVS_SUCCESS;
+}
+
+void SubmissionQueue::Run(Worker &worker) {
+    std::unique_lock<std::mutex> lock(worker.mu);
+    while (true) {
+        worker.cv.wait(lock, [&worker] { return worker.stop || !worker.requests.empty(); });
+        if (worker.requests.empty()) {
+            return;
+        }
+        Request request = worker.requests.front();
+        worker.requests.pop_front();
+        lock.unlock();
+        request.cq->Push({request.opcode, Execute(request), request.private_data});
+        lock.lock();
+    }
+}
+
+kvs_result SubmissionQueue::Execute(const Request &request) {
+    switch (request.opcode) {
+        case kvs_opcode::READ:
+            return target.Read(*request.key, *request.value);
+        case kvs_opcode::INSERT:
+            return target.Insert(*request.key, *request.value);
+        case kvs_opcode::UPDATE:
+            return target.Update(*request.key, *request.value);
+        case kvs_opcode::DELETE:
+            return target.Delete(*request.key);
+    }
+    return kvs_result::KVS_ERR_OPTION_INVALID;
+}
+
+}  // namespace kvssd
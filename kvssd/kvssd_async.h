@@ -0,0 +1,55 @@
+#ifndef YCSB_C_KVSSD_ASYNC_H_
+#define YCSB_C_KVSSD_ASYNC_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "kvssd.h"
+#include "kvssd_const.h"
+
+namespace kvssd {
+
+// Worker-thread pool that executes asynchronous requests against the blocking
+// API of a backend and posts the results to each request's CompletionQueue.
+// Requests are routed to a worker by key hash, so operations on one key
+// complete in submission order while different keys proceed in parallel.
+class SubmissionQueue {
+   public:
+    SubmissionQueue(KVSSD &target, size_t num_workers);
+    ~SubmissionQueue();
+
+    kvs_result Submit(kvs_opcode, const kvs_key &, kvs_value *, CompletionQueue &,
+                      void *private_data);
+
+   private:
+    struct Request {
+        kvs_opcode opcode;
+        const kvs_key *key;
+        kvs_value *value;
+        CompletionQueue *cq;
+        void *private_data;
+    };
+
+    struct alignas(KVS_CACHE_LINE_SIZE) Worker {
+        std::mutex mu;
+        std::condition_variable cv;
+        std::deque<Request> requests;
+        bool stop = false;
+        std::thread thread;
+    };
+
+    KVSSD &target;
+    size_t num_workers;
+    std::unique_ptr<Worker[]> workers;
+
+    void Run(Worker &);
+    kvs_result Execute(const Request &);
+};
+
+}  // namespace kvssd
+
+#endif  // YCSB_C_KVSSD_ASYNC_H_
@@ -7,5 +7,10 @@
 #define KVS_MAX_VALUE_LENGTH (2 * 1024 * 1024)
 #define KVS_ALIGNMENT_UNIT 512            /*value of KVS_ALIGNMENT_UNIT must be a power of 2 currently */
 #define KVS_VALUE_LENGTH_ALIGNMENT_UNIT 4 /*value of KV_VALUE_LENGTH_ALIGNMENT_UNIT must be a power of 2 currently */
+#define KVS_CACHE_LINE_SIZE 64
+#define KVS_MAX_ITERATE_HANDLE 256       /* one per client thread rather than the 16 of a real device */
+#define KVS_ITERATOR_BUFFER_SIZE (32 * 1024)
+#define KVS_MAX_KEY_SPACE_NAME_LENGTH 64
+#define KVS_MAX_KEY_SPACES 64
 
 #endif // KVS_CONST_H
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "kvssd_epoch.h"
+
+#include <cstdlib>
+
+#include "utils/utils.h"
+
+namespace kvssd_lockfree {
+
+EpochDomain &EpochDomain::Instance() {
+    // Never destroyed: thread_local states may outlive static destructors.
+    static EpochDomain *domain = new EpochDomain();
+    return *domain;
+}
+
+EpochDomain::ThreadState::~ThreadState() {
+    if (idx == MAX_PARTICIPANTS) {
+        return;
+    }
+    EpochDomain &domain = EpochDomain::Instance();
+    if (!retired.empty()) {
+        std::lock_guard<std::mutex> lock(domain.orphan_mu);
+        domain.orphans.insert(domain.orphans.end(), retired.begin(), retired.end());
+    }
+    domain.participants[idx].epoch.store(QUIESCENT);
+    domain.participants[idx].in_use.store(false);
+}
+
+EpochDomain::ThreadState &EpochDomain::Local() {
+    thread_local ThreadState state;
+    if (state.idx == MAX_PARTICIPANTS) {
+        state.idx = Register();
+    }
+    return state;
+}
+
+size_t EpochDomain::Register() {
+    for (size_t i = 0; i < MAX_PARTICIPANTS; i++) {
+        bool expected = false;
+        if (!participants[i].in_use.load(std::memory_order_relaxed) &&
+            participants[i].in_use.compare_exchange_strong(expected, true)) {
+            size_t hw = high_water.load();
+            while (hw < i + 1 && !high_water.compare_exchange_weak(hw, i + 1)) {
+            }
+            return i;
+        }
+    }
+    throw ycsbc::utils::Exception("kvssd: too many threads for epoch reclamation");
+}
+
+void EpochDomain::Enter() {
+    ThreadState &state = Local();
+    if (state.nesting++ == 0) {
+        // Sequentially consistent, like the table's pointer loads, so the
+        // announcement is ordered before them without a standalone fence.
+        participants[state.idx].epoch.store(global_epoch.load());
+    }
+}
+
+void EpochDomain::Exit() {
+    ThreadState &state = Local();
+    if (--state.nesting == 0) {
+        participants[state.idx].epoch.store(QUIESCENT, std::memory_order_release);
+    }
+}
+
+void EpochDomain::Retire(void *ptr) {
+    ThreadState &state = Local();
+    state.retired.push_back({global_epoch.load(), ptr});
+    if (state.retired.size() >= COLLECT_THRESHOLD) {
+        TryAdvance();
+        Collect(state.retired);
+    }
+}
+
+// The global epoch moves forward only once every pinned thread has observed
+// it, so anything retired two epochs ago is unreachable.
+void EpochDomain::TryAdvance() {
+    uint64_t epoch = global_epoch.load();
+    size_t n = high_water.load();
+    for (size_t i = 0; i < n; i++) {
+        uint64_t local = participants[i].epoch.load();
+        if (local != QUIESCENT && local != epoch) {
+            return;
+        }
+    }
+    global_epoch.compare_exchange_strong(epoch, epoch + 1);
+}
+
+void EpochDomain::Collect(std::vector<Retired> &retired) {
+    if (orphan_mu.try_lock()) {
+        retired.insert(retired.end(), orphans.begin(), orphans.end());
+        orphans.clear();
+        orphan_mu.unlock();
+    }
+    uint64_t epoch = global_epoch.load();
+    size_t kept = 0;
+    for (Retired &r : retired) {
+        if (r.epoch + 2 <= epoch) {
+            free(r.ptr);
+        } else {
+            retired[kept++] = r;
+        }
+    }
+    retired.resize(kept);
+}
+
+}  // namespace kvssd_lockfree
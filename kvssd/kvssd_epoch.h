@@ -0,0 +1,73 @@
+#ifndef YCSB_C_KVSSD_EPOCH_H_
+#define YCSB_C_KVSSD_EPOCH_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "kvssd_const.h"
+
+namespace kvssd_lockfree {
+
+// Process-wide epoch-based reclamation. Readers pin the current epoch with a
+// Guard; memory passed to Retire() is free()d only after every thread that
+// was pinned when it was unlinked has left its critical section.
+class EpochDomain {
+   public:
+    static EpochDomain &Instance();
+
+    class Guard {
+       public:
+        Guard() { EpochDomain::Instance().Enter(); }
+        ~Guard() { EpochDomain::Instance().Exit(); }
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+    };
+
+    void Enter();
+    void Exit();
+    void Retire(void *ptr);
+
+   private:
+    static constexpr size_t MAX_PARTICIPANTS = 1024;
+    static constexpr size_t COLLECT_THRESHOLD = 128;
+    static constexpr uint64_t QUIESCENT = 0;
+
+    struct alignas(KVS_CACHE_LINE_SIZE) Participant {
+        std::atomic<uint64_t> epoch{QUIESCENT};
+        std::atomic<bool> in_use{false};
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        void *ptr;
+    };
+
+    struct ThreadState {
+        size_t idx = MAX_PARTICIPANTS;
+        size_t nesting = 0;
+        std::vector<Retired> retired;
+        ~ThreadState();
+    };
+
+    EpochDomain() = default;
+
+    ThreadState &Local();
+    size_t Register();
+    void TryAdvance();
+    void Collect(std::vector<Retired> &);
+
+    std::atomic<uint64_t> global_epoch{1};
+    std::atomic<size_t> high_water{0};
+    Participant participants[MAX_PARTICIPANTS];
+
+    // Garbage left behind by exited threads, adopted by the next collector.
+    std::mutex orphan_mu;
+    std::vector<Retired> orphans;
+};
+
+}  // namespace kvssd_lockfree
+
+#endif  // YCSB_C_KVSSD_EPOCH_H_
@@ -0,0 +1,494 @@
+#include "kvssd_file_db.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "utils/utils.h"
+
+namespace kvssd_file {
+
+File_KVSSD::File_KVSSD(const std::string &path, bool destroy, double gc_threshold,
+                       const std::string &io_engine, bool direct_io)
+    : path(path), gc_threshold(gc_threshold), direct_io(direct_io) {
+    pthread_rwlock_init(&rwl, nullptr);
+    fd = open(path.c_str(), O_RDWR | O_CREAT | (destroy ? O_TRUNC : 0), 0644);
+    int engine_fd = fd < 0 ? -1 : OpenEngineFile();
+    if (engine_fd < 0) {
+        int err = errno;
+        if (fd >= 0) {
+            close(fd);
+        }
+        pthread_rwlock_destroy(&rwl);
+        throw ycsbc::utils::Exception("Cannot open kvssd log " + path + ": " +
+                                      std::strerror(err));
+    }
+    try {
+        engine = NewIoEngine(io_engine, engine_fd, direct_io);
+        Recover();
+        gc_thread = std::thread(&File_KVSSD::CompactInBackground, this);
+    } catch (...) {
+        engine.reset();
+        close(fd);
+        pthread_rwlock_destroy(&rwl);
+        throw;
+    }
+}
+
+File_KVSSD::~File_KVSSD() {
+    {
+        std::lock_guard<std::mutex> lock(gc_mu);
+        gc_stop = true;
+    }
+    gc_cv.notify_one();
+    gc_thread.join();
+    engine.reset();
+    close(fd);
+    pthread_rwlock_destroy(&rwl);
+}
+
+int File_KVSSD::OpenEngineFile() const {
+    return open(path.c_str(), O_RDWR | (direct_io ? O_DIRECT : 0));
+}
+
+uint64_t File_KVSSD::RecordSize(uint16_t key_length, uint32_t value_length) {
+    uint64_t size = sizeof(RecordHeader) + key_length + value_length;
+    return (size + KVS_ALIGNMENT_UNIT - 1) & ~uint64_t{KVS_ALIGNMENT_UNIT - 1};
+}
+
+// FNV-1a, 32 bits.
+uint32_t File_KVSSD::Checksum(const char *data, size_t length) {
+    uint32_t hash = 0x811c9dc5;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+bool File_KVSSD::ReadAt(int file, void *buf, size_t length, uint64_t offset) {
+    auto *p = static_cast<char *>(buf);
+    while (length > 0) {
+        ssize_t n = pread(file, p, length, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        length -= n;
+        offset += n;
+    }
+    return true;
+}
+
+bool File_KVSSD::WriteAt(int file, const void *buf, size_t length, uint64_t offset) {
+    const auto *p = static_cast<const char *>(buf);
+    while (length > 0) {
+        ssize_t n = pwrite(file, p, length, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        length -= n;
+        offset += n;
+    }
+    return true;
+}
+
+// Replays the log in append order. The first record that is incomplete or
+// fails its checksum is a torn write of the previous run; it and everything
+// after it are cut off.
+void File_KVSSD::Recover() {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        throw ycsbc::utils::Exception("Cannot stat kvssd log " + path);
+    }
+    auto size = static_cast<uint64_t>(st.st_size);
+    uint64_t offset = 0;
+    std::vector<char> data;
+    while (offset + sizeof(RecordHeader) <= size) {
+        RecordHeader header;
+        if (!ReadAt(fd, &header, sizeof(header), offset) || header.magic != RECORD_MAGIC ||
+            header.key_length < KVS_MIN_KEY_LENGTH || KVS_MAX_KEY_LENGTH < header.key_length ||
+            KVS_MAX_VALUE_LENGTH < header.value_length) {
+            break;
+        }
+        uint64_t record_size = RecordSize(header.key_length, header.value_length);
+        size_t data_length = header.key_length + header.value_length;
+        data.resize(data_length);
+        if (size < offset + record_size ||
+            !ReadAt(fd, data.data(), data_length, offset + sizeof(header)) ||
+            Checksum(data.data(), data_length) != header.checksum) {
+            break;
+        }
+
+        kvssd::kvs_key key{data.data(), header.key_length};
+        auto it = db.find(key);
+        if (it != db.end()) {
+            garbage += RecordSize(key.length, it->second.value_length);
+        }
+        if (header.flags & FLAG_TOMBSTONE) {
+            garbage += record_size;
+            if (it != db.end()) {
+                UnindexKey(it);
+            }
+        } else if (it != db.end()) {
+            it->second = {offset, header.value_length};
+        } else {
+            IndexKey(key, {offset, header.value_length});
+        }
+        offset += record_size;
+    }
+    if (offset < size && ftruncate(fd, static_cast<off_t>(offset)) != 0) {
+        throw ycsbc::utils::Exception("Cannot truncate kvssd log " + path);
+    }
+    tail = offset;
+}
+
+void File_KVSSD::IndexKey(const kvssd::kvs_key &key, const Location &location) {
+    kvssd::kvs_key key_copy{key_slab.Allocate(key.length), key.length};
+    std::memcpy(key_copy.key, key.key, key.length);
+    db.emplace(key_copy, location);
+    index.emplace(static_cast<const char *>(key_copy.key), key_copy.length);
+}
+
+void File_KVSSD::UnindexKey(std::unordered_map<kvssd::kvs_key, Location>::iterator it) {
+    kvssd::kvs_key stored_key = it->first;
+    index.erase(std::string_view(static_cast<const char *>(stored_key.key), stored_key.length));
+    db.erase(it);
+    key_slab.Free(stored_key.key, stored_key.length);
+}
+
+// Appends a record for key, or a tombstone when value is null. Called with
+// the write lock held.
+kvssd::kvs_result File_KVSSD::Append(const kvssd::kvs_key &key, const kvssd::kvs_value *value,
+                                     uint64_t &offset) {
+    uint32_t value_length = value ? value->length : 0;
+    uint64_t record_size = RecordSize(key.length, value_length);
+    write_buffer.assign(record_size, 0);
+    char *data = write_buffer.data() + sizeof(RecordHeader);
+    std::memcpy(data, key.key, key.length);
+    if (value_length) {
+        std::memcpy(data + key.length, value->value, value_length);
+    }
+    RecordHeader header{RECORD_MAGIC, Checksum(data, key.length + value_length), value_length,
+                        key.length, static_cast<uint16_t>(value ? 0 : FLAG_TOMBSTONE)};
+    std::memcpy(write_buffer.data(), &header, sizeof(header));
+
+    if (!engine->Write(write_buffer.data(), record_size, tail)) {
+        return kvssd::kvs_result::KVS_ERR_SYS_IO;
+    }
+    offset = tail;
+    tail += record_size;
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+// API Functions
+kvssd::kvs_result File_KVSSD::Read(const kvssd::kvs_key &key, kvssd::kvs_value &value_out) {
+    if (kvssd::kvs_result ret = kvssd::ValidateRequest(key, value_out);
+        ret != kvssd::kvs_result::KVS_SUCCESS) {
+        return ret;
+    }
+    // The read lock also keeps compaction from swapping the file underneath.
+    pthread_rwlock_rdlock(&rwl);
+    auto it = db.find(key);
+    if (it == db.end()) {
+        pthread_rwlock_unlock(&rwl);
+        return kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST;
+    }
+    Location location = it->second;
+    value_out.actual_value_size = location.value_length;
+    if (location.value_length < value_out.offset) {
+        pthread_rwlock_unlock(&rwl);
+        return kvssd::kvs_result::KVS_ERR_VALUE_OFFSET_INVALID;
+    }
+    uint32_t rest = location.value_length - value_out.offset;
+    if (value_out.length < rest) {
+        pthread_rwlock_unlock(&rwl);
+        return kvssd::kvs_result::KVS_ERR_BUFFER_SMALL;
+    }
+    bool ok = rest == 0 ||
+              engine->Read(value_out.value, rest,
+                           location.offset + sizeof(RecordHeader) + key.length + value_out.offset);
+    pthread_rwlock_unlock(&rwl);
+    return ok ? kvssd::kvs_result::KVS_SUCCESS : kvssd::kvs_result::KVS_ERR_SYS_IO;
+}
+
+kvssd::kvs_result File_KVSSD::Insert(const kvssd::kvs_key &key, const kvssd::kvs_value &value) {
+    if (kvssd::kvs_result ret = kvssd::ValidateRequest(key, value);
+        ret != kvssd::kvs_result::KVS_SUCCESS) {
+        return ret;
+    }
+    pthread_rwlock_wrlock(&rwl);
+    if (db.find(key) != db.end()) {
+        pthread_rwlock_unlock(&rwl);
+        return kvssd::kvs_result::KVS_ERR_KS_EXIST;
+    }
+    uint64_t offset;
+    kvssd::kvs_result ret = Append(key, &value, offset);
+    if (ret == kvssd::kvs_result::KVS_SUCCESS) {
+        IndexKey(key, {offset, value.length});
+    }
+    pthread_rwlock_unlock(&rwl);
+    return ret;
+}
+
+kvssd::kvs_result File_KVSSD::Update(const kvssd::kvs_key &key, const kvssd::kvs_value &value) {
+    if (kvssd::kvs_result ret = kvssd::ValidateRequest(key, value);
+        ret != kvssd::kvs_result::KVS_SUCCESS) {
+        return ret;
+    }
+    pthread_rwlock_wrlock(&rwl);
+    auto it = db.find(key);
+    if (it == db.end()) {
+        pthread_rwlock_unlock(&rwl);
+        return kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST;
+    }
+    uint64_t offset;
+    kvssd::kvs_result ret = Append(key, &value, offset);
+    if (ret == kvssd::kvs_result::KVS_SUCCESS) {
+        garbage += RecordSize(key.length, it->second.value_length);
+        it->second = {offset, value.length};
+        MaybeCompact();
+    }
+    pthread_rwlock_unlock(&rwl);
+    return ret;
+}
+
+kvssd::kvs_result File_KVSSD::Delete(const kvssd::kvs_key &key) {
+    if (kvssd::kvs_result ret = kvssd::ValidateRequest(key, std::nullopt);
+        ret != kvssd::kvs_result::KVS_SUCCESS) {
+        return ret;
+    }
+    pthread_rwlock_wrlock(&rwl);
+    auto it = db.find(key);
+    if (it == db.end()) {
+        pthread_rwlock_unlock(&rwl);
+        return kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST;
+    }
+    uint64_t offset;
+    kvssd::kvs_result ret = Append(key, nullptr, offset);
+    if (ret == kvssd::kvs_result::KVS_SUCCESS) {
+        garbage += RecordSize(key.length, it->second.value_length) + RecordSize(key.length, 0);
+        UnindexKey(it);
+        MaybeCompact();
+    }
+    pthread_rwlock_unlock(&rwl);
+    return ret;
+}
+
+kvssd::kvs_result File_KVSSD::OpenIterator(const kvssd::kvs_key_group_filter &filter,
+                                           const kvssd::kvs_key *start,
+                                           kvssd::kvs_iterator_handle &handle) {
+    return iterators.Open(filter, start, handle);
+}
+
+kvssd::kvs_result File_KVSSD::IteratorNext(kvssd::kvs_iterator_handle handle,
+                                           kvssd::kvs_iterator_list &list) {
+    return iterators.Next(handle, list,
+                          [this](const kvssd::IteratorTable::Cursor &cursor, size_t budget,
+                                 std::vector<std::string> &keys) {
+                              return CollectKeys(cursor, budget, keys);
+                          });
+}
+
+kvssd::kvs_result File_KVSSD::CloseIterator(kvssd::kvs_iterator_handle handle) {
+    return iterators.Close(handle);
+}
+
+bool File_KVSSD::CollectKeys(const kvssd::IteratorTable::Cursor &cursor, size_t budget,
+                             std::vector<std::string> &keys) {
+    pthread_rwlock_rdlock(&rwl);
+    auto it = cursor.inclusive ? index.lower_bound(cursor.position)
+                               : index.upper_bound(cursor.position);
+    size_t used = 0;
+    for (; it != index.end(); ++it) {
+        if (!kvssd::MatchesFilter(cursor.filter, *it)) {
+            continue;
+        }
+        size_t entry = sizeof(uint32_t) + it->size();
+        if (budget < used + entry && !keys.empty()) {
+            break;
+        }
+        keys.emplace_back(*it);
+        used += entry;
+    }
+    bool exhausted = it == index.end();
+    pthread_rwlock_unlock(&rwl);
+    return exhausted;
+}
+
+
+void File_KVSSD::Reserve(size_t records, float max_load_factor) {
+    pthread_rwlock_wrlock(&rwl);
+    if (max_load_factor > 0) {
+        db.max_load_factor(max_load_factor);
+    }
+    db.reserve(records);
+    pthread_rwlock_unlock(&rwl);
+}
+
+kvssd::kvs_result File_KVSSD::GetIoStats(kvssd::kvs_io_stats &stats) {
+    stats = engine->Stats();
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+uint64_t File_KVSSD::LogSize() {
+    pthread_rwlock_rdlock(&rwl);
+    uint64_t size = tail;
+    pthread_rwlock_unlock(&rwl);
+    return size;
+}
+
+uint64_t File_KVSSD::GarbageBytes() {
+    pthread_rwlock_rdlock(&rwl);
+    uint64_t bytes = garbage;
+    pthread_rwlock_unlock(&rwl);
+    return bytes;
+}
+
+// Copies the records in [from, to) of the log to gc_fd in log order, so that
+// the old log is read sequentially, and notes where each one moved. With
+// live_only, only records that the index still points at are copied, checked
+// one at a time under the read lock. Called without the lock: the records
+// below the tail do not change.
+bool File_KVSSD::CopyRecords(int gc_fd, uint64_t from, uint64_t to, bool live_only,
+                             uint64_t &gc_tail, std::unordered_map<uint64_t, uint64_t> &moved) {
+    std::vector<char> record;
+    for (uint64_t offset = from; offset < to;) {
+        RecordHeader header;
+        if (!ReadAt(fd, &header, sizeof(header), offset)) {
+            return false;
+        }
+        uint64_t record_size = RecordSize(header.key_length, header.value_length);
+        record.resize(record_size);
+        if (!ReadAt(fd, record.data(), record_size, offset)) {
+            return false;
+        }
+        bool copy = !live_only;
+        if (live_only && !(header.flags & FLAG_TOMBSTONE)) {
+            kvssd::kvs_key key{record.data() + sizeof(header), header.key_length};
+            pthread_rwlock_rdlock(&rwl);
+            auto it = db.find(key);
+            copy = it != db.end() && it->second.offset == offset;
+            pthread_rwlock_unlock(&rwl);
+        }
+        if (copy) {
+            if (!WriteAt(gc_fd, record.data(), record_size, gc_tail)) {
+                return false;
+            }
+            moved.emplace(offset, gc_tail);
+            gc_tail += record_size;
+        }
+        offset += record_size;
+    }
+    return true;
+}
+
+// Copies the live records into a new log, then the records appended in the
+// meantime, the last of them under the write lock, and renames the new log
+// over the old one. The index only moves to the new offsets once the rename
+// succeeded, so a failed compaction leaves the old log in use.
+kvssd::kvs_result File_KVSSD::Compact() {
+    const std::lock_guard<std::mutex> compact_lock(compact_mu);
+    std::string gc_path = path + ".gc";
+    int gc_fd = open(gc_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (gc_fd < 0) {
+        return kvssd::kvs_result::KVS_ERR_SYS_IO;
+    }
+    std::unordered_map<uint64_t, uint64_t> moved;  // old offset -> new offset
+    uint64_t gc_tail = 0;
+    pthread_rwlock_rdlock(&rwl);
+    uint64_t copied = tail;
+    moved.reserve(db.size());
+    pthread_rwlock_unlock(&rwl);
+    bool ok = CopyRecords(gc_fd, 0, copied, true, gc_tail, moved);
+    while (ok) {
+        pthread_rwlock_rdlock(&rwl);
+        uint64_t end = tail;
+        pthread_rwlock_unlock(&rwl);
+        if (end - copied < GC_CATCH_UP_BYTES) {
+            break;
+        }
+        ok = CopyRecords(gc_fd, copied, end, false, gc_tail, moved);
+        copied = end;
+    }
+
+    pthread_rwlock_wrlock(&rwl);
+    ok = ok && CopyRecords(gc_fd, copied, tail, false, gc_tail, moved) && fsync(gc_fd) == 0 &&
+         std::rename(gc_path.c_str(), path.c_str()) == 0;
+    if (!ok) {
+        pthread_rwlock_unlock(&rwl);
+        close(gc_fd);
+        unlink(gc_path.c_str());
+        return kvssd::kvs_result::KVS_ERR_SYS_IO;
+    }
+    close(fd);
+    fd = gc_fd;
+    int engine_fd = OpenEngineFile();
+    if (engine_fd < 0) {
+        engine_fd = dup(gc_fd);  // falls back to buffered I/O rather than losing the log
+    }
+    engine->SetFile(engine_fd);
+    // Every live record was copied: those below the first tail were live when
+    // checked, and everything after it was copied as is.
+    uint64_t live = 0;
+    for (auto &[key, location] : db) {
+        location.offset = moved.at(location.offset);
+        live += RecordSize(key.length, location.value_length);
+    }
+    tail = gc_tail;
+    garbage = gc_tail - live;
+    pthread_rwlock_unlock(&rwl);
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+// Called with the write lock held; wakes the compaction thread unless a
+// compaction failed recently.
+void File_KVSSD::MaybeCompact() {
+    if (tail < GC_MIN_LOG_SIZE || garbage <= gc_threshold * static_cast<double>(tail)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(gc_mu);
+        if (gc_requested || std::chrono::steady_clock::now() < gc_retry_at) {
+            return;
+        }
+        gc_requested = true;
+    }
+    gc_cv.notify_one();
+}
+
+void File_KVSSD::CompactInBackground() {
+    std::unique_lock<std::mutex> lock(gc_mu);
+    while (true) {
+        gc_cv.wait(lock, [this] { return gc_stop || gc_requested; });
+        if (gc_stop) {
+            return;
+        }
+        lock.unlock();
+        kvssd::kvs_result ret = Compact();
+        lock.lock();
+        if (ret == kvssd::kvs_result::KVS_SUCCESS) {
+            gc_failures = 0;
+        } else {
+            auto backoff = GC_MIN_BACKOFF * (1 << std::min(gc_failures, 6));
+            gc_retry_at = std::chrono::steady_clock::now() + std::min(backoff, GC_MAX_BACKOFF);
+            gc_failures++;
+        }
+        gc_requested = false;
+    }
+}
+
+}  // namespace kvssd_file
@@ -0,0 +1,143 @@
+#ifndef YCSB_C_KVSSD_FILE_DB_H_
+#define YCSB_C_KVSSD_FILE_DB_H_
+
+#include <pthread.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "kvssd.h"
+#include "kvssd_const.h"
+#include "kvssd_hashmap_db.h"
+#include "kvssd_io_engine.h"
+#include "kvssd_iterator.h"
+#include "kvssd_slab.h"
+
+namespace kvssd_file {
+
+// Persistent emulator: every write appends a record, aligned to
+// KVS_ALIGNMENT_UNIT, to a single log file, and an in-memory hash index maps
+// each key to its latest record. Deletions append a tombstone. Reopening a
+// log replays it to rebuild the index, so load and run phases can be
+// separate processes. Once overwritten and deleted records make up more than
+// gc_threshold of the log, a background thread compacts it into a new file
+// while clients keep reading and writing; a failed compaction is retried
+// after a backoff.
+class File_KVSSD : public kvssd::KVSSD {
+   public:
+    // Opens or creates the log at path; destroy discards an existing one.
+    // Reads and appends go through io_engine (see NewIoEngine), with O_DIRECT
+    // if direct_io is set. Throws ycsbc::utils::Exception if the log cannot
+    // be opened.
+    File_KVSSD(const std::string &path, bool destroy, double gc_threshold,
+               const std::string &io_engine = "psync", bool direct_io = false);
+    ~File_KVSSD() final;
+
+    kvssd::kvs_result Read(const kvssd::kvs_key &, kvssd::kvs_value &) final;
+    kvssd::kvs_result Insert(const kvssd::kvs_key &, const kvssd::kvs_value &) final;
+    kvssd::kvs_result Update(const kvssd::kvs_key &, const kvssd::kvs_value &) final;
+    kvssd::kvs_result Delete(const kvssd::kvs_key &) final;
+
+    kvssd::kvs_result GetIoStats(kvssd::kvs_io_stats &) final;
+
+    kvssd::kvs_result OpenIterator(const kvssd::kvs_key_group_filter &, const kvssd::kvs_key *,
+                                   kvssd::kvs_iterator_handle &) final;
+    kvssd::kvs_result IteratorNext(kvssd::kvs_iterator_handle, kvssd::kvs_iterator_list &) final;
+    kvssd::kvs_result CloseIterator(kvssd::kvs_iterator_handle) final;
+
+    // See Hashmap_KVSSD::Reserve.
+    void Reserve(size_t records, float max_load_factor);
+
+    // Rewrites the live records into a new log, dropping the garbage. Writes
+    // only wait for the records appended during the copy and the switch to
+    // the new log.
+    kvssd::kvs_result Compact();
+
+    uint64_t LogSize();
+    uint64_t GarbageBytes();
+
+   private:
+    static constexpr uint32_t RECORD_MAGIC = 0x4b565331;  // "KVS1"
+    static constexpr uint16_t FLAG_TOMBSTONE = 1;
+    // Logs smaller than this are never compacted.
+    static constexpr uint64_t GC_MIN_LOG_SIZE = 1 << 20;
+    // Records appended during a compaction are copied without the lock until
+    // fewer than this many bytes remain, which are copied under it.
+    static constexpr uint64_t GC_CATCH_UP_BYTES = 1 << 20;
+    // Backoff after a failed compaction, doubling up to the maximum.
+    static constexpr std::chrono::seconds GC_MIN_BACKOFF{1};
+    static constexpr std::chrono::seconds GC_MAX_BACKOFF{64};
+
+    // On-disk record: header, key, value, zero padding up to the alignment.
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t checksum;  // of key and value
+        uint32_t value_length;
+        uint16_t key_length;
+        uint16_t flags;
+    };
+
+    struct Location {
+        uint64_t offset;
+        uint32_t value_length;
+    };
+
+    std::string path;
+    // Buffered descriptor for replay and compaction; the engine has its own.
+    int fd = -1;
+    std::unique_ptr<IoEngine> engine;
+    double gc_threshold;
+    bool direct_io;
+    uint64_t tail = 0;     // end of the log
+    uint64_t garbage = 0;  // bytes of records that no longer hold a live value
+
+    std::unordered_map<kvssd::kvs_key, Location> db;
+    std::set<std::string_view> index;
+    kvssd::SlabAllocator key_slab{alignof(std::max_align_t)};
+    pthread_rwlock_t rwl;
+    kvssd::IteratorTable iterators;
+    std::vector<char> write_buffer;  // guarded by the write lock
+
+    // Serializes compactions; fd only changes under it and the write lock.
+    std::mutex compact_mu;
+    // The background compaction thread and its state.
+    std::mutex gc_mu;
+    std::condition_variable gc_cv;
+    bool gc_requested = false;
+    bool gc_stop = false;
+    int gc_failures = 0;
+    std::chrono::steady_clock::time_point gc_retry_at;
+    std::thread gc_thread;
+
+    static uint64_t RecordSize(uint16_t key_length, uint32_t value_length);
+    static uint32_t Checksum(const char *data, size_t length);
+
+    bool ReadAt(int file, void *buf, size_t length, uint64_t offset);
+    bool WriteAt(int file, const void *buf, size_t length, uint64_t offset);
+    int OpenEngineFile() const;
+
+    void Recover();
+    kvssd::kvs_result Append(const kvssd::kvs_key &, const kvssd::kvs_value *, uint64_t &offset);
+    void IndexKey(const kvssd::kvs_key &, const Location &);
+    void UnindexKey(std::unordered_map<kvssd::kvs_key, Location>::iterator);
+    bool CopyRecords(int gc_fd, uint64_t from, uint64_t to, bool live_only, uint64_t &gc_tail,
+                     std::unordered_map<uint64_t, uint64_t> &moved);
+    void MaybeCompact();
+    void CompactInBackground();
+    bool CollectKeys(const kvssd::IteratorTable::Cursor &, size_t budget,
+                     std::vector<std::string> &keys);
+};
+
+}  // namespace kvssd_file
+
+#endif  // YCSB_C_KVSSD_FILE_DB_H_
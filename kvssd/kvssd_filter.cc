@@ -0,0 +1,88 @@
+#include "kvssd_filter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace kvssd {
+
+CountingBloomFilter::CountingBloomFilter(size_t expected_keys, double counters_per_key)
+    : num_blocks(std::max<size_t>(
+          1, static_cast<size_t>(std::ceil(std::max<size_t>(expected_keys, 1) *
+                                           std::max(counters_per_key, 1.0) / COUNTERS_PER_BLOCK)))),
+      probes(std::clamp<size_t>(std::lround(counters_per_key * std::log(2.0)), 1, 8)),
+      blocks(new Block[num_blocks]),
+      stats(new StatStripe[STAT_STRIPES]) {
+    for (size_t i = 0; i < num_blocks; i++) {
+        for (std::atomic<uint64_t> &word : blocks[i].words) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+// The map buckets and the shards use the raw hash, so it is remixed before
+// picking a block; the probes step through the block by double hashing.
+template <typename F>
+void CountingBloomFilter::ForEachCounter(size_t key_hash, F fn) const {
+    uint64_t h = key_hash;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    Block &block = blocks[((h >> 32) * num_blocks) >> 32];
+    uint32_t position = static_cast<uint32_t>(h);
+    uint32_t step = (position >> 16) | 1;
+    for (size_t i = 0; i < probes; i++) {
+        size_t counter = position % COUNTERS_PER_BLOCK;
+        fn(block.words[counter / COUNTERS_PER_WORD], (counter % COUNTERS_PER_WORD) * 4);
+        position += step;
+    }
+}
+
+bool CountingBloomFilter::MayContain(size_t key_hash) const {
+    bool present = true;
+    ForEachCounter(key_hash, [&present](std::atomic<uint64_t> &word, size_t shift) {
+        if (((word.load(std::memory_order_acquire) >> shift) & COUNTER_MAX) == 0) {
+            present = false;
+        }
+    });
+    return present;
+}
+
+// Writers are serialized, so a load and a store update a counter; the
+// release store orders it before the index change that follows.
+void CountingBloomFilter::Add(size_t key_hash) {
+    ForEachCounter(key_hash, [](std::atomic<uint64_t> &word, size_t shift) {
+        uint64_t w = word.load(std::memory_order_relaxed);
+        if (((w >> shift) & COUNTER_MAX) < COUNTER_MAX) {
+            word.store(w + (uint64_t{1} << shift), std::memory_order_release);
+        }
+    });
+}
+
+void CountingBloomFilter::Remove(size_t key_hash) {
+    ForEachCounter(key_hash, [](std::atomic<uint64_t> &word, size_t shift) {
+        uint64_t w = word.load(std::memory_order_relaxed);
+        uint64_t count = (w >> shift) & COUNTER_MAX;
+        if (0 < count && count < COUNTER_MAX) {
+            word.store(w - (uint64_t{1} << shift), std::memory_order_release);
+        }
+    });
+}
+
+void CountingBloomFilter::CountNegative(size_t key_hash) {
+    stats[key_hash % STAT_STRIPES].negatives.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CountingBloomFilter::CountFalsePositive(size_t key_hash) {
+    stats[key_hash % STAT_STRIPES].false_positives.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CountingBloomFilter::GetStats(kvs_filter_stats &out) const {
+    out = {};
+    for (size_t i = 0; i < STAT_STRIPES; i++) {
+        out.negatives += stats[i].negatives.load(std::memory_order_relaxed);
+        out.false_positives += stats[i].false_positives.load(std::memory_order_relaxed);
+    }
+    out.memory_bytes = MemoryBytes();
+}
+
+}  // namespace kvssd
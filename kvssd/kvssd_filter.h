@@ -0,0 +1,71 @@
+#ifndef YCSB_C_KVSSD_FILTER_H_
+#define YCSB_C_KVSSD_FILTER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "kvssd.h"
+#include "kvssd_const.h"
+
+namespace kvssd {
+
+// Blocked counting Bloom filter over key hashes. A key maps to one
+// cache-line block and to probes 4-bit counters inside it, so a lookup
+// touches a single cache line. Counters saturate at 15 and then stay there:
+// deleting a key never causes a false negative, but keys sharing a
+// saturated counter may leave false positives behind.
+//
+// Add and Remove must be serialized by the caller, which holds its index's
+// write lock around them. MayContain needs no lock: a key is added before it
+// is inserted into the index and removed after it is erased from it.
+class CountingBloomFilter {
+   public:
+    // counters_per_key counters are provisioned for each of expected_keys
+    // keys; 10 gives about 1% false positives at that load.
+    CountingBloomFilter(size_t expected_keys, double counters_per_key);
+
+    bool MayContain(size_t key_hash) const;
+    void Add(size_t key_hash);
+    void Remove(size_t key_hash);
+
+    // Outcomes of lookups, for the false-positive rate: keys the filter ruled
+    // out, and keys it let through that the index did not hold.
+    void CountNegative(size_t key_hash);
+    void CountFalsePositive(size_t key_hash);
+    void GetStats(kvs_filter_stats &) const;
+
+    size_t Probes() const { return probes; }
+    size_t MemoryBytes() const { return num_blocks * sizeof(Block); }
+
+   private:
+    static constexpr size_t COUNTERS_PER_WORD = 16;
+    static constexpr size_t WORDS_PER_BLOCK = KVS_CACHE_LINE_SIZE / sizeof(uint64_t);
+    static constexpr size_t COUNTERS_PER_BLOCK = COUNTERS_PER_WORD * WORDS_PER_BLOCK;
+    static constexpr uint64_t COUNTER_MAX = 15;
+    static constexpr size_t STAT_STRIPES = 16;
+
+    struct alignas(KVS_CACHE_LINE_SIZE) Block {
+        std::atomic<uint64_t> words[WORDS_PER_BLOCK];
+    };
+    // Counted on cache lines of their own, picked by key, so that clients
+    // missing on different keys do not contend for one counter.
+    struct alignas(KVS_CACHE_LINE_SIZE) StatStripe {
+        std::atomic<uint64_t> negatives{0};
+        std::atomic<uint64_t> false_positives{0};
+    };
+
+    size_t num_blocks;
+    size_t probes;
+    std::unique_ptr<Block[]> blocks;
+    std::unique_ptr<StatStripe[]> stats;
+
+    // Calls fn(word, shift) for each counter of the key.
+    template <typename F>
+    void ForEachCounter(size_t key_hash, F fn) const;
+};
+
+}  // namespace kvssd
+
+#endif  // YCSB_C_KVSSD_FILTER_H_
@@ -1,141 +1,566 @@
 #include "kvssd_hashmap_db.h"
 
+#include <algorithm>
 #include <string>
+#include <utility>
 
 namespace kvssd_hashmap {
 
-Hashmap_KVSSD::Hashmap_KVSSD() { pthread_rwlock_init(&rwl, nullptr); }
+Hashmap_KVSSD::Hashmap_KVSSD(size_t async_workers) {
+    pthread_rwlock_init(&rwl, nullptr);
+    if (async_workers > 0) {
+        sq = std::make_unique<kvssd::SubmissionQueue>(*this, async_workers);
+    }
+}
+// Keys and values live in the slabs, which release their memory themselves.
 Hashmap_KVSSD::~Hashmap_KVSSD() {
+    sq.reset();
     pthread_rwlock_wrlock(&rwl);
-    for (auto &[key, value] : db) {
-        if (key.key != nullptr) {
-            free(key.key);
-        }
-        if (value.value != nullptr) {
-            free(value.value);
-        }
-    }
     db.clear();
+    index.clear();
     pthread_rwlock_unlock(&rwl);
     pthread_rwlock_destroy(&rwl);
 }
 
-kvssd::kvs_result Hashmap_KVSSD::ValidateRequest(
-    const kvssd::kvs_key &key,
-    std::optional<std::reference_wrapper<const kvssd::kvs_value>> value) const {
-    if (key.length < KVS_MIN_KEY_LENGTH || KVS_MAX_KEY_LENGTH < key.length) {
-        return kvssd::kvs_result::KVS_ERR_KEY_LENGTH_INVALID;
-    }
-    if (key.key == nullptr) {
-        return kvssd::kvs_result::KVS_ERR_PARAM_INVALID;
-    }
-    if (value) {
-        if (value->get().length < KVS_MIN_VALUE_LENGTH ||
-            KVS_MAX_VALUE_LENGTH < value->get().length) {
-            return kvssd::kvs_result::KVS_ERR_VALUE_LENGTH_INVALID;
-        }
-        if (value->get().offset & (KVS_ALIGNMENT_UNIT - 1)) {
-            return kvssd::kvs_result::KVS_ERR_VALUE_OFFSET_MISALIGNED;
-        }
-        if (value->get().value == nullptr && value->get().length) {
-            return kvssd::kvs_result::KVS_ERR_PARAM_INVALID;
-        }
-    }
-    return kvssd::kvs_result::KVS_SUCCESS;
-}
-
-kvssd::kvs_key Hashmap_KVSSD::DeepCopyKey(const kvssd::kvs_key &orig) const {
+kvssd::kvs_key Hashmap_KVSSD::DeepCopyKey(const kvssd::kvs_key &orig) {
     kvssd::kvs_key copy;
     copy.length = orig.length;
-    copy.key = malloc(orig.length);
+    copy.key = key_slab.Allocate(orig.length);
     if (copy.key && orig.key) {
         std::memcpy(copy.key, orig.key, orig.length);
     }
+    key_bytes += orig.length;
     return copy;
 }
 
-kvssd::kvs_value Hashmap_KVSSD::DeepCopyValue(const kvssd::kvs_value &orig) const {
+kvssd::kvs_value Hashmap_KVSSD::DeepCopyValue(const kvssd::kvs_value &orig) {
     kvssd::kvs_value copy;
     copy.length = orig.length;
     copy.actual_value_size = orig.actual_value_size;
     copy.offset = orig.offset;
-    copy.value = malloc(orig.length);
+    copy.value = value_slab.Allocate(orig.length);
     if (copy.value && orig.value) {
         std::memcpy(copy.value, orig.value, orig.length);
     }
+    value_bytes += orig.length;
     return copy;
 }
 
+void Hashmap_KVSSD::FreeKey(const kvssd::kvs_key &key) {
+    key_slab.Free(key.key, key.length);
+    key_bytes -= key.length;
+}
+
+void Hashmap_KVSSD::FreeValue(const kvssd::kvs_value &value) {
+    value_slab.Free(value.value, value.length);
+    value_bytes -= value.length;
+}
+
+void Hashmap_KVSSD::SetTimingModel(std::shared_ptr<kvssd::TimingModel> model) {
+    timing = std::move(model);
+}
+
+void Hashmap_KVSSD::Reserve(size_t records, float max_load_factor) {
+    pthread_rwlock_wrlock(&rwl);
+    if (max_load_factor > 0) {
+        db.max_load_factor(max_load_factor);
+    }
+    db.reserve(records);
+    pthread_rwlock_unlock(&rwl);
+}
+
+kvssd::kvs_result Hashmap_KVSSD::ForEachRecord(const RecordVisitor &fn) {
+    pthread_rwlock_rdlock(&rwl);
+    for (const auto &[key, value] : db) {
+        fn(key, value);
+    }
+    pthread_rwlock_unlock(&rwl);
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+kvssd::kvs_result Hashmap_KVSSD::Restore(const kvssd::kvs_key *keys,
+                                         const kvssd::kvs_value *values, size_t num) {
+    if (num && (keys == nullptr || values == nullptr)) {
+        return kvssd::kvs_result::KVS_ERR_PARAM_INVALID;
+    }
+    kvssd::kvs_result ret = kvssd::kvs_result::KVS_SUCCESS;
+    pthread_rwlock_wrlock(&rwl);
+    for (size_t i = 0; i < num && ret == kvssd::kvs_result::KVS_SUCCESS; i++) {
+        ret = InsertRecord(keys[i], values[i]);
+    }
+    pthread_rwlock_unlock(&rwl);
+    return ret;
+}
+
+kvssd::kvs_result Hashmap_KVSSD::SetCapacity(uint64_t bytes) {
+    pthread_rwlock_wrlock(&rwl);
+    capacity = bytes;
+    pthread_rwlock_unlock(&rwl);
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+void Hashmap_KVSSD::EnableFilter(size_t expected_keys, double counters_per_key) {
+    pthread_rwlock_wrlock(&rwl);
+    filter = std::make_unique<kvssd::CountingBloomFilter>(expected_keys, counters_per_key);
+    for (const auto &entry : db) {
+        filter->Add(std::hash<kvssd::kvs_key>{}(entry.first));
+    }
+    pthread_rwlock_unlock(&rwl);
+}
+
+kvssd::kvs_result Hashmap_KVSSD::GetFilterStats(kvssd::kvs_filter_stats &stats) {
+    if (!filter) {
+        return kvssd::kvs_result::KVS_ERR_OPTION_INVALID;
+    }
+    filter->GetStats(stats);
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+// Invalid requests go on to fail validation as usual.
+bool Hashmap_KVSSD::RuledOut(const kvssd::kvs_key &key, const kvssd::kvs_value &value) {
+    if (!filter || kvssd::ValidateRequest(key, value) != kvssd::kvs_result::KVS_SUCCESS) {
+        return false;
+    }
+    size_t hash = std::hash<kvssd::kvs_key>{}(key);
+    if (filter->MayContain(hash)) {
+        return false;
+    }
+    filter->CountNegative(hash);
+    return true;
+}
+
 // API Functions
+size_t Hashmap_KVSSD::CopiedBytes(const kvssd::kvs_value &value) {
+    return std::min<size_t>(value.length, value.actual_value_size - value.offset);
+}
+
 kvssd::kvs_result Hashmap_KVSSD::Read(const kvssd::kvs_key &key, kvssd::kvs_value &value_out) {
-    if (kvssd::kvs_result ret = ValidateRequest(key, value_out);
+    if (RuledOut(key, value_out)) {
+        return kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST;
+    }
+    pthread_rwlock_rdlock(&rwl);
+    kvssd::kvs_result ret = ReadRecord(key, value_out, false);
+    pthread_rwlock_unlock(&rwl);
+    if (timing) {
+        timing->Complete(kvssd::kvs_opcode::READ, std::hash<kvssd::kvs_key>{}(key),
+                         ret == kvssd::kvs_result::KVS_SUCCESS ? CopiedBytes(value_out) : 0);
+    }
+    return ret;
+}
+
+kvssd::kvs_result Hashmap_KVSSD::ReadRange(const kvssd::kvs_key &key,
+                                           kvssd::kvs_value &value_out) {
+    if (RuledOut(key, value_out)) {
+        return kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST;
+    }
+    pthread_rwlock_rdlock(&rwl);
+    kvssd::kvs_result ret = ReadRecord(key, value_out, true);
+    pthread_rwlock_unlock(&rwl);
+    if (timing) {
+        timing->Complete(kvssd::kvs_opcode::READ, std::hash<kvssd::kvs_key>{}(key),
+                         ret == kvssd::kvs_result::KVS_SUCCESS ? CopiedBytes(value_out) : 0);
+    }
+    return ret;
+}
+
+kvssd::kvs_result Hashmap_KVSSD::Insert(const kvssd::kvs_key &key, const kvssd::kvs_value &value) {
+    pthread_rwlock_wrlock(&rwl);
+    kvssd::kvs_result ret = InsertRecord(key, value);
+    pthread_rwlock_unlock(&rwl);
+    if (timing) {
+        timing->Complete(kvssd::kvs_opcode::INSERT, std::hash<kvssd::kvs_key>{}(key), value.length);
+    }
+    return ret;
+}
+
+kvssd::kvs_result Hashmap_KVSSD::Update(const kvssd::kvs_key &key, const kvssd::kvs_value &value) {
+    pthread_rwlock_wrlock(&rwl);
+    kvssd::kvs_result ret = UpdateRecord(key, value);
+    pthread_rwlock_unlock(&rwl);
+    if (timing) {
+        timing->Complete(kvssd::kvs_opcode::UPDATE, std::hash<kvssd::kvs_key>{}(key), value.length);
+    }
+    return ret;
+}
+
+kvssd::kvs_result Hashmap_KVSSD::Delete(const kvssd::kvs_key &key) {
+    pthread_rwlock_wrlock(&rwl);
+    kvssd::kvs_result ret = DeleteRecord(key);
+    pthread_rwlock_unlock(&rwl);
+    if (timing) {
+        timing->Complete(kvssd::kvs_opcode::DELETE, std::hash<kvssd::kvs_key>{}(key), 0);
+    }
+    return ret;
+}
+
+// A batch is one command to the modelled device: its requests are spread
+// over the dies together and it completes with the last of them. Reads the
+// filter rules out are settled before taking the lock.
+kvssd::kvs_result Hashmap_KVSSD::BatchRead(const kvssd::kvs_key *keys, kvssd::kvs_value *values,
+                                           kvssd::kvs_result *results, size_t num) {
+    if (num && (keys == nullptr || values == nullptr || results == nullptr)) {
+        return kvssd::kvs_result::KVS_ERR_PARAM_INVALID;
+    }
+    thread_local std::vector<bool> ruled_out;
+    ruled_out.assign(num, false);
+    size_t probed = 0;
+    for (size_t i = 0; i < num; i++) {
+        ruled_out[i] = RuledOut(keys[i], values[i]);
+        if (ruled_out[i]) {
+            results[i] = kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST;
+        } else {
+            probed++;
+        }
+    }
+    if (probed == 0) {
+        return kvssd::kvs_result::KVS_SUCCESS;
+    }
+    pthread_rwlock_rdlock(&rwl);
+    for (size_t i = 0; i < num; i++) {
+        if (!ruled_out[i]) {
+            results[i] = ReadRecord(keys[i], values[i], false);
+        }
+    }
+    pthread_rwlock_unlock(&rwl);
+    if (timing) {
+        uint64_t now = kvssd::NowNs();
+        uint64_t done = now;
+        for (size_t i = 0; i < num; i++) {
+            if (ruled_out[i]) {
+                continue;
+            }
+            size_t hash = std::hash<kvssd::kvs_key>{}(keys[i]);
+            size_t bytes =
+                results[i] == kvssd::kvs_result::KVS_SUCCESS ? CopiedBytes(values[i]) : 0;
+            done = std::max(done, timing->Schedule(kvssd::kvs_opcode::READ, hash, bytes, now));
+        }
+        kvssd::WaitUntil(done);
+    }
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+kvssd::kvs_result Hashmap_KVSSD::BatchStore(const kvssd::kvs_key *keys,
+                                            const kvssd::kvs_value *values,
+                                            kvssd::kvs_result *results, size_t num) {
+    return WriteBatch(kvssd::kvs_opcode::UPDATE, keys, values, results, num);
+}
+
+kvssd::kvs_result Hashmap_KVSSD::BatchInsert(const kvssd::kvs_key *keys,
+                                             const kvssd::kvs_value *values,
+                                             kvssd::kvs_result *results, size_t num) {
+    return WriteBatch(kvssd::kvs_opcode::INSERT, keys, values, results, num);
+}
+
+kvssd::kvs_result Hashmap_KVSSD::WriteBatch(kvssd::kvs_opcode op, const kvssd::kvs_key *keys,
+                                            const kvssd::kvs_value *values,
+                                            kvssd::kvs_result *results, size_t num) {
+    if (num && (keys == nullptr || values == nullptr || results == nullptr)) {
+        return kvssd::kvs_result::KVS_ERR_PARAM_INVALID;
+    }
+    pthread_rwlock_wrlock(&rwl);
+    for (size_t i = 0; i < num; i++) {
+        results[i] = op == kvssd::kvs_opcode::INSERT ? kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST
+                                                      : UpdateRecord(keys[i], values[i]);
+        if (results[i] == kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST) {
+            results[i] = InsertRecord(keys[i], values[i]);
+        }
+    }
+    pthread_rwlock_unlock(&rwl);
+    if (timing) {
+        uint64_t now = kvssd::NowNs();
+        uint64_t done = now;
+        for (size_t i = 0; i < num; i++) {
+            done = std::max(done, timing->Schedule(op, std::hash<kvssd::kvs_key>{}(keys[i]),
+                                                   values[i].length, now));
+        }
+        kvssd::WaitUntil(done);
+    }
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+kvssd::kvs_result Hashmap_KVSSD::BatchDelete(const kvssd::kvs_key *keys,
+                                             kvssd::kvs_result *results, size_t num) {
+    if (num && (keys == nullptr || results == nullptr)) {
+        return kvssd::kvs_result::KVS_ERR_PARAM_INVALID;
+    }
+    pthread_rwlock_wrlock(&rwl);
+    for (size_t i = 0; i < num; i++) {
+        results[i] = DeleteRecord(keys[i]);
+    }
+    pthread_rwlock_unlock(&rwl);
+    if (timing) {
+        uint64_t now = kvssd::NowNs();
+        uint64_t done = now;
+        for (size_t i = 0; i < num; i++) {
+            done = std::max(done, timing->Schedule(kvssd::kvs_opcode::DELETE,
+                                                   std::hash<kvssd::kvs_key>{}(keys[i]), 0, now));
+        }
+        kvssd::WaitUntil(done);
+    }
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+kvssd::kvs_result Hashmap_KVSSD::UpdateRange(const kvssd::kvs_key &key,
+                                             const kvssd::kvs_value &value) {
+    kvssd::kvs_result ret = WriteRange(key, value, false);
+    if (timing) {
+        timing->Complete(kvssd::kvs_opcode::UPDATE, std::hash<kvssd::kvs_key>{}(key), value.length);
+    }
+    return ret;
+}
+
+kvssd::kvs_result Hashmap_KVSSD::Append(const kvssd::kvs_key &key, const kvssd::kvs_value &value) {
+    kvssd::kvs_result ret = WriteRange(key, value, true);
+    if (timing) {
+        timing->Complete(kvssd::kvs_opcode::UPDATE, std::hash<kvssd::kvs_key>{}(key), value.length);
+    }
+    return ret;
+}
+
+kvssd::kvs_result Hashmap_KVSSD::ReadRecord(const kvssd::kvs_key &key, kvssd::kvs_value &value_out,
+                                            bool partial) {
+    if (kvssd::kvs_result ret = kvssd::ValidateRequest(key, value_out);
         ret != kvssd::kvs_result::KVS_SUCCESS) {
         return ret;
     }
-    pthread_rwlock_rdlock(&rwl);
     auto it = db.find(key);
-    pthread_rwlock_unlock(&rwl);
     if (it == db.end()) {
+        if (filter) {
+            filter->CountFalsePositive(std::hash<kvssd::kvs_key>{}(key));
+        }
         return kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST;
     }
-    value_out = DeepCopyValue(it->second);
+    // The caller holds the lock across the copy; a concurrent Update frees
+    // the old value.
+    const kvssd::kvs_value &stored = it->second;
+    value_out.actual_value_size = stored.length;
+    if (stored.length < value_out.offset) {
+        return kvssd::kvs_result::KVS_ERR_VALUE_OFFSET_INVALID;
+    }
+    uint32_t rest = stored.length - value_out.offset;
+    if (value_out.length < rest && !partial) {
+        return kvssd::kvs_result::KVS_ERR_BUFFER_SMALL;
+    }
+    if (uint32_t copied = std::min(rest, value_out.length); copied) {
+        std::memcpy(value_out.value, static_cast<char *>(stored.value) + value_out.offset, copied);
+    }
     return kvssd::kvs_result::KVS_SUCCESS;
 }
 
-kvssd::kvs_result Hashmap_KVSSD::Insert(const kvssd::kvs_key &key, const kvssd::kvs_value &value) {
-    if (kvssd::kvs_result ret = ValidateRequest(key, value);
+kvssd::kvs_result Hashmap_KVSSD::InsertRecord(const kvssd::kvs_key &key,
+                                              const kvssd::kvs_value &value) {
+    if (kvssd::kvs_result ret = kvssd::ValidateRequest(key, value);
         ret != kvssd::kvs_result::KVS_SUCCESS) {
         return ret;
     }
-    pthread_rwlock_wrlock(&rwl);
     if (auto it = db.find(key); it != db.end()) {
-        pthread_rwlock_unlock(&rwl);
         return kvssd::kvs_result::KVS_ERR_KS_EXIST;
     }
+    if (!Fits(key.length + value.length)) {
+        return kvssd::kvs_result::KVS_ERR_KS_CAPACITY;
+    }
+    if (filter) {
+        filter->Add(std::hash<kvssd::kvs_key>{}(key));
+    }
     kvssd::kvs_key key_copy = DeepCopyKey(key);
     kvssd::kvs_value value_copy = DeepCopyValue(value);
 
     db.try_emplace(key_copy, value_copy);
-    pthread_rwlock_unlock(&rwl);
+    index.emplace(static_cast<const char *>(key_copy.key), key_copy.length);
     return kvssd::kvs_result::KVS_SUCCESS;
 }
 
-kvssd::kvs_result Hashmap_KVSSD::Update(const kvssd::kvs_key &key, const kvssd::kvs_value &value) {
-    if (kvssd::kvs_result ret = ValidateRequest(key, value);
+kvssd::kvs_result Hashmap_KVSSD::UpdateRecord(const kvssd::kvs_key &key,
+                                              const kvssd::kvs_value &value) {
+    if (kvssd::kvs_result ret = kvssd::ValidateRequest(key, value);
         ret != kvssd::kvs_result::KVS_SUCCESS) {
         return ret;
     }
-    pthread_rwlock_wrlock(&rwl);
     auto it = db.find(key);
     if (it == db.end()) {
-        pthread_rwlock_unlock(&rwl);
         return kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST;
     }
 
-    if (it->second.value != nullptr) {
-        free(it->second.value);
-        it->second.value = nullptr;
+    // A value of the same size class is overwritten in place; readers copy
+    // under the read lock, so they never see it half-written.
+    kvssd::kvs_value &stored = it->second;
+    if (value.length > stored.length && !Fits(value.length - stored.length)) {
+        return kvssd::kvs_result::KVS_ERR_KS_CAPACITY;
+    }
+    if (stored.value != nullptr &&
+        value_slab.Capacity(value.length) == value_slab.Capacity(stored.length)) {
+        std::memcpy(stored.value, value.value, value.length);
+        value_bytes += value.length;
+        value_bytes -= stored.length;
+        stored.length = value.length;
+        stored.actual_value_size = value.actual_value_size;
+        stored.offset = value.offset;
+    } else {
+        FreeValue(stored);
+        stored = DeepCopyValue(value);
     }
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
 
-    kvssd::kvs_value value_copy = DeepCopyValue(value);
-    it->second = value_copy;
-    pthread_rwlock_unlock(&rwl);
+kvssd::kvs_result Hashmap_KVSSD::DeleteRecord(const kvssd::kvs_key &key) {
+    if (kvssd::kvs_result ret = kvssd::ValidateRequest(key, std::nullopt);
+        ret != kvssd::kvs_result::KVS_SUCCESS) {
+        return ret;
+    }
+    auto it = db.find(key);
+    if (it == db.end()) {
+        return kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST;
+    }
+    kvssd::kvs_key stored_key = it->first;
+    kvssd::kvs_value stored_value = it->second;
+    index.erase(std::string_view(static_cast<const char *>(stored_key.key), stored_key.length));
+    db.erase(it);
+    if (filter) {
+        filter->Remove(std::hash<kvssd::kvs_key>{}(stored_key));
+    }
+    FreeKey(stored_key);
+    FreeValue(stored_value);
     return kvssd::kvs_result::KVS_SUCCESS;
 }
 
-kvssd::kvs_result Hashmap_KVSSD::Delete(const kvssd::kvs_key &key) {
-    if (kvssd::kvs_result ret = ValidateRequest(key, std::nullopt);
+kvssd::kvs_result Hashmap_KVSSD::WriteRange(const kvssd::kvs_key &key,
+                                            const kvssd::kvs_value &value, bool append) {
+    // Partial writes are byte-granular; only the range's end is checked.
+    kvssd::kvs_value unaligned = value;
+    unaligned.offset = 0;
+    if (kvssd::kvs_result ret = kvssd::ValidateRequest(key, unaligned);
         ret != kvssd::kvs_result::KVS_SUCCESS) {
         return ret;
     }
     pthread_rwlock_wrlock(&rwl);
-    if (auto it = db.find(key); it == db.end()) {
+    auto it = db.find(key);
+    if (it == db.end()) {
         pthread_rwlock_unlock(&rwl);
         return kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST;
     }
-    db.erase(key);
+    kvssd::kvs_value &stored = it->second;
+    uint32_t offset = append ? stored.length : value.offset;
+    if (stored.length < offset) {
+        pthread_rwlock_unlock(&rwl);
+        return kvssd::kvs_result::KVS_ERR_VALUE_OFFSET_INVALID;
+    }
+    uint64_t end = uint64_t{offset} + value.length;
+    if (KVS_MAX_VALUE_LENGTH < end) {
+        pthread_rwlock_unlock(&rwl);
+        return kvssd::kvs_result::KVS_ERR_VALUE_LENGTH_INVALID;
+    }
+    if (stored.length < end && !Fits(end - stored.length)) {
+        pthread_rwlock_unlock(&rwl);
+        return kvssd::kvs_result::KVS_ERR_KS_CAPACITY;
+    }
+    if (stored.length < end) {
+        // Grow into a block of the new size class if the current one is full.
+        if (value_slab.Capacity(end) != value_slab.Capacity(stored.length)) {
+            void *grown = value_slab.Allocate(end);
+            if (stored.length) {
+                std::memcpy(grown, stored.value, stored.length);
+            }
+            value_slab.Free(stored.value, stored.length);
+            stored.value = grown;
+        }
+        value_bytes += end - stored.length;
+        stored.length = static_cast<uint32_t>(end);
+        stored.actual_value_size = stored.length;
+    }
+    if (value.length) {
+        std::memcpy(static_cast<char *>(stored.value) + offset, value.value, value.length);
+    }
     pthread_rwlock_unlock(&rwl);
     return kvssd::kvs_result::KVS_SUCCESS;
 }
 
+kvssd::kvs_result Hashmap_KVSSD::ReadAsync(const kvssd::kvs_key &key, kvssd::kvs_value &value,
+                                           kvssd::CompletionQueue &cq, void *private_data) {
+    if (!sq) {
+        return KVSSD::ReadAsync(key, value, cq, private_data);
+    }
+    return sq->Submit(kvssd::kvs_opcode::READ, key, &value, cq, private_data);
+}
+
+kvssd::kvs_result Hashmap_KVSSD::InsertAsync(const kvssd::kvs_key &key,
+                                             const kvssd::kvs_value &value,
+                                             kvssd::CompletionQueue &cq, void *private_data) {
+    if (!sq) {
+        return KVSSD::InsertAsync(key, value, cq, private_data);
+    }
+    return sq->Submit(kvssd::kvs_opcode::INSERT, key, const_cast<kvssd::kvs_value *>(&value), cq,
+                      private_data);
+}
+
+kvssd::kvs_result Hashmap_KVSSD::UpdateAsync(const kvssd::kvs_key &key,
+                                             const kvssd::kvs_value &value,
+                                             kvssd::CompletionQueue &cq, void *private_data) {
+    if (!sq) {
+        return KVSSD::UpdateAsync(key, value, cq, private_data);
+    }
+    return sq->Submit(kvssd::kvs_opcode::UPDATE, key, const_cast<kvssd::kvs_value *>(&value), cq,
+                      private_data);
+}
+
+kvssd::kvs_result Hashmap_KVSSD::DeleteAsync(const kvssd::kvs_key &key, kvssd::CompletionQueue &cq,
+                                             void *private_data) {
+    if (!sq) {
+        return KVSSD::DeleteAsync(key, cq, private_data);
+    }
+    return sq->Submit(kvssd::kvs_opcode::DELETE, key, nullptr, cq, private_data);
+}
+
+kvssd::kvs_result Hashmap_KVSSD::GetMemoryUsage(kvssd::kvs_memory_usage &usage) {
+    pthread_rwlock_rdlock(&rwl);
+    usage.records = db.size();
+    usage.key_bytes = key_bytes;
+    usage.value_bytes = value_bytes;
+    usage.allocated_bytes = key_slab.AllocatedBytes() + value_slab.AllocatedBytes();
+    pthread_rwlock_unlock(&rwl);
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+kvssd::kvs_result Hashmap_KVSSD::OpenIterator(const kvssd::kvs_key_group_filter &filter,
+                                              const kvssd::kvs_key *start,
+                                              kvssd::kvs_iterator_handle &handle) {
+    return iterators.Open(filter, start, handle);
+}
+
+kvssd::kvs_result Hashmap_KVSSD::IteratorNext(kvssd::kvs_iterator_handle handle,
+                                              kvssd::kvs_iterator_list &list) {
+    return iterators.Next(handle, list,
+                          [this](const kvssd::IteratorTable::Cursor &cursor, size_t budget,
+                                 std::vector<std::string> &keys) {
+                              return CollectKeys(cursor, budget, keys);
+                          });
+}
+
+kvssd::kvs_result Hashmap_KVSSD::CloseIterator(kvssd::kvs_iterator_handle handle) {
+    return iterators.Close(handle);
+}
+
+// The first key is taken regardless of budget so that a buffer too small for
+// it can be reported.
+bool Hashmap_KVSSD::CollectKeys(const kvssd::IteratorTable::Cursor &cursor, size_t budget,
+                                std::vector<std::string> &keys) {
+    pthread_rwlock_rdlock(&rwl);
+    auto it = cursor.inclusive ? index.lower_bound(cursor.position)
+                               : index.upper_bound(cursor.position);
+    size_t used = 0;
+    for (; it != index.end(); ++it) {
+        if (!kvssd::MatchesFilter(cursor.filter, *it)) {
+            continue;
+        }
+        size_t entry = sizeof(uint32_t) + it->size();
+        if (budget < used + entry && !keys.empty()) {
+            break;
+        }
+        keys.emplace_back(*it);
+        used += entry;
+    }
+    bool exhausted = it == index.end();
+    pthread_rwlock_unlock(&rwl);
+    return exhausted;
+}
+
 }  // namespace kvssd_hashmap
@@ -4,13 +4,24 @@
 #include <pthread.h>
 
 #include <condition_variable>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <memory>
 #include <optional>
+#include <set>
+#include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 #include "kvssd.h"
+#include "kvssd_async.h"
 #include "kvssd_const.h"
+#include "kvssd_filter.h"
+#include "kvssd_iterator.h"
+#include "kvssd_slab.h"
+#include "kvssd_timing.h"
 
 namespace std {
 template <>
@@ -35,7 +46,9 @@ struct hash<kvssd::kvs_key> {
 namespace kvssd_hashmap {
 class Hashmap_KVSSD : public kvssd::KVSSD {
    public:
-    Hashmap_KVSSD();
+    // With async_workers > 0 the *Async calls are served by a worker pool;
+    // otherwise they complete inline.
+    explicit Hashmap_KVSSD(size_t async_workers = 0);
     ~Hashmap_KVSSD() final;
 
     kvssd::kvs_result Read(const kvssd::kvs_key &, kvssd::kvs_value &) final;
@@ -43,15 +56,101 @@ class Hashmap_KVSSD : public kvssd::KVSSD {
     kvssd::kvs_result Update(const kvssd::kvs_key &, const kvssd::kvs_value &) final;
     kvssd::kvs_result Delete(const kvssd::kvs_key &) final;
 
+    kvssd::kvs_result ReadRange(const kvssd::kvs_key &, kvssd::kvs_value &) final;
+    kvssd::kvs_result UpdateRange(const kvssd::kvs_key &, const kvssd::kvs_value &) final;
+    kvssd::kvs_result Append(const kvssd::kvs_key &, const kvssd::kvs_value &) final;
+
+    // Each batch takes the lock once.
+    kvssd::kvs_result BatchRead(const kvssd::kvs_key *, kvssd::kvs_value *, kvssd::kvs_result *,
+                                size_t num) final;
+    kvssd::kvs_result BatchStore(const kvssd::kvs_key *, const kvssd::kvs_value *,
+                                 kvssd::kvs_result *, size_t num) final;
+    kvssd::kvs_result BatchInsert(const kvssd::kvs_key *, const kvssd::kvs_value *,
+                                  kvssd::kvs_result *, size_t num) final;
+    kvssd::kvs_result BatchDelete(const kvssd::kvs_key *, kvssd::kvs_result *, size_t num) final;
+
+    kvssd::kvs_result ForEachRecord(const RecordVisitor &) final;
+    kvssd::kvs_result Restore(const kvssd::kvs_key *, const kvssd::kvs_value *, size_t num) final;
+
+    kvssd::kvs_result ReadAsync(const kvssd::kvs_key &, kvssd::kvs_value &,
+                                kvssd::CompletionQueue &, void *) final;
+    kvssd::kvs_result InsertAsync(const kvssd::kvs_key &, const kvssd::kvs_value &,
+                                  kvssd::CompletionQueue &, void *) final;
+    kvssd::kvs_result UpdateAsync(const kvssd::kvs_key &, const kvssd::kvs_value &,
+                                  kvssd::CompletionQueue &, void *) final;
+    kvssd::kvs_result DeleteAsync(const kvssd::kvs_key &, kvssd::CompletionQueue &, void *) final;
+
+    kvssd::kvs_result OpenIterator(const kvssd::kvs_key_group_filter &, const kvssd::kvs_key *,
+                                   kvssd::kvs_iterator_handle &) final;
+    kvssd::kvs_result IteratorNext(kvssd::kvs_iterator_handle, kvssd::kvs_iterator_list &) final;
+    kvssd::kvs_result CloseIterator(kvssd::kvs_iterator_handle) final;
+
+    kvssd::kvs_result SetCapacity(uint64_t) final;
+    kvssd::kvs_result GetMemoryUsage(kvssd::kvs_memory_usage &) final;
+    kvssd::kvs_result GetFilterStats(kvssd::kvs_filter_stats &) final;
+
+    // Every request then takes as long as the model says, on top of the work
+    // done here. Set before issuing requests; may be shared between devices.
+    void SetTimingModel(std::shared_ptr<kvssd::TimingModel>);
+
+    // Puts a CountingBloomFilter sized for expected_keys in front of the map:
+    // reads of keys it rules out fail without taking the lock and, with a
+    // timing model, without device time. Set before issuing requests.
+    void EnableFilter(size_t expected_keys, double counters_per_key);
+
+    // Sizes the map for records entries so that loading them does not
+    // rehash under the write lock. A max_load_factor of 0 keeps the current one.
+    void Reserve(size_t records, float max_load_factor);
+
+    // IteratorTable::Collector over this map's ordered index.
+    bool CollectKeys(const kvssd::IteratorTable::Cursor &, size_t budget,
+                     std::vector<std::string> &keys);
+
    private:
     std::unordered_map<kvssd::kvs_key, kvssd::kvs_value> db;
+    // Ordered view of the keys in db, pointing at the same key buffers.
+    std::set<std::string_view> index;
     pthread_rwlock_t rwl;
+    kvssd::IteratorTable iterators;
+    std::unique_ptr<kvssd::SubmissionQueue> sq;
+    std::shared_ptr<kvssd::TimingModel> timing;
+    std::unique_ptr<kvssd::CountingBloomFilter> filter;
+
+    // Stored keys and values; guarded by rwl like the map itself.
+    kvssd::SlabAllocator key_slab{alignof(std::max_align_t)};
+    kvssd::SlabAllocator value_slab{KVS_ALIGNMENT_UNIT};
+    uint64_t key_bytes = 0;
+    uint64_t value_bytes = 0;
+    uint64_t capacity = 0;
+
+    // Whether growing the stored bytes by grow fits the capacity; needs rwl.
+    bool Fits(uint64_t grow) const {
+        return capacity == 0 || key_bytes + value_bytes + grow <= capacity;
+    }
+
+    // The requests themselves, without the timing model. The *Record calls
+    // expect the caller to hold rwl; WriteRange takes it itself. ReadRecord
+    // stops at the end of the buffer if partial is set, and expects reads to
+    // have passed the filter; WriteRange appends if append is set.
+    kvssd::kvs_result ReadRecord(const kvssd::kvs_key &, kvssd::kvs_value &, bool partial);
+    kvssd::kvs_result InsertRecord(const kvssd::kvs_key &, const kvssd::kvs_value &);
+    kvssd::kvs_result UpdateRecord(const kvssd::kvs_key &, const kvssd::kvs_value &);
+    kvssd::kvs_result DeleteRecord(const kvssd::kvs_key &);
+    kvssd::kvs_result WriteRange(const kvssd::kvs_key &, const kvssd::kvs_value &, bool append);
+    // BatchStore for UPDATE, BatchInsert for INSERT.
+    kvssd::kvs_result WriteBatch(kvssd::kvs_opcode, const kvssd::kvs_key *,
+                                 const kvssd::kvs_value *, kvssd::kvs_result *, size_t num);
+
+    // Whether the filter settles a read as a miss; counts it if so.
+    bool RuledOut(const kvssd::kvs_key &, const kvssd::kvs_value &);
+
+    // Bytes of the stored value a successful read copied.
+    static size_t CopiedBytes(const kvssd::kvs_value &);
 
-    kvssd::kvs_result ValidateRequest(
-        const kvssd::kvs_key &,
-        std::optional<std::reference_wrapper<const kvssd::kvs_value>>) const;
-    kvssd::kvs_key DeepCopyKey(const kvssd::kvs_key &) const;
-    kvssd::kvs_value DeepCopyValue(const kvssd::kvs_value &) const;
+    kvssd::kvs_key DeepCopyKey(const kvssd::kvs_key &);
+    kvssd::kvs_value DeepCopyValue(const kvssd::kvs_value &);
+    void FreeKey(const kvssd::kvs_key &);
+    void FreeValue(const kvssd::kvs_value &);
 };
 
 }  // namespace kvssd_hashmap
@@ -1,7 +1,10 @@
 #include "kvssd_hashmap_db_impl.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <iostream>
+#include <string_view>
+#include <utility>
 
 namespace kvssd_hashmap {
 
@@ -22,28 +25,142 @@ void SerializeRow(const std::vector<ycsbc::DB::Field> &values, std::string *data
     }
 }
 
-// char* to Field vector pointer
+namespace {
+// Starts every fixed-layout row. A packed row starts with a field name
+// length, which is never this large.
+constexpr uint32_t FIXED_ROW_MAGIC = 0xffffffff;
+// Magic, field count, field length and prefix length, then the prefix.
+constexpr uint32_t FIXED_ROW_HEADER_SIZE = 4 * sizeof(uint32_t);
+
+uint32_t LoadU32(const char *p) {
+    uint32_t n;
+    std::memcpy(&n, p, sizeof(n));
+    return n;
+}
+
+void StoreU32(char *p, uint32_t n) { std::memcpy(p, &n, sizeof(n)); }
+
+void CheckFixedRow(bool ok) {
+    if (!ok) {
+        throw ycsbc::utils::Exception("Malformed fixed-layout kvssd row");
+    }
+}
+
+void DeserializeFixedRow(std::vector<ycsbc::DB::Field> *values, const char *data,
+                         size_t data_len) {
+    CheckFixedRow(FIXED_ROW_HEADER_SIZE <= data_len);
+    uint32_t field_count = LoadU32(data + sizeof(uint32_t));
+    uint32_t field_length = LoadU32(data + 2 * sizeof(uint32_t));
+    uint32_t prefix_length = LoadU32(data + 3 * sizeof(uint32_t));
+    uint64_t slot_size = sizeof(uint32_t) + uint64_t{field_length};
+    uint64_t header_size = FIXED_ROW_HEADER_SIZE + uint64_t{prefix_length};
+    CheckFixedRow(header_size + field_count * slot_size <= data_len);
+    std::string_view prefix(data + FIXED_ROW_HEADER_SIZE, prefix_length);
+    values->resize(field_count);
+    const char *slot = data + header_size;
+    for (uint32_t i = 0; i < field_count; i++, slot += slot_size) {
+        uint32_t length = LoadU32(slot);
+        CheckFixedRow(length <= field_length);
+        ycsbc::DB::Field &field = (*values)[i];
+        field.name.assign(prefix).append(std::to_string(i));
+        field.value.assign(slot + sizeof(uint32_t), length);
+    }
+}
+}  // anonymous namespace
+
+FieldLayout::FieldLayout(std::string prefix, uint32_t field_count, uint32_t field_length)
+    : prefix(std::move(prefix)),
+      field_count(field_count),
+      field_length(field_length),
+      header_size(FIXED_ROW_HEADER_SIZE + static_cast<uint32_t>(this->prefix.size())) {}
+
+int FieldLayout::SlotOf(const std::string &name) const {
+    if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) {
+        return -1;
+    }
+    std::string_view number(name);
+    number.remove_prefix(prefix.size());
+    // Field numbers are written without leading zeros.
+    if (number.size() > 9 || (number.size() > 1 && number[0] == '0')) {
+        return -1;
+    }
+    uint32_t slot = 0;
+    for (char c : number) {
+        if (c < '0' || '9' < c) {
+            return -1;
+        }
+        slot = slot * 10 + (c - '0');
+    }
+    return slot < field_count ? static_cast<int>(slot) : -1;
+}
+
+void FieldLayout::SerializeRow(const std::vector<ycsbc::DB::Field> &values,
+                               std::string *data) const {
+    data->assign(header_size + field_count * SlotSize(), '\0');
+    StoreU32(data->data(), FIXED_ROW_MAGIC);
+    StoreU32(data->data() + sizeof(uint32_t), field_count);
+    StoreU32(data->data() + 2 * sizeof(uint32_t), field_length);
+    StoreU32(data->data() + 3 * sizeof(uint32_t), static_cast<uint32_t>(prefix.size()));
+    std::memcpy(data->data() + FIXED_ROW_HEADER_SIZE, prefix.data(), prefix.size());
+    std::string slot;
+    for (const ycsbc::DB::Field &field : values) {
+        SerializeSlot(field, &slot);
+        data->replace(SlotOffset(SlotOf(field.name)), slot.size(), slot);
+    }
+}
+
+void FieldLayout::SerializeSlot(const ycsbc::DB::Field &field, std::string *data) const {
+    if (SlotOf(field.name) < 0 || field_length < field.value.size()) {
+        throw ycsbc::utils::Exception("Field " + field.name +
+                                      " does not fit the fixed kvssd row layout");
+    }
+    data->assign(SlotSize(), '\0');
+    StoreU32(data->data(), static_cast<uint32_t>(field.value.size()));
+    std::memcpy(data->data() + sizeof(uint32_t), field.value.data(), field.value.size());
+}
+
+void FieldLayout::DeserializeSlot(int slot, const char *data,
+                                  std::vector<ycsbc::DB::Field> *values) const {
+    uint32_t length = LoadU32(data);
+    CheckFixedRow(length <= field_length);
+    values->emplace_back();
+    values->back().name.assign(prefix).append(std::to_string(slot));
+    values->back().value.assign(data + sizeof(uint32_t), length);
+}
+
+// char* to Field vector pointer. Fields already in values are overwritten in
+// place, so a vector reused across reads keeps its string storage.
 void DeserializeRow(std::vector<ycsbc::DB::Field> *values, const char *data_ptr, size_t data_len) {
+    if (data_len >= sizeof(uint32_t) && LoadU32(data_ptr) == FIXED_ROW_MAGIC) {
+        DeserializeFixedRow(values, data_ptr, data_len);
+        return;
+    }
     const char *p = data_ptr;
     const char *lim = p + data_len;
+    size_t count = 0;
     while (p != lim) {
         assert(p < lim);
+        if (count == values->size()) {
+            values->emplace_back();
+        }
+        ycsbc::DB::Field &field = (*values)[count++];
         uint32_t vlen;
         std::memcpy(&vlen, p, sizeof(vlen));
         p += sizeof(vlen);
-        std::string field(p, static_cast<const size_t>(vlen));
+        field.name.assign(p, vlen);
         p += vlen;
         uint32_t tlen;
         std::memcpy(&tlen, p, sizeof(tlen));
         p += sizeof(tlen);
-        std::string value(p, static_cast<const size_t>(tlen));
+        field.value.assign(p, tlen);
         p += tlen;
-        values->push_back({field, value});
     }
+    values->resize(count);
 }
 
 std::unique_ptr<kvs_row, KvsRowDeleter> CreateRow(std::string_view key_in,
-                                                  const std::vector<ycsbc::DB::Field> &value_in) {
+                                                  const std::vector<ycsbc::DB::Field> &value_in,
+                                                  const FieldLayout *layout) {
     auto key_length = static_cast<uint16_t>(key_in.size());
     void *key = malloc(key_length);
     std::memcpy(key, (void *)(key_in.data()), key_length);
@@ -54,7 +171,11 @@ std::unique_ptr<kvs_row, KvsRowDeleter> CreateRow(std::string_view key_in,
     uint32_t actual_value_size = 0;
     uint32_t offset = 0;
     if (!value_in.empty()) {
-        SerializeRow(value_in, &value_sz);
+        if (layout) {
+            layout->SerializeRow(value_in, &value_sz);
+        } else {
+            SerializeRow(value_in, &value_sz);
+        }
         value = malloc(value_sz.size());
         std::memcpy(value, value_sz.data(), value_sz.size());
         value_length = static_cast<uint32_t>(value_sz.size());
@@ -116,23 +237,71 @@ void CheckAPI(const kvssd::kvs_result ret) {
     }
 }
 
+namespace {
+constexpr size_t INITIAL_READ_BUFFER_SIZE = 4096;
+
+// The device never writes through the key, so it can alias the caller's string.
+kvssd::kvs_key KeyOf(std::string_view key) {
+    return {const_cast<char *>(key.data()), static_cast<uint16_t>(key.size())};
+}
+
+kvssd::kvs_value ValueOf(std::vector<char> &buffer) {
+    if (buffer.empty()) {
+        buffer.resize(INITIAL_READ_BUFFER_SIZE);
+    }
+    return {buffer.data(), static_cast<uint32_t>(buffer.size()), 0, 0};
+}
+
+// Reads into buffer, growing it to the stored size when the value does not
+// fit. Retries because a concurrent update may grow the value again.
+kvssd::kvs_result ReadValue(kvssd::KVSSD &kvssd, const kvssd::kvs_key &key,
+                            std::vector<char> &buffer, kvssd::kvs_value &value) {
+    while (true) {
+        value = ValueOf(buffer);
+        kvssd::kvs_result ret = kvssd.Read(key, value);
+        if (ret != kvssd::kvs_result::KVS_ERR_BUFFER_SMALL ||
+            value.actual_value_size <= buffer.size()) {
+            return ret;
+        }
+        buffer.resize(value.actual_value_size);
+    }
+}
+}  // anonymous namespace
+
 // Wrapper Functions
+bool TryReadRow(kvssd::KVSSD &kvssd, const std::string &key, std::vector<ycsbc::DB::Field> &value,
+                std::vector<char> &buffer) {
+    kvssd::kvs_value stored;
+    kvssd::kvs_result ret = ReadValue(kvssd, KeyOf(key), buffer, stored);
+    if (ret == kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST) {
+        return false;
+    }
+    CheckAPI(ret);
+    DeserializeRow(&value, buffer.data(), stored.actual_value_size);
+    return true;
+}
+
+void ReadRow(kvssd::KVSSD &kvssd, const std::string &key, std::vector<ycsbc::DB::Field> &value,
+             std::vector<char> &buffer) {
+    if (!TryReadRow(kvssd, key, value, buffer)) {
+        CheckAPI(kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST);
+    }
+}
+
 void ReadRow(kvssd::KVSSD &kvssd, const std::string &key, std::vector<ycsbc::DB::Field> &value) {
-    value = {};
-    std::unique_ptr<kvs_row, KvsRowDeleter> newRow = CreateRow(key, {});
-    CheckAPI(kvssd.Read(*newRow->key, *newRow->value));
-    DeserializeRow(&value, static_cast<char *>(newRow->value->value), newRow->value->length);
+    thread_local std::vector<char> buffer;
+    ReadRow(kvssd, key, value, buffer);
 }
 
 void InsertRow(kvssd::KVSSD &kvssd, const std::string &key,
-               const std::vector<ycsbc::DB::Field> &value) {
-    std::unique_ptr<kvs_row, KvsRowDeleter> newRow = CreateRow(key, value);
+               const std::vector<ycsbc::DB::Field> &value, const FieldLayout *layout) {
+    std::unique_ptr<kvs_row, KvsRowDeleter> newRow = CreateRow(key, value, layout);
     CheckAPI(kvssd.Insert(*newRow->key, *newRow->value));
 }
 
 void UpdateRow(kvssd::KVSSD &kvssd, const std::string &key,
-               const std::vector<ycsbc::DB::Field> &value) {
-    std::unique_ptr<kvs_row, KvsRowDeleter> newRow = CreateRow(key, value);
+               const std::vector<ycsbc::DB::Field> &value, const FieldLayout *layout) {
+    std::unique_ptr<kvs_row, KvsRowDeleter> newRow = CreateRow(key, value, layout);
     CheckAPI(kvssd.Update(*newRow->key, *newRow->value));
 }
 
@@ -141,4 +310,268 @@ void DeleteRow(kvssd::KVSSD &kvssd, const std::string &key) {
     CheckAPI(kvssd.Delete(*newRow->key));
 }
 
+bool ReadFields(kvssd::KVSSD &kvssd, const std::string &key, const FieldLayout &layout,
+                const std::vector<std::string> &fields, std::vector<ycsbc::DB::Field> &value,
+                std::vector<char> &buffer) {
+    int first = -1;
+    int last = -1;
+    for (const std::string &name : fields) {
+        int slot = layout.SlotOf(name);
+        if (slot < 0) {
+            throw ycsbc::utils::Exception("Field " + name + " is not in the kvssd row layout");
+        }
+        first = first < 0 ? slot : std::min(first, slot);
+        last = std::max(last, slot);
+    }
+    if (first < 0) {
+        value.clear();
+        return true;
+    }
+    // Reads must start on an alignment boundary.
+    uint32_t begin = layout.SlotOffset(first) & ~uint32_t{KVS_ALIGNMENT_UNIT - 1};
+    uint32_t end = layout.SlotOffset(last) + layout.SlotSize();
+    if (buffer.size() < end - begin) {
+        buffer.resize(end - begin);
+    }
+    kvssd::kvs_value range{buffer.data(), end - begin, 0, begin};
+    kvssd::kvs_result ret = kvssd.ReadRange(KeyOf(key), range);
+    if (ret == kvssd::kvs_result::KVS_ERR_OPTION_INVALID) {
+        if (!TryReadRow(kvssd, key, value, buffer)) {
+            return false;
+        }
+        value.erase(std::remove_if(value.begin(), value.end(),
+                                   [&fields](const ycsbc::DB::Field &field) {
+                                       return std::find(fields.begin(), fields.end(),
+                                                        field.name) == fields.end();
+                                   }),
+                    value.end());
+        return true;
+    }
+    if (ret == kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST) {
+        return false;
+    }
+    CheckAPI(ret);
+    CheckFixedRow(end <= range.actual_value_size);
+    value.clear();
+    for (const std::string &name : fields) {
+        int slot = layout.SlotOf(name);
+        layout.DeserializeSlot(slot, buffer.data() + layout.SlotOffset(slot) - begin, &value);
+    }
+    return true;
+}
+
+void UpdateFields(kvssd::KVSSD &kvssd, const std::string &key, const FieldLayout &layout,
+                  const std::vector<ycsbc::DB::Field> &value, std::vector<char> &buffer) {
+    std::string slot;
+    for (const ycsbc::DB::Field &field : value) {
+        layout.SerializeSlot(field, &slot);
+        auto length = static_cast<uint32_t>(slot.size());
+        uint32_t offset = layout.SlotOffset(layout.SlotOf(field.name));
+        kvssd::kvs_value range{slot.data(), length, length, offset};
+        kvssd::kvs_result ret = kvssd.UpdateRange(KeyOf(key), range);
+        if (ret != kvssd::kvs_result::KVS_ERR_OPTION_INVALID) {
+            CheckAPI(ret);
+            continue;
+        }
+        // Read-modify-write of the whole row; not atomic against other writers.
+        std::vector<ycsbc::DB::Field> row;
+        ReadRow(kvssd, key, row, buffer);
+        for (const ycsbc::DB::Field &update : value) {
+            auto it = std::find_if(row.begin(), row.end(), [&update](const ycsbc::DB::Field &f) {
+                return f.name == update.name;
+            });
+            if (it != row.end()) {
+                it->value = update.value;
+            } else {
+                row.push_back(update);
+            }
+        }
+        UpdateRow(kvssd, key, row, &layout);
+        return;
+    }
+}
+
+bool ScanRows(kvssd::KVSSD &kvssd, const std::string &key, int len,
+              std::vector<std::vector<ycsbc::DB::Field>> &values, std::vector<char> &key_buffer,
+              std::vector<char> &value_buffer) {
+    kvssd::kvs_key_group_filter filter{};
+    kvssd::kvs_key start = KeyOf(key);
+    kvssd::kvs_iterator_handle handle;
+    kvssd::kvs_result ret = kvssd.OpenIterator(filter, &start, handle);
+    if (ret == kvssd::kvs_result::KVS_ERR_OPTION_INVALID) {
+        return false;
+    }
+    CheckAPI(ret);
+    struct IteratorCloser {
+        kvssd::KVSSD &kvssd;
+        kvssd::kvs_iterator_handle handle;
+        ~IteratorCloser() { kvssd.CloseIterator(handle); }
+    } closer{kvssd, handle};
+
+    // Ask for about len keys of the start key's length, so short scans do not
+    // list a whole buffer of keys they will not read.
+    if (key_buffer.size() < KVS_ITERATOR_BUFFER_SIZE) {
+        key_buffer.resize(KVS_ITERATOR_BUFFER_SIZE);
+    }
+    size_t wanted = std::max(static_cast<size_t>(len) * (sizeof(uint32_t) + key.size()),
+                             sizeof(uint32_t) + KVS_MAX_KEY_LENGTH);
+    kvssd::kvs_iterator_list list{key_buffer.data(),
+                                  static_cast<uint32_t>(std::min(key_buffer.size(), wanted)), 0,
+                                  false};
+
+    values.clear();
+    while (values.size() < static_cast<size_t>(len)) {
+        CheckAPI(kvssd.IteratorNext(handle, list));
+        const char *p = key_buffer.data();
+        for (uint32_t i = 0; i < list.num_entries && values.size() < static_cast<size_t>(len);
+             i++) {
+            uint32_t length;
+            std::memcpy(&length, p, sizeof(length));
+            p += sizeof(length);
+            kvssd::kvs_key next = KeyOf(std::string_view(p, length));
+            p += length;
+            kvssd::kvs_value stored;
+            ret = ReadValue(kvssd, next, value_buffer, stored);
+            if (ret == kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST) {
+                continue;  // deleted after its key was listed
+            }
+            CheckAPI(ret);
+            values.emplace_back();
+            DeserializeRow(&values.back(), value_buffer.data(), stored.actual_value_size);
+        }
+        if (list.end) {
+            break;
+        }
+    }
+    return true;
+}
+
+kvs_row *RowBatch::Insert(kvssd::KVSSD &kvssd, const std::string &key,
+                          const std::vector<ycsbc::DB::Field> &value, kvssd::CompletionQueue &cq,
+                          const FieldLayout *layout) {
+    return Add(kvssd, kvssd::kvs_opcode::INSERT, CreateRow(key, value, layout), cq);
+}
+
+kvs_row *RowBatch::Store(kvssd::KVSSD &kvssd, const std::string &key,
+                         const std::vector<ycsbc::DB::Field> &value, kvssd::CompletionQueue &cq,
+                         const FieldLayout *layout) {
+    return Add(kvssd, kvssd::kvs_opcode::UPDATE, CreateRow(key, value, layout), cq);
+}
+
+kvs_row *RowBatch::Delete(kvssd::KVSSD &kvssd, const std::string &key,
+                          kvssd::CompletionQueue &cq) {
+    return Add(kvssd, kvssd::kvs_opcode::DELETE, CreateRow(key, {}), cq);
+}
+
+kvs_row *RowBatch::Add(kvssd::KVSSD &kvssd, kvssd::kvs_opcode request_op,
+                       std::unique_ptr<kvs_row, KvsRowDeleter> row, kvssd::CompletionQueue &cq) {
+    if (!rows.empty() && op != request_op) {
+        Flush(kvssd);
+    }
+    op = request_op;
+    kvs_row *tag = row.get();
+    keys.push_back(*row->key);
+    values.push_back(*row->value);
+    rows.push_back(std::move(row));
+    queues.push_back(&cq);
+    if (rows.size() >= capacity) {
+        Flush(kvssd);
+    }
+    return tag;
+}
+
+void RowBatch::Flush(kvssd::KVSSD &kvssd) {
+    if (rows.empty()) {
+        return;
+    }
+    results.resize(rows.size());
+    kvssd::kvs_result ret;
+    switch (op) {
+        case kvssd::kvs_opcode::INSERT:
+            ret = kvssd.BatchInsert(keys.data(), values.data(), results.data(), keys.size());
+            break;
+        case kvssd::kvs_opcode::DELETE:
+            ret = kvssd.BatchDelete(keys.data(), results.data(), keys.size());
+            break;
+        default:
+            ret = kvssd.BatchStore(keys.data(), values.data(), results.data(), keys.size());
+            break;
+    }
+    // A command that failed as a whole fails each of its requests.
+    for (size_t i = 0; i < rows.size(); i++) {
+        queues[i]->Push({op, ret == kvssd::kvs_result::KVS_SUCCESS ? results[i] : ret,
+                         rows[i].release()});
+    }
+    rows.clear();
+    keys.clear();
+    values.clear();
+    queues.clear();
+}
+
+bool RowBatch::Contains(const std::string &key) const {
+    return std::any_of(keys.begin(), keys.end(), [&key](const kvssd::kvs_key &pending) {
+        return std::string_view(static_cast<const char *>(pending.key), pending.length) == key;
+    });
+}
+
+kvs_row *SubmitReadRow(kvssd::KVSSD &kvssd, const std::string &key, kvssd::CompletionQueue &cq,
+                       std::vector<char> &buffer) {
+    std::unique_ptr<kvs_row, KvsRowDeleter> newRow = CreateRow(key, {});
+    *newRow->value = ValueOf(buffer);
+    kvssd::kvs_result ret = kvssd.ReadAsync(*newRow->key, *newRow->value, cq, newRow.get());
+    if (ret != kvssd::kvs_result::KVS_SUCCESS) {
+        newRow->value->value = nullptr;  // owned by the caller
+        CheckAPI(ret);
+    }
+    return newRow.release();
+}
+
+kvs_row *SubmitInsertRow(kvssd::KVSSD &kvssd, const std::string &key,
+                         const std::vector<ycsbc::DB::Field> &value, kvssd::CompletionQueue &cq,
+                         const FieldLayout *layout) {
+    std::unique_ptr<kvs_row, KvsRowDeleter> newRow = CreateRow(key, value, layout);
+    CheckAPI(kvssd.InsertAsync(*newRow->key, *newRow->value, cq, newRow.get()));
+    return newRow.release();
+}
+
+kvs_row *SubmitUpdateRow(kvssd::KVSSD &kvssd, const std::string &key,
+                         const std::vector<ycsbc::DB::Field> &value, kvssd::CompletionQueue &cq,
+                         const FieldLayout *layout) {
+    std::unique_ptr<kvs_row, KvsRowDeleter> newRow = CreateRow(key, value, layout);
+    CheckAPI(kvssd.UpdateAsync(*newRow->key, *newRow->value, cq, newRow.get()));
+    return newRow.release();
+}
+
+kvs_row *SubmitDeleteRow(kvssd::KVSSD &kvssd, const std::string &key,
+                         kvssd::CompletionQueue &cq) {
+    std::unique_ptr<kvs_row, KvsRowDeleter> newRow = CreateRow(key, {});
+    CheckAPI(kvssd.DeleteAsync(*newRow->key, cq, newRow.get()));
+    return newRow.release();
+}
+
+bool CompleteRow(const kvssd::kvs_completion &completion, std::vector<ycsbc::DB::Field> *value) {
+    kvssd::kvs_result ret = TryCompleteRow(completion, value);
+    if (completion.opcode == kvssd::kvs_opcode::READ &&
+        ret == kvssd::kvs_result::KVS_ERR_BUFFER_SMALL) {
+        return false;
+    }
+    CheckAPI(ret);
+    return true;
+}
+
+kvssd::kvs_result TryCompleteRow(const kvssd::kvs_completion &completion,
+                                 std::vector<ycsbc::DB::Field> *value) {
+    std::unique_ptr<kvs_row, KvsRowDeleter> row(static_cast<kvs_row *>(completion.private_data));
+    if (completion.opcode != kvssd::kvs_opcode::READ) {
+        return completion.result;
+    }
+    // Read rows point into the caller's buffer; keep the deleter off it.
+    const char *data = static_cast<char *>(row->value->value);
+    row->value->value = nullptr;
+    if (completion.result == kvssd::kvs_result::KVS_SUCCESS && value != nullptr) {
+        DeserializeRow(value, data, row->value->actual_value_size);
+    }
+    return completion.result;
+}
+
 }  // namespace kvssd_hashmap
@@ -3,6 +3,8 @@
 
 #include <atomic>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "core/db.h"
 #include "kvssd_hashmap_db.h"
@@ -35,11 +37,42 @@ struct KvsRowDeleter {
     }
 };
 
+// Fixed-offset row format: a header describing the layout, then one slot
+// per field in field number order, each a uint32_t length followed by
+// field_length bytes. Field names are the workload's prefix and the field
+// number, so a single field can be read or rewritten in place knowing only
+// its name. DeserializeRow recognizes these rows by their header.
+class FieldLayout {
+   public:
+    FieldLayout(std::string prefix, uint32_t field_count, uint32_t field_length);
+
+    // Slot of a field name, or -1 if the layout has none for it.
+    int SlotOf(const std::string &name) const;
+    uint32_t SlotOffset(int slot) const { return header_size + slot * SlotSize(); }
+    uint32_t SlotSize() const { return sizeof(uint32_t) + field_length; }
+    uint32_t FieldCount() const { return field_count; }
+
+    // Writes a whole row; fields not in values are left empty. Throws
+    // ycsbc::utils::Exception for fields outside the layout.
+    void SerializeRow(const std::vector<ycsbc::DB::Field> &values, std::string *data) const;
+    void SerializeSlot(const ycsbc::DB::Field &field, std::string *data) const;
+    // Appends the field of the slot at data to values.
+    void DeserializeSlot(int slot, const char *data, std::vector<ycsbc::DB::Field> *values) const;
+
+   private:
+    std::string prefix;
+    uint32_t field_count;
+    uint32_t field_length;
+    uint32_t header_size;
+};
+
 void SerializeRow(const std::vector<ycsbc::DB::Field> &values, std::string *data);
 void DeserializeRow(std::vector<ycsbc::DB::Field> *values, const char *data_ptr, size_t data_len);
 
+// layout selects the fixed-offset format instead of the packed one.
 std::unique_ptr<kvs_row, KvsRowDeleter> CreateRow(std::string_view key_in,
-                                                  const std::vector<ycsbc::DB::Field> &value_in);
+                                                  const std::vector<ycsbc::DB::Field> &value_in,
+                                                  const FieldLayout *layout = nullptr);
 
 void PrintRow(const kvssd::kvs_value &value);
 void PrintFieldVector(const std::vector<ycsbc::DB::Field> &value);
@@ -47,12 +80,93 @@ void PrintFieldVector(const std::vector<ycsbc::DB::Field> &value);
 void CheckAPI(const kvssd::kvs_result ret);
 
 // Wrapper Functions
+// Reads into buffer, a caller-owned scratch area that is grown as needed and
+// reused across calls, so that the read path does not allocate. The overload
+// without one uses a thread-local buffer.
+void ReadRow(kvssd::KVSSD &kvssd, const std::string &key, std::vector<ycsbc::DB::Field> &value,
+             std::vector<char> &buffer);
+// Like ReadRow, but returns false instead of throwing if the key is absent.
+bool TryReadRow(kvssd::KVSSD &kvssd, const std::string &key, std::vector<ycsbc::DB::Field> &value,
+                std::vector<char> &buffer);
 void ReadRow(kvssd::KVSSD &kvssd, const std::string &key, std::vector<ycsbc::DB::Field> &value);
 void InsertRow(kvssd::KVSSD &kvssd, const std::string &key,
-               const std::vector<ycsbc::DB::Field> &value);
+               const std::vector<ycsbc::DB::Field> &value, const FieldLayout *layout = nullptr);
 void UpdateRow(kvssd::KVSSD &kvssd, const std::string &key,
-               const std::vector<ycsbc::DB::Field> &value);
+               const std::vector<ycsbc::DB::Field> &value, const FieldLayout *layout = nullptr);
 void DeleteRow(kvssd::KVSSD &kvssd, const std::string &key);
+// Field-level access to rows stored in layout's format. ReadFields fetches
+// only the aligned blocks that hold the named fields and UpdateFields
+// rewrites only their slots. Backends without ranged access fall back to
+// whole rows. ReadFields returns false if the key is absent.
+bool ReadFields(kvssd::KVSSD &kvssd, const std::string &key, const FieldLayout &layout,
+                const std::vector<std::string> &fields, std::vector<ycsbc::DB::Field> &value,
+                std::vector<char> &buffer);
+void UpdateFields(kvssd::KVSSD &kvssd, const std::string &key, const FieldLayout &layout,
+                  const std::vector<ycsbc::DB::Field> &value, std::vector<char> &buffer);
+// Fetches the keys from key onwards through a key-group iterator, many per
+// call into key_buffer, then reads up to len rows through value_buffer.
+// Returns false if the backend does not support iterators.
+bool ScanRows(kvssd::KVSSD &kvssd, const std::string &key, int len,
+              std::vector<std::vector<ycsbc::DB::Field>> &values, std::vector<char> &key_buffer,
+              std::vector<char> &value_buffer);
+
+// Collects asynchronous writes into BatchInsert/BatchStore/BatchDelete
+// commands of up to capacity requests. Inserts fail on existing keys like
+// Insert; stores are upserts. Queuing a different kind of request, or filling
+// the batch, issues the pending ones. Once its batch has been issued, each
+// request is completed on the queue it was queued with, with its own result;
+// as with the Submit functions below, the returned row is its tag.
+class RowBatch {
+   public:
+    explicit RowBatch(size_t capacity) : capacity(capacity) {}
+
+    kvs_row *Insert(kvssd::KVSSD &kvssd, const std::string &key,
+                    const std::vector<ycsbc::DB::Field> &value, kvssd::CompletionQueue &cq,
+                    const FieldLayout *layout = nullptr);
+    kvs_row *Store(kvssd::KVSSD &kvssd, const std::string &key,
+                   const std::vector<ycsbc::DB::Field> &value, kvssd::CompletionQueue &cq,
+                   const FieldLayout *layout = nullptr);
+    kvs_row *Delete(kvssd::KVSSD &kvssd, const std::string &key, kvssd::CompletionQueue &cq);
+    void Flush(kvssd::KVSSD &kvssd);
+
+    bool Contains(const std::string &key) const;
+    size_t Size() const { return rows.size(); }
+
+   private:
+    size_t capacity;
+    kvssd::kvs_opcode op = kvssd::kvs_opcode::UPDATE;
+    std::vector<std::unique_ptr<kvs_row, KvsRowDeleter>> rows;
+    std::vector<kvssd::kvs_key> keys;
+    std::vector<kvssd::kvs_value> values;
+    std::vector<kvssd::kvs_result> results;
+    std::vector<kvssd::CompletionQueue *> queues;
+
+    kvs_row *Add(kvssd::KVSSD &kvssd, kvssd::kvs_opcode, std::unique_ptr<kvs_row, KvsRowDeleter>,
+                 kvssd::CompletionQueue &cq);
+};
+
+// Asynchronous wrapper functions. The row built for a request is its
+// private_data, returned as the request's tag, and stays alive until
+// CompleteRow consumes the completion. A read fills buffer, which must not be
+// touched until then.
+kvs_row *SubmitReadRow(kvssd::KVSSD &kvssd, const std::string &key, kvssd::CompletionQueue &cq,
+                       std::vector<char> &buffer);
+kvs_row *SubmitInsertRow(kvssd::KVSSD &kvssd, const std::string &key,
+                         const std::vector<ycsbc::DB::Field> &value, kvssd::CompletionQueue &cq,
+                         const FieldLayout *layout = nullptr);
+kvs_row *SubmitUpdateRow(kvssd::KVSSD &kvssd, const std::string &key,
+                         const std::vector<ycsbc::DB::Field> &value, kvssd::CompletionQueue &cq,
+                         const FieldLayout *layout = nullptr);
+kvs_row *SubmitDeleteRow(kvssd::KVSSD &kvssd, const std::string &key,
+                         kvssd::CompletionQueue &cq);
+// Returns false if a read did not fit its buffer; the value is then left
+// unset and the row has to be read again with ReadRow, which grows the buffer.
+bool CompleteRow(const kvssd::kvs_completion &completion, std::vector<ycsbc::DB::Field> *value);
+// Like CompleteRow, but returns the request's result instead of throwing,
+// such as KVS_ERR_KS_NOT_EXIST for a read of an absent key or
+// KVS_ERR_BUFFER_SMALL for a read that did not fit its buffer.
+kvssd::kvs_result TryCompleteRow(const kvssd::kvs_completion &completion,
+                                 std::vector<ycsbc::DB::Field> *value);
 
 }  // namespace kvssd_hashmap
 
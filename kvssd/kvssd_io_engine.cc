@@ -0,0 +1,414 @@
+#include "kvssd_io_engine.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "utils/timer.h"
+#include "utils/utils.h"
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define KVSSD_HAVE_IO_URING
+#endif
+
+namespace kvssd_file {
+
+namespace {
+uint64_t AlignDown(uint64_t n) { return n & ~uint64_t{KVS_ALIGNMENT_UNIT - 1}; }
+uint64_t AlignUp(uint64_t n) { return AlignDown(n + KVS_ALIGNMENT_UNIT - 1); }
+
+// Grow-only buffer aligned for direct I/O.
+struct AlignedBuffer {
+    char *data = nullptr;
+    size_t size = 0;
+
+    ~AlignedBuffer() { free(data); }
+    bool Reserve(size_t length) {
+        if (length <= size) {
+            return true;
+        }
+        free(data);
+        size = AlignUp(length);
+        data = static_cast<char *>(aligned_alloc(KVS_ALIGNMENT_UNIT, size));
+        if (data == nullptr) {
+            size = 0;
+        }
+        return data != nullptr;
+    }
+};
+
+class PsyncEngine : public IoEngine {
+   public:
+    PsyncEngine(int fd, bool direct) : IoEngine(direct), fd(fd) {}
+    ~PsyncEngine() override { close(fd); }
+
+    bool Read(void *buf, size_t length, uint64_t offset) override {
+        ycsbc::utils::Timer<uint64_t, std::nano> total, device;
+        total.Start();
+        uint64_t start = Direct() ? AlignDown(offset) : offset;
+        uint64_t end = Direct() ? AlignUp(offset + length) : offset + length;
+        thread_local AlignedBuffer bounce;
+        char *target = static_cast<char *>(buf);
+        if (Direct()) {
+            if (!bounce.Reserve(end - start)) {
+                return false;
+            }
+            target = bounce.data;
+        }
+        device.Start();
+        bool ok = Transfer(false, target, end - start, start);
+        uint64_t device_ns = device.End();
+        if (ok && Direct()) {
+            std::memcpy(buf, bounce.data + (offset - start), length);
+        }
+        Account(false, device_ns, total.End());
+        return ok;
+    }
+
+    bool Write(const void *buf, size_t length, uint64_t offset) override {
+        ycsbc::utils::Timer<uint64_t, std::nano> total, device;
+        total.Start();
+        thread_local AlignedBuffer bounce;
+        auto *source = static_cast<const char *>(buf);
+        if (Direct()) {
+            if (AlignDown(offset) != offset || AlignDown(length) != length ||
+                !bounce.Reserve(length)) {
+                return false;
+            }
+            std::memcpy(bounce.data, buf, length);
+            source = bounce.data;
+        }
+        device.Start();
+        bool ok = Transfer(true, const_cast<char *>(source), length, offset);
+        Account(true, device.End(), total.End());
+        return ok;
+    }
+
+    void SetFile(int new_fd) override {
+        close(fd);
+        fd = new_fd;
+    }
+
+   private:
+    int fd;
+
+    bool Transfer(bool write, char *p, size_t length, uint64_t offset) {
+        while (length > 0) {
+            ssize_t n = write ? pwrite(fd, p, length, static_cast<off_t>(offset))
+                              : pread(fd, p, length, static_cast<off_t>(offset));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            p += n;
+            length -= n;
+            offset += n;
+        }
+        return true;
+    }
+};
+
+#ifdef KVSSD_HAVE_IO_URING
+
+// io_uring driven through the raw system calls, so no liburing is needed. The
+// log file is registered as fixed file 0 and every ring owns one registered
+// buffer, so requests are READ_FIXED / WRITE_FIXED. A ring carries one request
+// at a time; concurrent callers each take a ring from the pool, which makes
+// the queue depth seen by the device the number of threads doing I/O.
+class UringEngine : public IoEngine {
+   public:
+    UringEngine(int fd, bool direct) : IoEngine(direct), fd(fd) {
+        auto ring = std::make_unique<Ring>();
+        if (!ring->Setup(fd)) {
+            int err = errno;
+            close(fd);
+            throw ycsbc::utils::Exception(std::string("io_uring is not available: ") +
+                                          std::strerror(err));
+        }
+        idle.push_back(ring.get());
+        rings.push_back(std::move(ring));
+    }
+    ~UringEngine() override {
+        rings.clear();
+        close(fd);
+    }
+
+    bool Read(void *buf, size_t length, uint64_t offset) override {
+        ycsbc::utils::Timer<uint64_t, std::nano> total;
+        total.Start();
+        uint64_t start = Direct() ? AlignDown(offset) : offset;
+        uint64_t end = Direct() ? AlignUp(offset + length) : offset + length;
+        uint64_t device_ns = 0;
+        Ring *ring = Acquire();
+        bool ok = ring && ring->Reserve(end - start) &&
+                  ring->Transfer(IORING_OP_READ_FIXED, end - start, start, device_ns);
+        if (ok) {
+            std::memcpy(buf, ring->buffer + (offset - start), length);
+        }
+        Release(ring);
+        Account(false, device_ns, total.End());
+        return ok;
+    }
+
+    bool Write(const void *buf, size_t length, uint64_t offset) override {
+        if (Direct() && (AlignDown(offset) != offset || AlignDown(length) != length)) {
+            return false;
+        }
+        ycsbc::utils::Timer<uint64_t, std::nano> total;
+        total.Start();
+        uint64_t device_ns = 0;
+        Ring *ring = Acquire();
+        bool ok = ring && ring->Reserve(length);
+        if (ok) {
+            std::memcpy(ring->buffer, buf, length);
+            ok = ring->Transfer(IORING_OP_WRITE_FIXED, length, offset, device_ns);
+        }
+        Release(ring);
+        Account(true, device_ns, total.End());
+        return ok;
+    }
+
+    void SetFile(int new_fd) override {
+        std::lock_guard<std::mutex> lock(mu);
+        for (auto &ring : rings) {
+            ring->UpdateFile(new_fd);
+        }
+        close(fd);
+        fd = new_fd;
+    }
+
+   private:
+    static constexpr unsigned RING_ENTRIES = 2;
+    static constexpr size_t MIN_BUFFER_SIZE = 64 * 1024;
+
+    struct Ring {
+        int fd = -1;
+        void *sq_ptr = MAP_FAILED;
+        void *cq_ptr = MAP_FAILED;
+        size_t sq_size = 0;
+        size_t cq_size = 0;
+        io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+        size_t sqes_size = 0;
+        unsigned *sq_tail, *sq_mask, *sq_array;
+        unsigned *cq_head, *cq_tail, *cq_mask;
+        io_uring_cqe *cqes;
+        char *buffer = nullptr;
+        size_t buffer_size = 0;
+
+        ~Ring() {
+            if (sqes != MAP_FAILED) {
+                munmap(sqes, sqes_size);
+            }
+            if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) {
+                munmap(cq_ptr, cq_size);
+            }
+            if (sq_ptr != MAP_FAILED) {
+                munmap(sq_ptr, sq_size);
+            }
+            if (fd >= 0) {
+                close(fd);
+            }
+            free(buffer);
+        }
+
+        bool Setup(int file) {
+            io_uring_params params{};
+            fd = static_cast<int>(syscall(__NR_io_uring_setup, RING_ENTRIES, &params));
+            if (fd < 0) {
+                return false;
+            }
+            sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single_mmap) {
+                sq_size = cq_size = std::max(sq_size, cq_size);
+            }
+            sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                          IORING_OFF_SQ_RING);
+            if (sq_ptr == MAP_FAILED) {
+                return false;
+            }
+            cq_ptr = single_mmap ? sq_ptr
+                                 : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE,
+                                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cq_ptr == MAP_FAILED) {
+                return false;
+            }
+            sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            sqes = static_cast<io_uring_sqe *>(mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                                                    MAP_SHARED | MAP_POPULATE, fd,
+                                                    IORING_OFF_SQES));
+            if (sqes == MAP_FAILED) {
+                return false;
+            }
+            auto *sq = static_cast<char *>(sq_ptr);
+            auto *cq = static_cast<char *>(cq_ptr);
+            sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+            sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+            sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+            cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+            cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+            cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+            return syscall(__NR_io_uring_register, fd, IORING_REGISTER_FILES, &file, 1) == 0;
+        }
+
+        void UpdateFile(int file) {
+            io_uring_files_update update{};
+            update.offset = 0;
+            update.fds = reinterpret_cast<uintptr_t>(&file);
+            syscall(__NR_io_uring_register, fd, IORING_REGISTER_FILES_UPDATE, &update, 1);
+        }
+
+        // Makes the registered buffer at least length bytes long.
+        bool Reserve(size_t length) {
+            if (length <= buffer_size) {
+                return true;
+            }
+            if (buffer != nullptr) {
+                syscall(__NR_io_uring_register, fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+                free(buffer);
+            }
+            buffer_size = AlignUp(std::max(length, MIN_BUFFER_SIZE));
+            buffer = static_cast<char *>(aligned_alloc(KVS_ALIGNMENT_UNIT, buffer_size));
+            iovec iov{buffer, buffer_size};
+            if (buffer == nullptr ||
+                syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, &iov, 1) != 0) {
+                free(buffer);
+                buffer = nullptr;
+                buffer_size = 0;
+                return false;
+            }
+            return true;
+        }
+
+        // Moves length bytes between the registered buffer and the file,
+        // resubmitting after short transfers.
+        bool Transfer(uint8_t opcode, size_t length, uint64_t offset, uint64_t &device_ns) {
+            size_t done = 0;
+            while (done < length) {
+                unsigned tail = *sq_tail;
+                unsigned idx = tail & *sq_mask;
+                io_uring_sqe &sqe = sqes[idx];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = opcode;
+                sqe.flags = IOSQE_FIXED_FILE;
+                sqe.fd = 0;
+                sqe.addr = reinterpret_cast<uintptr_t>(buffer + done);
+                sqe.len = static_cast<uint32_t>(length - done);
+                sqe.off = offset + done;
+                sqe.buf_index = 0;
+                sq_array[idx] = idx;
+                __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+                ycsbc::utils::Timer<uint64_t, std::nano> device;
+                device.Start();
+                int res = SubmitAndWait();
+                device_ns += device.End();
+                if (res == -EINTR || res == -EAGAIN) {
+                    continue;
+                }
+                if (res <= 0) {
+                    return false;
+                }
+                done += res;
+            }
+            return true;
+        }
+
+        int SubmitAndWait() {
+            unsigned to_submit = 1;
+            unsigned head = *cq_head;
+            while (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+                long ret = syscall(__NR_io_uring_enter, fd, to_submit, 1, IORING_ENTER_GETEVENTS,
+                                   nullptr, 0);
+                if (ret < 0 && errno != EINTR) {
+                    return -errno;
+                }
+                if (ret > 0) {
+                    to_submit = 0;
+                }
+            }
+            int res = cqes[head & *cq_mask].res;
+            __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+            return res;
+        }
+    };
+
+    int fd;
+    std::mutex mu;
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::vector<Ring *> idle;
+
+    // Hands out an idle ring, creating one if none is left. Returns nullptr
+    // if a new ring cannot be set up.
+    Ring *Acquire() {
+        std::lock_guard<std::mutex> lock(mu);
+        if (!idle.empty()) {
+            Ring *ring = idle.back();
+            idle.pop_back();
+            return ring;
+        }
+        auto ring = std::make_unique<Ring>();
+        if (!ring->Setup(fd)) {
+            return nullptr;
+        }
+        rings.push_back(std::move(ring));
+        return rings.back().get();
+    }
+
+    void Release(Ring *ring) {
+        if (ring == nullptr) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mu);
+        idle.push_back(ring);
+    }
+};
+
+#endif  // KVSSD_HAVE_IO_URING
+}  // anonymous namespace
+
+kvssd::kvs_io_stats IoEngine::Stats() const {
+    return {reads.load(),        writes.load(),        read_device_ns.load(),
+            read_host_ns.load(), write_device_ns.load(), write_host_ns.load()};
+}
+
+void IoEngine::Account(bool write, uint64_t device_ns, uint64_t total_ns) {
+    uint64_t host_ns = total_ns > device_ns ? total_ns - device_ns : 0;
+    if (write) {
+        writes.fetch_add(1, std::memory_order_relaxed);
+        write_device_ns.fetch_add(device_ns, std::memory_order_relaxed);
+        write_host_ns.fetch_add(host_ns, std::memory_order_relaxed);
+    } else {
+        reads.fetch_add(1, std::memory_order_relaxed);
+        read_device_ns.fetch_add(device_ns, std::memory_order_relaxed);
+        read_host_ns.fetch_add(host_ns, std::memory_order_relaxed);
+    }
+}
+
+std::unique_ptr<IoEngine> NewIoEngine(const std::string &name, int fd, bool direct) {
+    if (name == "psync") {
+        return std::make_unique<PsyncEngine>(fd, direct);
+    }
+#ifdef KVSSD_HAVE_IO_URING
+    if (name == "io_uring") {
+        return std::make_unique<UringEngine>(fd, direct);
+    }
+#endif
+    close(fd);
+    throw ycsbc::utils::Exception("Unknown kvssd io engine: " + name);
+}
+
+}  // namespace kvssd_file
@@ -0,0 +1,56 @@
+#ifndef YCSB_C_KVSSD_IO_ENGINE_H_
+#define YCSB_C_KVSSD_IO_ENGINE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "kvssd.h"
+#include "kvssd_const.h"
+
+namespace kvssd_file {
+
+// Positioned I/O on the log file of File_KVSSD. The engine owns the file
+// descriptor it is given. With direct I/O, writes must cover whole
+// KVS_ALIGNMENT_UNIT blocks; reads may be unaligned and go through an aligned
+// bounce buffer.
+//
+// Every call is timed twice: device time runs from submitting the request to
+// the kernel until its completion, host time is everything else the engine
+// spends on it (bounce copies, queue setup, waiting for a ring).
+class IoEngine {
+   public:
+    explicit IoEngine(bool direct) : direct(direct) {}
+    virtual ~IoEngine() = default;
+
+    virtual bool Read(void *buf, size_t length, uint64_t offset) = 0;
+    virtual bool Write(const void *buf, size_t length, uint64_t offset) = 0;
+    // Switches to another file, e.g. after compaction. Called while no I/O
+    // is in flight.
+    virtual void SetFile(int fd) = 0;
+
+    bool Direct() const { return direct; }
+    kvssd::kvs_io_stats Stats() const;
+
+   protected:
+    void Account(bool write, uint64_t device_ns, uint64_t total_ns);
+
+   private:
+    bool direct;
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> writes{0};
+    std::atomic<uint64_t> read_device_ns{0};
+    std::atomic<uint64_t> read_host_ns{0};
+    std::atomic<uint64_t> write_device_ns{0};
+    std::atomic<uint64_t> write_host_ns{0};
+};
+
+// name is "psync" (pread/pwrite) or "io_uring". Throws
+// ycsbc::utils::Exception for unknown or unavailable engines.
+std::unique_ptr<IoEngine> NewIoEngine(const std::string &name, int fd, bool direct);
+
+}  // namespace kvssd_file
+
+#endif  // YCSB_C_KVSSD_IO_ENGINE_H_
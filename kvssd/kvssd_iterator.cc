@@ -0,0 +1,102 @@
+#include "kvssd_iterator.h"
+
+#include <cstring>
+
+namespace kvssd {
+
+bool MatchesFilter(const kvs_key_group_filter &filter, std::string_view key) {
+    for (size_t i = 0; i < sizeof(filter.bitmask); i++) {
+        auto byte = static_cast<uint8_t>(i < key.size() ? key[i] : 0);
+        if ((byte & filter.bitmask[i]) != filter.bit_pattern[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+kvs_result IteratorTable::Open(const kvs_key_group_filter &filter, const kvs_key *start,
+                               kvs_iterator_handle &handle) {
+    // A pattern bit outside the mask can never match.
+    for (size_t i = 0; i < sizeof(filter.bitmask); i++) {
+        if (filter.bit_pattern[i] & ~filter.bitmask[i]) {
+            return kvs_result::KVS_ERR_ITERATOR_FILTER_INVALID;
+        }
+    }
+    Cursor cursor{filter, {}, true};
+    if (start != nullptr) {
+        if (kvs_result ret = ValidateRequest(*start, std::nullopt);
+            ret != kvs_result::KVS_SUCCESS) {
+            return ret;
+        }
+        cursor.position.assign(static_cast<const char *>(start->key), start->length);
+    }
+
+    std::lock_guard<std::mutex> lock(mu);
+    for (size_t i = 0; i < cursors.size(); i++) {
+        if (!cursors[i]) {
+            cursors[i] = std::move(cursor);
+            handle = static_cast<kvs_iterator_handle>(i + 1);
+            return kvs_result::KVS_SUCCESS;
+        }
+    }
+    return kvs_result::KVS_ERR_ITERATOR_MAX;
+}
+
+// An iterator is driven by the thread that opened it, so the cursor is used
+// outside the table lock.
+IteratorTable::Cursor *IteratorTable::Get(kvs_iterator_handle handle) {
+    std::lock_guard<std::mutex> lock(mu);
+    if (handle == 0 || cursors.size() < handle || !cursors[handle - 1]) {
+        return nullptr;
+    }
+    return &*cursors[handle - 1];
+}
+
+kvs_result IteratorTable::Next(kvs_iterator_handle handle, kvs_iterator_list &list,
+                               const Collector &collect) {
+    Cursor *cursor = Get(handle);
+    if (cursor == nullptr) {
+        return kvs_result::KVS_ERR_ITERATOR_NOT_EXIST;
+    }
+    if (list.it_list == nullptr) {
+        return kvs_result::KVS_ERR_PARAM_INVALID;
+    }
+
+    std::vector<std::string> keys;
+    bool exhausted = collect(*cursor, list.size, keys);
+
+    auto *out = static_cast<char *>(list.it_list);
+    size_t used = 0;
+    uint32_t packed = 0;
+    for (const std::string &key : keys) {
+        auto length = static_cast<uint32_t>(key.size());
+        if (list.size < used + sizeof(length) + length) {
+            break;
+        }
+        std::memcpy(out + used, &length, sizeof(length));
+        std::memcpy(out + used + sizeof(length), key.data(), length);
+        used += sizeof(length) + length;
+        packed++;
+    }
+    if (packed == 0 && !keys.empty()) {
+        return kvs_result::KVS_ERR_BUFFER_SMALL;
+    }
+    if (packed > 0) {
+        cursor->position = keys[packed - 1];
+        cursor->inclusive = false;
+    }
+    list.num_entries = packed;
+    list.end = exhausted && packed == keys.size();
+    return kvs_result::KVS_SUCCESS;
+}
+
+kvs_result IteratorTable::Close(kvs_iterator_handle handle) {
+    std::lock_guard<std::mutex> lock(mu);
+    if (handle == 0 || cursors.size() < handle || !cursors[handle - 1]) {
+        return kvs_result::KVS_ERR_ITERATOR_NOT_EXIST;
+    }
+    cursors[handle - 1].reset();
+    return kvs_result::KVS_SUCCESS;
+}
+
+}  // namespace kvssd
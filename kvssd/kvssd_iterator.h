@@ -0,0 +1,51 @@
+#ifndef YCSB_C_KVSSD_ITERATOR_H_
+#define YCSB_C_KVSSD_ITERATOR_H_
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "kvssd.h"
+#include "kvssd_const.h"
+
+namespace kvssd {
+
+bool MatchesFilter(const kvs_key_group_filter &filter, std::string_view key);
+
+// Open iterators of one device. A cursor only remembers the last key it
+// returned, so iterators stay valid while the index is modified and each
+// IteratorNext resumes from the next larger key.
+class IteratorTable {
+   public:
+    struct Cursor {
+        kvs_key_group_filter filter;
+        std::string position;
+        bool inclusive;  // position itself has not been returned yet
+    };
+
+    // Appends, in ascending order, keys of the cursor's group that follow its
+    // position, until about budget bytes of packed entries are collected.
+    // Returns true when the end of the index was reached.
+    using Collector =
+        std::function<bool(const Cursor &, size_t budget, std::vector<std::string> &keys)>;
+
+    kvs_result Open(const kvs_key_group_filter &, const kvs_key *start, kvs_iterator_handle &);
+    kvs_result Next(kvs_iterator_handle, kvs_iterator_list &, const Collector &);
+    kvs_result Close(kvs_iterator_handle);
+
+   private:
+    std::mutex mu;
+    // Handle h refers to cursors[h - 1].
+    std::array<std::optional<Cursor>, KVS_MAX_ITERATE_HANDLE> cursors;
+
+    Cursor *Get(kvs_iterator_handle);
+};
+
+}  // namespace kvssd
+
+#endif  // YCSB_C_KVSSD_ITERATOR_H_
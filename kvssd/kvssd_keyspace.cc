@@ -0,0 +1,77 @@
+#include "kvssd_keyspace.h"
+
+#include <utility>
+
+namespace kvssd {
+
+kvs_result KeySpaceTable::Create(const std::string &name, uint64_t capacity) {
+    if (name.empty() || KVS_MAX_KEY_SPACE_NAME_LENGTH < name.size()) {
+        return kvs_result::KVS_ERR_KS_NAME;
+    }
+    const std::lock_guard<std::mutex> lock(mu);
+    if (spaces.count(name)) {
+        return kvs_result::KVS_ERR_KS_EXIST;
+    }
+    if (spaces.size() >= KVS_MAX_KEY_SPACES) {
+        return kvs_result::KVS_ERR_DEV_CAPAPCITY;
+    }
+    std::unique_ptr<KVSSD> kv = factory(name);
+    if (capacity) {
+        if (kvs_result ret = kv->SetCapacity(capacity); ret != kvs_result::KVS_SUCCESS) {
+            return ret;
+        }
+    }
+    spaces[name].kv = std::move(kv);
+    return kvs_result::KVS_SUCCESS;
+}
+
+kvs_result KeySpaceTable::Delete(const std::string &name) {
+    const std::lock_guard<std::mutex> lock(mu);
+    auto it = spaces.find(name);
+    if (it == spaces.end()) {
+        return kvs_result::KVS_ERR_KS_NOT_EXIST;
+    }
+    if (it->second.opens) {
+        return kvs_result::KVS_ERR_KS_OPEN;
+    }
+    spaces.erase(it);
+    return kvs_result::KVS_SUCCESS;
+}
+
+kvs_result KeySpaceTable::Open(const std::string &name, KVSSD *&handle) {
+    const std::lock_guard<std::mutex> lock(mu);
+    auto it = spaces.find(name);
+    if (it == spaces.end()) {
+        return kvs_result::KVS_ERR_KS_NOT_EXIST;
+    }
+    it->second.opens++;
+    handle = it->second.kv.get();
+    return kvs_result::KVS_SUCCESS;
+}
+
+// There are only a few key spaces, so handles are looked up by a scan.
+kvs_result KeySpaceTable::Close(KVSSD *handle) {
+    if (handle == nullptr) {
+        return kvs_result::KVS_ERR_PARAM_INVALID;
+    }
+    const std::lock_guard<std::mutex> lock(mu);
+    for (auto &[name, space] : spaces) {
+        if (space.kv.get() == handle) {
+            if (space.opens == 0) {
+                return kvs_result::KVS_ERR_KS_NOT_OPEN;
+            }
+            space.opens--;
+            return kvs_result::KVS_SUCCESS;
+        }
+    }
+    return kvs_result::KVS_ERR_KS_NOT_OPEN;
+}
+
+void KeySpaceTable::ForEach(const std::function<void(const std::string &, KVSSD &)> &fn) {
+    const std::lock_guard<std::mutex> lock(mu);
+    for (auto &[name, space] : spaces) {
+        fn(name, *space.kv);
+    }
+}
+
+}  // namespace kvssd
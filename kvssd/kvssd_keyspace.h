@@ -0,0 +1,53 @@
+#ifndef YCSB_C_KVSSD_KEYSPACE_H_
+#define YCSB_C_KVSSD_KEYSPACE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "kvssd.h"
+#include "kvssd_const.h"
+
+namespace kvssd {
+
+// Named key spaces of one device, modelled on kvs_create_key_space and
+// friends. Each key space is a backend of its own, built by the factory when
+// it is created, so key spaces share neither their index nor its locks.
+// A handle is the key space's KVSSD interface and stays valid until the key
+// space is deleted, which is refused while any handle to it is open.
+class KeySpaceTable {
+   public:
+    using Factory = std::function<std::unique_ptr<KVSSD>(const std::string &name)>;
+
+    explicit KeySpaceTable(Factory factory) : factory(std::move(factory)) {}
+
+    // capacity is the key space's quota in bytes of keys and values (see
+    // KVSSD::SetCapacity); 0 leaves it unlimited.
+    kvs_result Create(const std::string &name, uint64_t capacity);
+    kvs_result Delete(const std::string &name);
+    // Each Open of a key space needs its own Close.
+    kvs_result Open(const std::string &name, KVSSD *&handle);
+    kvs_result Close(KVSSD *handle);
+
+    // Calls fn for every key space, in name order.
+    void ForEach(const std::function<void(const std::string &name, KVSSD &)> &fn);
+
+   private:
+    struct KeySpace {
+        std::unique_ptr<KVSSD> kv;
+        size_t opens = 0;
+    };
+
+    Factory factory;
+    std::mutex mu;
+    std::map<std::string, KeySpace> spaces;
+};
+
+}  // namespace kvssd
+
+#endif  // YCSB_C_KVSSD_KEYSPACE_H_
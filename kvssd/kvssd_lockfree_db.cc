@@ -0,0 +1,190 @@
+#include "kvssd_lockfree_db.h"
+
+#include <cstdlib>
+#include <thread>
+
+#include "kvssd_epoch.h"
+
+namespace kvssd_lockfree {
+
+LockFree_KVSSD::LockFree_KVSSD(size_t capacity) {
+    size_t slots_count = 2;
+    while (slots_count < capacity) {
+        slots_count <<= 1;
+    }
+    mask = slots_count - 1;
+    slots.reset(new Slot[slots_count]);
+}
+
+// Records retired earlier are owned by the epoch domain; only the ones still
+// published in the table are freed here.
+LockFree_KVSSD::~LockFree_KVSSD() {
+    for (size_t i = 0; i <= mask; i++) {
+        free(slots[i].record.load(std::memory_order_relaxed));
+    }
+}
+
+uint64_t LockFree_KVSSD::HashOf(const kvssd::kvs_key &key) {
+    uint64_t hash = std::hash<kvssd::kvs_key>{}(key);
+    return hash == EMPTY ? 1 : hash;
+}
+
+LockFree_KVSSD::Record *LockFree_KVSSD::NewRecord(const kvssd::kvs_key &key,
+                                                  const kvssd::kvs_value *value) {
+    uint32_t value_length = value ? value->length : 0;
+    auto *record = static_cast<Record *>(malloc(sizeof(Record) + key.length + value_length));
+    record->key_length = key.length;
+    record->deleted = value == nullptr;
+    record->length = value_length;
+    record->actual_value_size = value ? value->actual_value_size : 0;
+    record->offset = value ? value->offset : 0;
+    std::memcpy(record->Key(), key.key, key.length);
+    if (value_length) {
+        std::memcpy(record->Value(), value->value, value_length);
+    }
+    return record;
+}
+
+bool LockFree_KVSSD::KeyMatches(Record *record, const kvssd::kvs_key &key) {
+    return record->key_length == key.length &&
+           std::memcmp(record->Key(), key.key, key.length) == 0;
+}
+
+// Returns the slot bound to key, or nullptr. Slots that are still being
+// claimed by an inserter are skipped: that key is not visible yet.
+//
+// Slot accesses here and below keep the default sequentially consistent
+// ordering, which is what orders them after the EpochDomain pin.
+LockFree_KVSSD::Slot *LockFree_KVSSD::Find(const kvssd::kvs_key &key, uint64_t hash) {
+    for (size_t i = hash & mask, n = 0; n <= mask; i = (i + 1) & mask, n++) {
+        Slot &slot = slots[i];
+        uint64_t slot_hash = slot.hash.load();
+        if (slot_hash == EMPTY) {
+            return nullptr;
+        }
+        if (slot_hash != hash) {
+            continue;
+        }
+        Record *record = slot.record.load();
+        if (record != nullptr && KeyMatches(record, key)) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+// API Functions
+kvssd::kvs_result LockFree_KVSSD::Read(const kvssd::kvs_key &key, kvssd::kvs_value &value_out) {
+    if (kvssd::kvs_result ret = kvssd::ValidateRequest(key, value_out);
+        ret != kvssd::kvs_result::KVS_SUCCESS) {
+        return ret;
+    }
+    EpochDomain::Guard guard;
+    Slot *slot = Find(key, HashOf(key));
+    if (slot == nullptr) {
+        return kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST;
+    }
+    Record *record = slot->record.load();
+    if (record->deleted) {
+        return kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST;
+    }
+    value_out.actual_value_size = record->length;
+    if (record->length < value_out.offset) {
+        return kvssd::kvs_result::KVS_ERR_VALUE_OFFSET_INVALID;
+    }
+    uint32_t rest = record->length - value_out.offset;
+    if (value_out.length < rest) {
+        return kvssd::kvs_result::KVS_ERR_BUFFER_SMALL;
+    }
+    if (rest) {
+        std::memcpy(value_out.value, record->Value() + value_out.offset, rest);
+    }
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+kvssd::kvs_result LockFree_KVSSD::Insert(const kvssd::kvs_key &key,
+                                         const kvssd::kvs_value &value) {
+    if (kvssd::kvs_result ret = kvssd::ValidateRequest(key, value);
+        ret != kvssd::kvs_result::KVS_SUCCESS) {
+        return ret;
+    }
+    Record *new_record = NewRecord(key, &value);
+    uint64_t hash = HashOf(key);
+
+    EpochDomain::Guard guard;
+    for (size_t i = hash & mask, n = 0; n <= mask; i = (i + 1) & mask, n++) {
+        Slot &slot = slots[i];
+        uint64_t slot_hash = slot.hash.load();
+        if (slot_hash == EMPTY && slot.hash.compare_exchange_strong(slot_hash, hash)) {
+            slot.record.store(new_record);
+            return kvssd::kvs_result::KVS_SUCCESS;
+        }
+        if (slot_hash != hash) {
+            continue;
+        }
+        // The slot may belong to this key; wait for its claimer to publish.
+        Record *record;
+        while ((record = slot.record.load()) == nullptr) {
+            std::this_thread::yield();
+        }
+        if (!KeyMatches(record, key)) {
+            continue;
+        }
+        while (record->deleted) {
+            if (slot.record.compare_exchange_weak(record, new_record)) {
+                EpochDomain::Instance().Retire(record);
+                return kvssd::kvs_result::KVS_SUCCESS;
+            }
+        }
+        free(new_record);
+        return kvssd::kvs_result::KVS_ERR_KS_EXIST;
+    }
+    free(new_record);
+    return kvssd::kvs_result::KVS_ERR_DEV_CAPAPCITY;
+}
+
+kvssd::kvs_result LockFree_KVSSD::Update(const kvssd::kvs_key &key,
+                                         const kvssd::kvs_value &value) {
+    if (kvssd::kvs_result ret = kvssd::ValidateRequest(key, value);
+        ret != kvssd::kvs_result::KVS_SUCCESS) {
+        return ret;
+    }
+    Record *new_record = NewRecord(key, &value);
+
+    EpochDomain::Guard guard;
+    if (Slot *slot = Find(key, HashOf(key)); slot != nullptr) {
+        Record *record = slot->record.load();
+        while (!record->deleted) {
+            if (slot->record.compare_exchange_weak(record, new_record)) {
+                EpochDomain::Instance().Retire(record);
+                return kvssd::kvs_result::KVS_SUCCESS;
+            }
+        }
+    }
+    free(new_record);
+    return kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST;
+}
+
+kvssd::kvs_result LockFree_KVSSD::Delete(const kvssd::kvs_key &key) {
+    if (kvssd::kvs_result ret = kvssd::ValidateRequest(key, std::nullopt);
+        ret != kvssd::kvs_result::KVS_SUCCESS) {
+        return ret;
+    }
+    // Deletion leaves a tombstone so the slot stays bound to the key.
+    Record *tombstone = NewRecord(key, nullptr);
+
+    EpochDomain::Guard guard;
+    if (Slot *slot = Find(key, HashOf(key)); slot != nullptr) {
+        Record *record = slot->record.load();
+        while (!record->deleted) {
+            if (slot->record.compare_exchange_weak(record, tombstone)) {
+                EpochDomain::Instance().Retire(record);
+                return kvssd::kvs_result::KVS_SUCCESS;
+            }
+        }
+    }
+    free(tombstone);
+    return kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST;
+}
+
+}  // namespace kvssd_lockfree
@@ -0,0 +1,63 @@
+#ifndef YCSB_C_KVSSD_LOCKFREE_DB_H_
+#define YCSB_C_KVSSD_LOCKFREE_DB_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "kvssd.h"
+#include "kvssd_const.h"
+#include "kvssd_hashmap_db.h"
+
+namespace kvssd_lockfree {
+
+// Fixed-capacity open-addressing table with linear probing. A slot is bound
+// to one key for the lifetime of the table: its hash is claimed once with a
+// CAS and every record it ever points to carries the same key. Records are
+// immutable; writers swap in a new record and retire the old one through
+// EpochDomain, so Read never blocks and never sees freed memory.
+class LockFree_KVSSD : public kvssd::KVSSD {
+   public:
+    explicit LockFree_KVSSD(size_t capacity);
+    ~LockFree_KVSSD() final;
+
+    kvssd::kvs_result Read(const kvssd::kvs_key &, kvssd::kvs_value &) final;
+    kvssd::kvs_result Insert(const kvssd::kvs_key &, const kvssd::kvs_value &) final;
+    kvssd::kvs_result Update(const kvssd::kvs_key &, const kvssd::kvs_value &) final;
+    kvssd::kvs_result Delete(const kvssd::kvs_key &) final;
+
+    size_t Capacity() const { return mask + 1; }
+
+   private:
+    static constexpr uint64_t EMPTY = 0;
+
+    // Allocated as one block: header, then key bytes, then value bytes.
+    struct Record {
+        uint32_t length;
+        uint32_t actual_value_size;
+        uint32_t offset;
+        uint16_t key_length;
+        bool deleted;
+
+        char *Key() { return reinterpret_cast<char *>(this + 1); }
+        char *Value() { return Key() + key_length; }
+    };
+
+    struct Slot {
+        std::atomic<uint64_t> hash{EMPTY};
+        std::atomic<Record *> record{nullptr};
+    };
+
+    size_t mask;
+    std::unique_ptr<Slot[]> slots;
+
+    static uint64_t HashOf(const kvssd::kvs_key &);
+    static Record *NewRecord(const kvssd::kvs_key &, const kvssd::kvs_value *);
+    static bool KeyMatches(Record *, const kvssd::kvs_key &);
+    Slot *Find(const kvssd::kvs_key &, uint64_t hash);
+};
+
+}  // namespace kvssd_lockfree
+
+#endif  // YCSB_C_KVSSD_LOCKFREE_DB_H_
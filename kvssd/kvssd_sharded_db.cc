@@ -0,0 +1,377 @@
+#include "kvssd_sharded_db.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <string_view>
+#include <utility>
+
+namespace kvssd_hashmap {
+
+Sharded_KVSSD::Sharded_KVSSD(size_t num_shards, size_t async_workers)
+    : num_shards(num_shards == 0 ? 1 : num_shards), shards(new Shard[this->num_shards]) {
+    if (async_workers > 0) {
+        sq = std::make_unique<kvssd::SubmissionQueue>(*this, async_workers);
+    }
+}
+
+// Workers must be joined before the shards they execute against go away.
+Sharded_KVSSD::~Sharded_KVSSD() { sq.reset(); }
+
+void Sharded_KVSSD::SetTimingModel(const std::shared_ptr<kvssd::TimingModel> &model) {
+    for (size_t i = 0; i < num_shards; i++) {
+        shards[i].kv.SetTimingModel(model);
+    }
+}
+
+void Sharded_KVSSD::Reserve(size_t records, float max_load_factor) {
+    for (size_t i = 0; i < num_shards; i++) {
+        shards[i].kv.Reserve((records + num_shards - 1) / num_shards, max_load_factor);
+    }
+}
+
+void Sharded_KVSSD::EnableFilter(size_t expected_keys, double counters_per_key) {
+    for (size_t i = 0; i < num_shards; i++) {
+        shards[i].kv.EnableFilter((expected_keys + num_shards - 1) / num_shards, counters_per_key);
+    }
+}
+
+size_t Sharded_KVSSD::ShardIndex(const kvssd::kvs_key &key) const {
+    // Invalid keys are routed to the first shard, which rejects them.
+    if (key.key == nullptr) {
+        return 0;
+    }
+    // The low bits of the hash pick the bucket inside the shard's map, so the
+    // shard index is taken from the high bits to keep the two independent.
+    size_t hash = std::hash<kvssd::kvs_key>{}(key);
+    return (hash >> 32) % num_shards;
+}
+
+std::vector<std::vector<size_t>> Sharded_KVSSD::SplitBatch(const kvssd::kvs_key *keys,
+                                                           size_t num) const {
+    std::vector<std::vector<size_t>> split(num_shards);
+    for (size_t i = 0; i < num; i++) {
+        split[ShardIndex(keys[i])].push_back(i);
+    }
+    return split;
+}
+
+// API Functions
+kvssd::kvs_result Sharded_KVSSD::Read(const kvssd::kvs_key &key, kvssd::kvs_value &value_out) {
+    return ShardFor(key).Read(key, value_out);
+}
+
+kvssd::kvs_result Sharded_KVSSD::Insert(const kvssd::kvs_key &key, const kvssd::kvs_value &value) {
+    return ShardFor(key).Insert(key, value);
+}
+
+kvssd::kvs_result Sharded_KVSSD::Update(const kvssd::kvs_key &key, const kvssd::kvs_value &value) {
+    return ShardFor(key).Update(key, value);
+}
+
+kvssd::kvs_result Sharded_KVSSD::Delete(const kvssd::kvs_key &key) {
+    return ShardFor(key).Delete(key);
+}
+
+kvssd::kvs_result Sharded_KVSSD::ReadRange(const kvssd::kvs_key &key,
+                                           kvssd::kvs_value &value_out) {
+    return ShardFor(key).ReadRange(key, value_out);
+}
+
+kvssd::kvs_result Sharded_KVSSD::UpdateRange(const kvssd::kvs_key &key,
+                                             const kvssd::kvs_value &value) {
+    return ShardFor(key).UpdateRange(key, value);
+}
+
+kvssd::kvs_result Sharded_KVSSD::Append(const kvssd::kvs_key &key, const kvssd::kvs_value &value) {
+    return ShardFor(key).Append(key, value);
+}
+
+// The sub-batches work on copies of the requests; a read's value descriptor
+// points at the caller's buffer, so only its sizes have to be copied back.
+kvssd::kvs_result Sharded_KVSSD::BatchRead(const kvssd::kvs_key *keys, kvssd::kvs_value *values,
+                                           kvssd::kvs_result *results, size_t num) {
+    if (num && (keys == nullptr || values == nullptr || results == nullptr)) {
+        return kvssd::kvs_result::KVS_ERR_PARAM_INVALID;
+    }
+    std::vector<kvssd::kvs_key> sub_keys;
+    std::vector<kvssd::kvs_value> sub_values;
+    std::vector<kvssd::kvs_result> sub_results;
+    std::vector<std::vector<size_t>> split = SplitBatch(keys, num);
+    for (size_t s = 0; s < num_shards; s++) {
+        const std::vector<size_t> &batch = split[s];
+        if (batch.empty()) {
+            continue;
+        }
+        sub_keys.clear();
+        sub_values.clear();
+        for (size_t i : batch) {
+            sub_keys.push_back(keys[i]);
+            sub_values.push_back(values[i]);
+        }
+        sub_results.resize(batch.size());
+        shards[s].kv.BatchRead(sub_keys.data(), sub_values.data(), sub_results.data(),
+                               batch.size());
+        for (size_t j = 0; j < batch.size(); j++) {
+            values[batch[j]].actual_value_size = sub_values[j].actual_value_size;
+            results[batch[j]] = sub_results[j];
+        }
+    }
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+kvssd::kvs_result Sharded_KVSSD::BatchStore(const kvssd::kvs_key *keys,
+                                            const kvssd::kvs_value *values,
+                                            kvssd::kvs_result *results, size_t num) {
+    return WriteBatch(kvssd::kvs_opcode::UPDATE, keys, values, results, num);
+}
+
+kvssd::kvs_result Sharded_KVSSD::BatchInsert(const kvssd::kvs_key *keys,
+                                             const kvssd::kvs_value *values,
+                                             kvssd::kvs_result *results, size_t num) {
+    return WriteBatch(kvssd::kvs_opcode::INSERT, keys, values, results, num);
+}
+
+kvssd::kvs_result Sharded_KVSSD::WriteBatch(kvssd::kvs_opcode op, const kvssd::kvs_key *keys,
+                                            const kvssd::kvs_value *values,
+                                            kvssd::kvs_result *results, size_t num) {
+    if (num && (keys == nullptr || values == nullptr || results == nullptr)) {
+        return kvssd::kvs_result::KVS_ERR_PARAM_INVALID;
+    }
+    std::vector<kvssd::kvs_key> sub_keys;
+    std::vector<kvssd::kvs_value> sub_values;
+    std::vector<kvssd::kvs_result> sub_results;
+    std::vector<std::vector<size_t>> split = SplitBatch(keys, num);
+    for (size_t s = 0; s < num_shards; s++) {
+        const std::vector<size_t> &batch = split[s];
+        if (batch.empty()) {
+            continue;
+        }
+        sub_keys.clear();
+        sub_values.clear();
+        for (size_t i : batch) {
+            sub_keys.push_back(keys[i]);
+            sub_values.push_back(values[i]);
+        }
+        sub_results.resize(batch.size());
+        if (op == kvssd::kvs_opcode::INSERT) {
+            shards[s].kv.BatchInsert(sub_keys.data(), sub_values.data(), sub_results.data(),
+                                     batch.size());
+        } else {
+            shards[s].kv.BatchStore(sub_keys.data(), sub_values.data(), sub_results.data(),
+                                    batch.size());
+        }
+        for (size_t j = 0; j < batch.size(); j++) {
+            results[batch[j]] = sub_results[j];
+        }
+    }
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+kvssd::kvs_result Sharded_KVSSD::BatchDelete(const kvssd::kvs_key *keys,
+                                             kvssd::kvs_result *results, size_t num) {
+    if (num && (keys == nullptr || results == nullptr)) {
+        return kvssd::kvs_result::KVS_ERR_PARAM_INVALID;
+    }
+    std::vector<kvssd::kvs_key> sub_keys;
+    std::vector<kvssd::kvs_result> sub_results;
+    std::vector<std::vector<size_t>> split = SplitBatch(keys, num);
+    for (size_t s = 0; s < num_shards; s++) {
+        const std::vector<size_t> &batch = split[s];
+        if (batch.empty()) {
+            continue;
+        }
+        sub_keys.clear();
+        for (size_t i : batch) {
+            sub_keys.push_back(keys[i]);
+        }
+        sub_results.resize(batch.size());
+        shards[s].kv.BatchDelete(sub_keys.data(), sub_results.data(), batch.size());
+        for (size_t j = 0; j < batch.size(); j++) {
+            results[batch[j]] = sub_results[j];
+        }
+    }
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+kvssd::kvs_result Sharded_KVSSD::ReadAsync(const kvssd::kvs_key &key, kvssd::kvs_value &value,
+                                           kvssd::CompletionQueue &cq, void *private_data) {
+    if (!sq) {
+        return KVSSD::ReadAsync(key, value, cq, private_data);
+    }
+    return sq->Submit(kvssd::kvs_opcode::READ, key, &value, cq, private_data);
+}
+
+kvssd::kvs_result Sharded_KVSSD::InsertAsync(const kvssd::kvs_key &key,
+                                             const kvssd::kvs_value &value,
+                                             kvssd::CompletionQueue &cq, void *private_data) {
+    if (!sq) {
+        return KVSSD::InsertAsync(key, value, cq, private_data);
+    }
+    return sq->Submit(kvssd::kvs_opcode::INSERT, key, const_cast<kvssd::kvs_value *>(&value), cq,
+                      private_data);
+}
+
+kvssd::kvs_result Sharded_KVSSD::UpdateAsync(const kvssd::kvs_key &key,
+                                             const kvssd::kvs_value &value,
+                                             kvssd::CompletionQueue &cq, void *private_data) {
+    if (!sq) {
+        return KVSSD::UpdateAsync(key, value, cq, private_data);
+    }
+    return sq->Submit(kvssd::kvs_opcode::UPDATE, key, const_cast<kvssd::kvs_value *>(&value), cq,
+                      private_data);
+}
+
+kvssd::kvs_result Sharded_KVSSD::DeleteAsync(const kvssd::kvs_key &key, kvssd::CompletionQueue &cq,
+                                             void *private_data) {
+    if (!sq) {
+        return KVSSD::DeleteAsync(key, cq, private_data);
+    }
+    return sq->Submit(kvssd::kvs_opcode::DELETE, key, nullptr, cq, private_data);
+}
+
+kvssd::kvs_result Sharded_KVSSD::ForEachRecord(const RecordVisitor &fn) {
+    for (size_t i = 0; i < num_shards; i++) {
+        shards[i].kv.ForEachRecord(fn);
+    }
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+kvssd::kvs_result Sharded_KVSSD::Restore(const kvssd::kvs_key *keys,
+                                         const kvssd::kvs_value *values, size_t num) {
+    if (num && (keys == nullptr || values == nullptr)) {
+        return kvssd::kvs_result::KVS_ERR_PARAM_INVALID;
+    }
+    std::vector<kvssd::kvs_key> sub_keys;
+    std::vector<kvssd::kvs_value> sub_values;
+    std::vector<std::vector<size_t>> split = SplitBatch(keys, num);
+    for (size_t s = 0; s < num_shards; s++) {
+        sub_keys.clear();
+        sub_values.clear();
+        for (size_t i : split[s]) {
+            sub_keys.push_back(keys[i]);
+            sub_values.push_back(values[i]);
+        }
+        if (kvssd::kvs_result ret =
+                shards[s].kv.Restore(sub_keys.data(), sub_values.data(), sub_keys.size());
+            ret != kvssd::kvs_result::KVS_SUCCESS) {
+            return ret;
+        }
+    }
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+kvssd::kvs_result Sharded_KVSSD::SetCapacity(uint64_t bytes) {
+    for (size_t i = 0; i < num_shards; i++) {
+        shards[i].kv.SetCapacity((bytes + num_shards - 1) / num_shards);
+    }
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+kvssd::kvs_result Sharded_KVSSD::GetMemoryUsage(kvssd::kvs_memory_usage &usage) {
+    usage = {};
+    for (size_t i = 0; i < num_shards; i++) {
+        kvssd::kvs_memory_usage shard_usage;
+        shards[i].kv.GetMemoryUsage(shard_usage);
+        usage.records += shard_usage.records;
+        usage.key_bytes += shard_usage.key_bytes;
+        usage.value_bytes += shard_usage.value_bytes;
+        usage.allocated_bytes += shard_usage.allocated_bytes;
+    }
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+kvssd::kvs_result Sharded_KVSSD::GetFilterStats(kvssd::kvs_filter_stats &stats) {
+    stats = {};
+    for (size_t i = 0; i < num_shards; i++) {
+        kvssd::kvs_filter_stats shard_stats;
+        if (kvssd::kvs_result ret = shards[i].kv.GetFilterStats(shard_stats);
+            ret != kvssd::kvs_result::KVS_SUCCESS) {
+            return ret;
+        }
+        stats.negatives += shard_stats.negatives;
+        stats.false_positives += shard_stats.false_positives;
+        stats.memory_bytes += shard_stats.memory_bytes;
+    }
+    return kvssd::kvs_result::KVS_SUCCESS;
+}
+
+kvssd::kvs_result Sharded_KVSSD::OpenIterator(const kvssd::kvs_key_group_filter &filter,
+                                              const kvssd::kvs_key *start,
+                                              kvssd::kvs_iterator_handle &handle) {
+    return iterators.Open(filter, start, handle);
+}
+
+kvssd::kvs_result Sharded_KVSSD::IteratorNext(kvssd::kvs_iterator_handle handle,
+                                              kvssd::kvs_iterator_list &list) {
+    return iterators.Next(handle, list,
+                          [this](const kvssd::IteratorTable::Cursor &cursor, size_t budget,
+                                 std::vector<std::string> &keys) {
+                              return CollectKeys(cursor, budget, keys);
+                          });
+}
+
+kvssd::kvs_result Sharded_KVSSD::CloseIterator(kvssd::kvs_iterator_handle handle) {
+    return iterators.Close(handle);
+}
+
+// Merges the shards' keys in order, reading each shard a chunk at a time
+// from a cursor of its own, so that a batch reads about its budget from the
+// shards as a whole rather than the whole budget from every shard.
+bool Sharded_KVSSD::CollectKeys(const kvssd::IteratorTable::Cursor &cursor, size_t budget,
+                                std::vector<std::string> &keys) {
+    struct Source {
+        kvssd::IteratorTable::Cursor cursor;
+        std::vector<std::string> chunk;
+        size_t next = 0;  // in chunk
+        bool exhausted = false;
+    };
+    size_t chunk_budget = std::max<size_t>(budget / num_shards, 1);
+    std::vector<Source> sources(num_shards, Source{cursor});
+    // Whether shard i has a key at next, reading its next chunk if needed.
+    auto fill = [&](size_t i) {
+        Source &source = sources[i];
+        if (source.next < source.chunk.size()) {
+            return true;
+        }
+        if (source.exhausted) {
+            return false;
+        }
+        source.chunk.clear();
+        source.next = 0;
+        source.exhausted = shards[i].kv.CollectKeys(source.cursor, chunk_budget, source.chunk);
+        if (source.chunk.empty()) {
+            return false;
+        }
+        source.cursor.position = source.chunk.back();
+        source.cursor.inclusive = false;
+        return true;
+    };
+
+    // The next key of each shard that has one, smallest first.
+    using Head = std::pair<std::string_view, size_t>;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    for (size_t i = 0; i < num_shards; i++) {
+        if (fill(i)) {
+            heads.emplace(sources[i].chunk[0], i);
+        }
+    }
+    size_t used = 0;
+    while (!heads.empty()) {
+        auto [key, i] = heads.top();
+        size_t entry = sizeof(uint32_t) + key.size();
+        if (budget < used + entry && !keys.empty()) {
+            return false;
+        }
+        heads.pop();
+        keys.emplace_back(key);
+        used += entry;
+        sources[i].next++;
+        if (fill(i)) {
+            heads.emplace(sources[i].chunk[sources[i].next], i);
+        }
+    }
+    return true;
+}
+
+}  // namespace kvssd_hashmap
@@ -0,0 +1,101 @@
+#ifndef YCSB_C_KVSSD_SHARDED_DB_H_
+#define YCSB_C_KVSSD_SHARDED_DB_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kvssd.h"
+#include "kvssd_async.h"
+#include "kvssd_const.h"
+#include "kvssd_hashmap_db.h"
+#include "kvssd_iterator.h"
+
+namespace kvssd_hashmap {
+
+// Lock-striped emulator: keys are spread over independent Hashmap_KVSSD
+// shards, each with its own map and rwlock, so writers only serialize
+// against other writers of the same shard.
+class Sharded_KVSSD : public kvssd::KVSSD {
+   public:
+    explicit Sharded_KVSSD(size_t num_shards, size_t async_workers = 0);
+    ~Sharded_KVSSD() final;
+
+    kvssd::kvs_result Read(const kvssd::kvs_key &, kvssd::kvs_value &) final;
+    kvssd::kvs_result Insert(const kvssd::kvs_key &, const kvssd::kvs_value &) final;
+    kvssd::kvs_result Update(const kvssd::kvs_key &, const kvssd::kvs_value &) final;
+    kvssd::kvs_result Delete(const kvssd::kvs_key &) final;
+
+    kvssd::kvs_result ReadRange(const kvssd::kvs_key &, kvssd::kvs_value &) final;
+    kvssd::kvs_result UpdateRange(const kvssd::kvs_key &, const kvssd::kvs_value &) final;
+    kvssd::kvs_result Append(const kvssd::kvs_key &, const kvssd::kvs_value &) final;
+
+    // Splits a batch into one batch per shard.
+    kvssd::kvs_result BatchRead(const kvssd::kvs_key *, kvssd::kvs_value *, kvssd::kvs_result *,
+                                size_t num) final;
+    kvssd::kvs_result BatchStore(const kvssd::kvs_key *, const kvssd::kvs_value *,
+                                 kvssd::kvs_result *, size_t num) final;
+    kvssd::kvs_result BatchInsert(const kvssd::kvs_key *, const kvssd::kvs_value *,
+                                  kvssd::kvs_result *, size_t num) final;
+    kvssd::kvs_result BatchDelete(const kvssd::kvs_key *, kvssd::kvs_result *, size_t num) final;
+
+    // Visit the shards in turn; Restore splits its records like a batch.
+    kvssd::kvs_result ForEachRecord(const RecordVisitor &) final;
+    kvssd::kvs_result Restore(const kvssd::kvs_key *, const kvssd::kvs_value *, size_t num) final;
+
+    kvssd::kvs_result ReadAsync(const kvssd::kvs_key &, kvssd::kvs_value &,
+                                kvssd::CompletionQueue &, void *) final;
+    kvssd::kvs_result InsertAsync(const kvssd::kvs_key &, const kvssd::kvs_value &,
+                                  kvssd::CompletionQueue &, void *) final;
+    kvssd::kvs_result UpdateAsync(const kvssd::kvs_key &, const kvssd::kvs_value &,
+                                  kvssd::CompletionQueue &, void *) final;
+    kvssd::kvs_result DeleteAsync(const kvssd::kvs_key &, kvssd::CompletionQueue &, void *) final;
+
+    // Each shard holds an equal part of the capacity, so a skewed key space
+    // may be refused writes before reaching it.
+    kvssd::kvs_result SetCapacity(uint64_t) final;
+    // Sum the usage and filter outcomes of all shards.
+    kvssd::kvs_result GetMemoryUsage(kvssd::kvs_memory_usage &) final;
+    kvssd::kvs_result GetFilterStats(kvssd::kvs_filter_stats &) final;
+
+    kvssd::kvs_result OpenIterator(const kvssd::kvs_key_group_filter &, const kvssd::kvs_key *,
+                                   kvssd::kvs_iterator_handle &) final;
+    kvssd::kvs_result IteratorNext(kvssd::kvs_iterator_handle, kvssd::kvs_iterator_list &) final;
+    kvssd::kvs_result CloseIterator(kvssd::kvs_iterator_handle) final;
+
+    // One model for the whole device, shared by the shards.
+    void SetTimingModel(const std::shared_ptr<kvssd::TimingModel> &);
+    // Spread records evenly over the shards; see Hashmap_KVSSD::Reserve and
+    // Hashmap_KVSSD::EnableFilter. Each shard gets a filter of its own.
+    void Reserve(size_t records, float max_load_factor);
+    void EnableFilter(size_t expected_keys, double counters_per_key);
+
+    size_t NumShards() const { return num_shards; }
+
+   private:
+    // Each shard header starts on its own cache line so that lock traffic on
+    // one shard does not invalidate its neighbours.
+    struct alignas(KVS_CACHE_LINE_SIZE) Shard {
+        Hashmap_KVSSD kv;
+    };
+
+    size_t num_shards;
+    std::unique_ptr<Shard[]> shards;
+    std::unique_ptr<kvssd::SubmissionQueue> sq;
+    kvssd::IteratorTable iterators;
+
+    size_t ShardIndex(const kvssd::kvs_key &) const;
+    Hashmap_KVSSD &ShardFor(const kvssd::kvs_key &key) { return shards[ShardIndex(key)].kv; }
+    // Positions of the batch's requests, grouped by shard.
+    std::vector<std::vector<size_t>> SplitBatch(const kvssd::kvs_key *, size_t num) const;
+    // BatchStore for UPDATE, BatchInsert for INSERT.
+    kvssd::kvs_result WriteBatch(kvssd::kvs_opcode, const kvssd::kvs_key *,
+                                 const kvssd::kvs_value *, kvssd::kvs_result *, size_t num);
+    bool CollectKeys(const kvssd::IteratorTable::Cursor &, size_t budget,
+                     std::vector<std::string> &keys);
+};
+
+}  // namespace kvssd_hashmap
+
+#endif  // YCSB_C_KVSSD_SHARDED_DB_H_
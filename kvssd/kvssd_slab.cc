@@ -0,0 +1,81 @@
+#include "kvssd_slab.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace kvssd {
+
+SlabAllocator::SlabAllocator(size_t alignment)
+    : alignment(std::max(alignment, sizeof(FreeBlock))) {}
+
+SlabAllocator::~SlabAllocator() {
+    for (void *slab : slabs) {
+        free(slab);
+    }
+}
+
+// Classes 0 .. LINEAR_CLASSES-1 hold 1 .. LINEAR_CLASSES alignment units;
+// each following class doubles the size of the previous one.
+size_t SlabAllocator::ClassOf(size_t size) const {
+    size_t units = (size + alignment - 1) / alignment;
+    if (units <= LINEAR_CLASSES) {
+        return units - 1;
+    }
+    size_t size_class = LINEAR_CLASSES - 1;
+    for (size_t class_units = LINEAR_CLASSES; class_units < units; class_units <<= 1) {
+        size_class++;
+    }
+    return size_class;
+}
+
+size_t SlabAllocator::ClassSize(size_t size_class) const {
+    if (size_class < LINEAR_CLASSES) {
+        return (size_class + 1) * alignment;
+    }
+    return (LINEAR_CLASSES * alignment) << (size_class - LINEAR_CLASSES + 1);
+}
+
+size_t SlabAllocator::Capacity(size_t size) const {
+    return size == 0 ? 0 : ClassSize(ClassOf(size));
+}
+
+void *SlabAllocator::Allocate(size_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+    size_t size_class = ClassOf(size);
+    if (free_lists.size() <= size_class) {
+        free_lists.resize(size_class + 1, nullptr);
+    }
+    if (free_lists[size_class] == nullptr) {
+        size_t block_size = ClassSize(size_class);
+        size_t slab_size = std::max(SLAB_SIZE / block_size, size_t{1}) * block_size;
+        auto *slab = static_cast<char *>(aligned_alloc(alignment, slab_size));
+        if (slab == nullptr) {
+            throw std::bad_alloc();
+        }
+        slabs.push_back(slab);
+        allocated += slab_size;
+        for (size_t offset = slab_size; offset > 0; offset -= block_size) {
+            auto *block = reinterpret_cast<FreeBlock *>(slab + offset - block_size);
+            block->next = free_lists[size_class];
+            free_lists[size_class] = block;
+        }
+    }
+    FreeBlock *block = free_lists[size_class];
+    free_lists[size_class] = block->next;
+    return block;
+}
+
+void SlabAllocator::Free(void *ptr, size_t size) {
+    if (ptr == nullptr) {
+        return;
+    }
+    size_t size_class = ClassOf(size);
+    auto *block = static_cast<FreeBlock *>(ptr);
+    block->next = free_lists[size_class];
+    free_lists[size_class] = block;
+}
+
+}  // namespace kvssd
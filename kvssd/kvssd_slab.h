@@ -0,0 +1,55 @@
+#ifndef YCSB_C_KVSSD_SLAB_H_
+#define YCSB_C_KVSSD_SLAB_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace kvssd {
+
+// Size-classed slab allocator for the records of one emulated device. Sizes
+// are rounded up to a multiple of the alignment for the first
+// LINEAR_CLASSES classes and to a power of two beyond, and every block is
+// aligned to the alignment. Blocks are carved out of slabs of at least
+// SLAB_SIZE bytes, which are only returned to the system on destruction.
+//
+// Not thread-safe: callers serialize on the lock that guards their index.
+class SlabAllocator {
+   public:
+    explicit SlabAllocator(size_t alignment);
+    ~SlabAllocator();
+    SlabAllocator(const SlabAllocator &) = delete;
+    SlabAllocator &operator=(const SlabAllocator &) = delete;
+
+    // Returns nullptr for size 0.
+    void *Allocate(size_t size);
+    // size must be the one ptr was allocated with, or any size with the same
+    // Capacity.
+    void Free(void *ptr, size_t size);
+
+    // Usable bytes of a block allocated for size. A block can be rewritten in
+    // place with any size of equal capacity.
+    size_t Capacity(size_t size) const;
+    // Bytes obtained from the system.
+    size_t AllocatedBytes() const { return allocated; }
+
+   private:
+    static constexpr size_t LINEAR_CLASSES = 16;
+    static constexpr size_t SLAB_SIZE = 1 << 20;
+
+    // Free blocks are chained through their first bytes.
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    size_t alignment;
+    std::vector<FreeBlock *> free_lists;  // indexed by size class
+    std::vector<void *> slabs;
+    size_t allocated = 0;
+
+    size_t ClassOf(size_t size) const;
+    size_t ClassSize(size_t size_class) const;
+};
+
+}  // namespace kvssd
+
+#endif  // YCSB_C_KVSSD_SLAB_H_
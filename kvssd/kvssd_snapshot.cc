@@ -0,0 +1,159 @@
+#include "kvssd_snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace kvssd {
+
+namespace {
+
+constexpr char SNAPSHOT_MAGIC[8] = {'K', 'V', 'S', 'S', 'D', 'S', 'N', 'P'};
+constexpr uint32_t SNAPSHOT_VERSION = 2;
+// Records restored per Restore call.
+constexpr size_t RESTORE_BATCH = 4096;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t field_count;  // of the workload
+    uint64_t records;
+    uint64_t data_bytes;  // of the records following the header
+    uint64_t record_count;  // of the workload
+};
+
+}  // anonymous namespace
+
+kvs_result DumpSnapshot(KVSSD &kvssd, const std::string &path, const SnapshotWorkload &workload,
+                        uint64_t &records) {
+    records = 0;
+    std::string tmp_path = path + ".tmp";
+    std::FILE *file = std::fopen(tmp_path.c_str(), "wb");
+    if (file == nullptr) {
+        return kvs_result::KVS_ERR_SYS_IO;
+    }
+    std::vector<char> file_buffer(1 << 20);
+    std::setvbuf(file, file_buffer.data(), _IOFBF, file_buffer.size());
+
+    SnapshotHeader header = {};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.field_count = workload.field_count;
+    header.record_count = workload.record_count;
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    kvs_result ret = kvssd.ForEachRecord([&](const kvs_key &key, const kvs_value &value) {
+        ok = ok && std::fwrite(&key.length, sizeof(key.length), 1, file) == 1 &&
+             std::fwrite(&value.length, sizeof(value.length), 1, file) == 1 &&
+             std::fwrite(key.key, 1, key.length, file) == key.length &&
+             std::fwrite(value.value, 1, value.length, file) == value.length;
+        header.records++;
+        header.data_bytes += sizeof(key.length) + sizeof(value.length) + key.length + value.length;
+    });
+    ok = ok && std::fseek(file, 0, SEEK_SET) == 0 &&
+         std::fwrite(&header, sizeof(header), 1, file) == 1 && std::fflush(file) == 0 &&
+         fsync(fileno(file)) == 0;
+    ok = std::fclose(file) == 0 && ok;
+    if (ret == kvs_result::KVS_SUCCESS && !ok) {
+        ret = kvs_result::KVS_ERR_SYS_IO;
+    }
+    if (ret == kvs_result::KVS_SUCCESS && std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        ret = kvs_result::KVS_ERR_SYS_IO;
+    }
+    if (ret != kvs_result::KVS_SUCCESS) {
+        unlink(tmp_path.c_str());
+        return ret;
+    }
+    records = header.records;
+    return kvs_result::KVS_SUCCESS;
+}
+
+kvs_result LoadSnapshot(KVSSD &kvssd, const std::string &path, const SnapshotWorkload &workload,
+                        uint64_t &records) {
+    records = 0;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return kvs_result::KVS_ERR_SYS_IO;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        close(fd);
+        return kvs_result::KVS_ERR_SYS_IO;
+    }
+    size_t size = st.st_size;
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return kvs_result::KVS_ERR_SYS_IO;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    const char *data = static_cast<const char *>(map);
+    SnapshotHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != SNAPSHOT_VERSION ||
+        header.data_bytes != size - sizeof(SnapshotHeader)) {
+        munmap(map, size);
+        return kvs_result::KVS_ERR_SYS_IO;
+    }
+    if (header.record_count != workload.record_count ||
+        header.field_count != workload.field_count) {
+        munmap(map, size);
+        return kvs_result::KVS_ERR_PARAM_INVALID;
+    }
+
+    // Keys and values point into the mapping; the backend copies them.
+    std::vector<kvs_key> keys;
+    std::vector<kvs_value> values;
+    keys.reserve(RESTORE_BATCH);
+    values.reserve(RESTORE_BATCH);
+    kvs_result ret = kvs_result::KVS_SUCCESS;
+    auto flush = [&] {
+        if (ret == kvs_result::KVS_SUCCESS && !keys.empty()) {
+            ret = kvssd.Restore(keys.data(), values.data(), keys.size());
+            if (ret == kvs_result::KVS_SUCCESS) {
+                records += keys.size();
+            }
+        }
+        keys.clear();
+        values.clear();
+    };
+    const char *p = data + sizeof(SnapshotHeader);
+    const char *end = data + size;
+    for (uint64_t i = 0; i < header.records && ret == kvs_result::KVS_SUCCESS; i++) {
+        uint16_t key_length;
+        uint32_t value_length;
+        if (static_cast<size_t>(end - p) < sizeof(key_length) + sizeof(value_length)) {
+            ret = kvs_result::KVS_ERR_SYS_IO;
+            break;
+        }
+        std::memcpy(&key_length, p, sizeof(key_length));
+        p += sizeof(key_length);
+        std::memcpy(&value_length, p, sizeof(value_length));
+        p += sizeof(value_length);
+        if (static_cast<size_t>(end - p) < size_t{key_length} + value_length) {
+            ret = kvs_result::KVS_ERR_SYS_IO;
+            break;
+        }
+        keys.push_back({const_cast<char *>(p), key_length});
+        p += key_length;
+        values.push_back({const_cast<char *>(p), value_length, value_length, 0});
+        p += value_length;
+        if (keys.size() == RESTORE_BATCH) {
+            flush();
+        }
+    }
+    flush();
+    if (ret == kvs_result::KVS_SUCCESS && p != end) {
+        ret = kvs_result::KVS_ERR_SYS_IO;
+    }
+    munmap(map, size);
+    return ret;
+}
+
+}  // namespace kvssd
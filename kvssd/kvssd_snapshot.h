@@ -0,0 +1,36 @@
+#ifndef YCSB_C_KVSSD_SNAPSHOT_H_
+#define YCSB_C_KVSSD_SNAPSHOT_H_
+
+#include <cstdint>
+#include <string>
+
+#include "kvssd.h"
+
+namespace kvssd {
+
+// Snapshot images of a device's records, so that repeated runs on the same
+// data can skip the load phase. An image is a header, then every record as
+// its key length (uint16_t), value length (uint32_t), key and value bytes,
+// packed. Both calls need a backend with KVSSD::ForEachRecord and
+// KVSSD::Restore and set records to the number of records handled.
+
+// The workload an image was taken with, recorded in its header.
+struct SnapshotWorkload {
+    uint64_t record_count;
+    uint32_t field_count;
+};
+
+// Writes the image next to path and renames it into place, so that an
+// interrupted dump leaves any previous image intact.
+kvs_result DumpSnapshot(KVSSD &, const std::string &path, const SnapshotWorkload &,
+                        uint64_t &records);
+// Maps the image and restores its records into an empty device in batches
+// that point into the mapping. Truncated or foreign files fail with
+// KVS_ERR_SYS_IO, images of another workload with KVS_ERR_PARAM_INVALID,
+// before anything is restored.
+kvs_result LoadSnapshot(KVSSD &, const std::string &path, const SnapshotWorkload &,
+                        uint64_t &records);
+
+}  // namespace kvssd
+
+#endif  // YCSB_C_KVSSD_SNAPSHOT_H_
@@ -0,0 +1,99 @@
+#include "kvssd_timing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace kvssd {
+
+namespace {
+// Waits longer than this sleep first; the scheduler's wake-up slack is
+// covered by spinning for the rest.
+constexpr uint64_t SPIN_NS = 100'000;
+}  // anonymous namespace
+
+uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void WaitUntil(uint64_t deadline) {
+    uint64_t now = NowNs();
+    if (deadline > now + SPIN_NS) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(deadline - now - SPIN_NS));
+    }
+    while (NowNs() < deadline) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+}
+
+NandTimingModel::NandTimingModel(const Config &config) : config(config) {
+    this->config.channels = std::max(config.channels, size_t{1});
+    this->config.dies_per_channel = std::max(config.dies_per_channel, size_t{1});
+    this->config.write_amplification = std::max(config.write_amplification, 1.0);
+    this->config.gc_block_bytes = std::max(config.gc_block_bytes, uint64_t{1});
+    channels.reset(new Channel[this->config.channels]);
+    for (size_t i = 0; i < this->config.channels; i++) {
+        channels[i].dies.reset(new Die[this->config.dies_per_channel]);
+    }
+}
+
+void TimingModel::Complete(kvs_opcode opcode, size_t key_hash, size_t bytes) {
+    WaitUntil(Schedule(opcode, key_hash, bytes, NowNs()));
+}
+
+uint64_t NandTimingModel::Schedule(kvs_opcode opcode, size_t key_hash, size_t bytes,
+                                   uint64_t now) {
+    size_t die_index = key_hash % (config.channels * config.dies_per_channel);
+    Channel &channel = channels[die_index / config.dies_per_channel];
+    auto transfer_ns = static_cast<uint64_t>(bytes / config.bus_bytes_per_ns);
+
+    std::lock_guard<std::mutex> lock(channel.mu);
+    Die &die = channel.dies[die_index % config.dies_per_channel];
+    switch (opcode) {
+        case kvs_opcode::READ: {
+            uint64_t sensed = std::max(now, die.free_at) + config.read_ns;
+            die.free_at = sensed;
+            if (transfer_ns == 0) {
+                return sensed;
+            }
+            channel.free_at = std::max(sensed, channel.free_at) + transfer_ns;
+            return channel.free_at;
+        }
+        case kvs_opcode::INSERT:
+        case kvs_opcode::UPDATE: {
+            uint64_t transferred = now;
+            if (transfer_ns > 0) {
+                channel.free_at = std::max(now, channel.free_at) + transfer_ns;
+                transferred = channel.free_at;
+            }
+            uint64_t program_ns = config.write_ns;
+            die.gc_debt += (config.write_amplification - 1.0) * bytes;
+            while (die.gc_debt >= config.gc_block_bytes) {
+                die.gc_debt -= config.gc_block_bytes;
+                program_ns += config.gc_stall_ns;
+                channel.gc_stalls++;
+            }
+            die.free_at = std::max(transferred, die.free_at) + program_ns;
+            return die.free_at;
+        }
+        case kvs_opcode::DELETE:
+            die.free_at = std::max(now, die.free_at) + config.delete_ns;
+            return die.free_at;
+    }
+    return now;
+}
+
+uint64_t NandTimingModel::GcStalls() {
+    uint64_t stalls = 0;
+    for (size_t i = 0; i < config.channels; i++) {
+        std::lock_guard<std::mutex> lock(channels[i].mu);
+        stalls += channels[i].gc_stalls;
+    }
+    return stalls;
+}
+
+}  // namespace kvssd
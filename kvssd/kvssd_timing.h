@@ -0,0 +1,86 @@
+#ifndef YCSB_C_KVSSD_TIMING_H_
+#define YCSB_C_KVSSD_TIMING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "kvssd.h"
+#include "kvssd_const.h"
+
+namespace kvssd {
+
+// Makes an in-memory backend take as long as a device would. The backend
+// calls Complete once a request has been executed, outside of its locks, and
+// Complete returns when the modelled device would have completed it. A batch
+// schedules all its requests at the same instant and waits for the last one.
+class TimingModel {
+   public:
+    virtual ~TimingModel() = default;
+
+    // Reserves the device for a request issued at now (see NowNs) and
+    // returns the time it completes. key_hash picks where the request lands
+    // inside the device; bytes is the value length moved to or from it.
+    virtual uint64_t Schedule(kvs_opcode, size_t key_hash, size_t bytes, uint64_t now) = 0;
+
+    // Schedules a request issued now and waits for its completion.
+    void Complete(kvs_opcode, size_t key_hash, size_t bytes);
+};
+
+// NAND-like device: channels * dies_per_channel dies, each executing one
+// command at a time, with the dies of a channel sharing its bus. A read
+// occupies its die for read_ns and then the bus for the transfer; a write
+// transfers first and then programs for write_ns. Requests that find their
+// die or bus busy queue behind it, so concurrent clients see queuing delay.
+//
+// Garbage collection is driven by write amplification: each written byte
+// leaves (write_amplification - 1) bytes of relocation work on its die, and
+// whenever gc_block_bytes of it have piled up the die stalls for gc_stall_ns.
+class NandTimingModel : public TimingModel {
+   public:
+    struct Config {
+        uint64_t read_ns = 80'000;
+        uint64_t write_ns = 20'000;
+        uint64_t delete_ns = 10'000;
+        double bus_bytes_per_ns = 0.8;  // per channel; 800 MB/s
+        size_t channels = 8;
+        size_t dies_per_channel = 4;
+        double write_amplification = 1.0;
+        uint64_t gc_block_bytes = 256 * 1024;
+        uint64_t gc_stall_ns = 3'000'000;
+    };
+
+    explicit NandTimingModel(const Config &);
+
+    uint64_t Schedule(kvs_opcode, size_t key_hash, size_t bytes, uint64_t now) final;
+
+    uint64_t GcStalls();
+
+   private:
+    struct Die {
+        uint64_t free_at = 0;
+        double gc_debt = 0;  // relocation bytes not yet paid for
+    };
+
+    struct alignas(KVS_CACHE_LINE_SIZE) Channel {
+        std::mutex mu;
+        uint64_t free_at = 0;
+        std::unique_ptr<Die[]> dies;
+        uint64_t gc_stalls = 0;
+    };
+
+    Config config;
+    std::unique_ptr<Channel[]> channels;
+};
+
+// Nanoseconds on the steady clock.
+uint64_t NowNs();
+
+// Returns at deadline (see NowNs), sleeping through long waits and spinning
+// through the last stretch so that short latencies stay accurate.
+void WaitUntil(uint64_t deadline);
+
+}  // namespace kvssd
+
+#endif  // YCSB_C_KVSSD_TIMING_H_
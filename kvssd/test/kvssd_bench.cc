@@ -0,0 +1,201 @@
+// Per-operation cost of the KVSSD emulator's hot path, for catching
+// regressions: row building and (de)serialization in isolation, then the
+// row wrappers against each in-memory backend over value size and thread
+// count.
+//
+// Usage: kvssd_bench [--benchmark_filter=...] [--benchmark_out=bench.json
+//                     --benchmark_out_format=json]
+//
+// The row benchmarks take {key size, field count, field size}; the backend
+// benchmarks take {backend, value size}, where backend is 0 for the
+// single-lock hashmap, 1 for the sharded one and 2 for the lock-free one.
+// Build without ThreadSanitizer (-DKVSSD_TSAN=OFF) for meaningful numbers.
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kvssd_hashmap_db_impl.h"
+#include "kvssd_lockfree_db.h"
+#include "kvssd_sharded_db.h"
+
+namespace {
+
+constexpr size_t NUM_KEYS = 100'000;
+constexpr size_t NUM_SHARDS = 64;
+
+const char *const BACKEND_NAMES[] = {"hashmap", "sharded", "lockfree"};
+
+// key_size bytes: "key", then the number zero-padded on the left.
+std::string MakeKey(size_t i, size_t key_size) {
+    std::string number = std::to_string(i);
+    std::string key = "key";
+    if (key.size() + number.size() < key_size) {
+        key.append(key_size - key.size() - number.size(), '0');
+    }
+    return key + number;
+}
+
+std::vector<ycsbc::DB::Field> MakeValue(size_t field_count, size_t field_size) {
+    std::vector<ycsbc::DB::Field> value;
+    for (size_t i = 0; i < field_count; i++) {
+        value.push_back({"field" + std::to_string(i),
+                         std::string(field_size, static_cast<char>('a' + i % 26))});
+    }
+    return value;
+}
+
+void RowArgs(benchmark::internal::Benchmark *b) {
+    b->ArgNames({"key_size", "fields", "field_size"});
+    for (int64_t key_size : {16, 128}) {
+        for (int64_t fields : {1, 10}) {
+            for (int64_t field_size : {10, 100, 1000}) {
+                b->Args({key_size, fields, field_size});
+            }
+        }
+    }
+}
+
+void BM_CreateRow(benchmark::State &state) {
+    std::string key = MakeKey(0, state.range(0));
+    std::vector<ycsbc::DB::Field> value = MakeValue(state.range(1), state.range(2));
+    for (auto _ : state) {
+        auto row = kvssd_hashmap::CreateRow(key, value);
+        benchmark::DoNotOptimize(row.get());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(1) * state.range(2));
+}
+BENCHMARK(BM_CreateRow)->Apply(RowArgs);
+
+void BM_SerializeRow(benchmark::State &state) {
+    std::vector<ycsbc::DB::Field> value = MakeValue(state.range(1), state.range(2));
+    std::string data;
+    for (auto _ : state) {
+        data.clear();
+        kvssd_hashmap::SerializeRow(value, &data);
+        benchmark::DoNotOptimize(data.data());
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_SerializeRow)->Apply(RowArgs);
+
+void BM_DeserializeRow(benchmark::State &state) {
+    std::string data;
+    kvssd_hashmap::SerializeRow(MakeValue(state.range(1), state.range(2)), &data);
+    std::vector<ycsbc::DB::Field> value;
+    for (auto _ : state) {
+        value.clear();
+        kvssd_hashmap::DeserializeRow(&value, data.data(), data.size());
+        benchmark::DoNotOptimize(value.data());
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_DeserializeRow)->Apply(RowArgs);
+
+// One backend shared by all threads of a run, built and loaded by thread 0
+// before the timed loop; the loop's start is a barrier for all threads.
+std::unique_ptr<kvssd::KVSSD> backend;
+
+kvssd::KVSSD *NewBackend(int64_t kind) {
+    switch (kind) {
+        case 0:
+            return new kvssd_hashmap::Hashmap_KVSSD();
+        case 1:
+            return new kvssd_hashmap::Sharded_KVSSD(NUM_SHARDS);
+        default:
+            return new kvssd_lockfree::LockFree_KVSSD(NUM_KEYS * 2);
+    }
+}
+
+void SetUpBackend(benchmark::State &state) {
+    state.SetLabel(BACKEND_NAMES[state.range(0)]);
+    if (state.thread_index() != 0) {
+        return;
+    }
+    backend.reset(NewBackend(state.range(0)));
+    std::vector<ycsbc::DB::Field> value = MakeValue(1, state.range(1));
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        kvssd_hashmap::InsertRow(*backend, MakeKey(i, 16), value);
+    }
+}
+
+void TearDownBackend(benchmark::State &state) {
+    if (state.thread_index() == 0) {
+        backend.reset();
+    }
+}
+
+void BackendArgs(benchmark::internal::Benchmark *b) {
+    b->ArgNames({"backend", "value_size"});
+    for (int64_t kind = 0; kind < 3; kind++) {
+        for (int64_t value_size : {100, 1000, 4000}) {
+            b->Args({kind, value_size});
+        }
+    }
+    b->ThreadRange(1, static_cast<int>(benchmark::CPUInfo::Get().num_cpus))->UseRealTime();
+}
+
+// Keys are precomputed so that the loop measures the backend, not the
+// formatting; each thread walks the key set from its own starting point.
+std::vector<std::string> ThreadKeys(const benchmark::State &state) {
+    std::vector<std::string> keys;
+    keys.reserve(NUM_KEYS);
+    size_t start = state.thread_index() * NUM_KEYS / state.threads();
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        keys.push_back(MakeKey((start + i) % NUM_KEYS, 16));
+    }
+    return keys;
+}
+
+void BM_Read(benchmark::State &state) {
+    SetUpBackend(state);
+    std::vector<std::string> keys = ThreadKeys(state);
+    std::vector<ycsbc::DB::Field> value;
+    std::vector<char> buffer;
+    size_t i = 0;
+    for (auto _ : state) {
+        value.clear();
+        kvssd_hashmap::ReadRow(*backend, keys[i++ % NUM_KEYS], value, buffer);
+        benchmark::DoNotOptimize(value.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+    TearDownBackend(state);
+}
+BENCHMARK(BM_Read)->Apply(BackendArgs);
+
+// An update replaces the stored value with a deep copy of the new one, so
+// this measures the backends' value copy and free as well as the lookup.
+void BM_Update(benchmark::State &state) {
+    SetUpBackend(state);
+    std::vector<std::string> keys = ThreadKeys(state);
+    std::vector<ycsbc::DB::Field> value = MakeValue(1, state.range(1));
+    size_t i = 0;
+    for (auto _ : state) {
+        kvssd_hashmap::UpdateRow(*backend, keys[i++ % NUM_KEYS], value);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * state.range(1));
+    TearDownBackend(state);
+}
+BENCHMARK(BM_Update)->Apply(BackendArgs);
+
+// Deletes and reinserts a key of the thread's own, so that the key set stays
+// loaded and threads do not race on the same key.
+void BM_InsertDelete(benchmark::State &state) {
+    SetUpBackend(state);
+    std::string key = MakeKey(NUM_KEYS + state.thread_index(), 16);
+    std::vector<ycsbc::DB::Field> value = MakeValue(1, state.range(1));
+    for (auto _ : state) {
+        kvssd_hashmap::InsertRow(*backend, key, value);
+        kvssd_hashmap::DeleteRow(*backend, key);
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    TearDownBackend(state);
+}
+BENCHMARK(BM_InsertDelete)->Apply(BackendArgs);
+
+}  // anonymous namespace
+
+BENCHMARK_MAIN();
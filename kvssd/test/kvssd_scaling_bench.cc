@@ -0,0 +1,90 @@
+// Throughput of the hashmap KVSSD emulator vs. client thread count.
+//
+// Usage: kvssd_scaling_bench [max_threads] [ops_per_thread] [shards]
+//
+// Every thread first loads its own key range, then runs a 50/50 mix of
+// reads and updates over the whole key set. The single-lock, sharded and
+// lock-free backends are measured side by side.
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kvssd_hashmap_db_impl.h"
+#include "kvssd_lockfree_db.h"
+#include "kvssd_sharded_db.h"
+
+namespace {
+
+constexpr size_t KEYS_PER_THREAD = 10'000;
+
+std::vector<ycsbc::DB::Field> MakeValue(size_t i) {
+    return {{"field0", std::string(100, static_cast<char>('a' + i % 26))},
+            {"field1", std::string(100, static_cast<char>('A' + i % 26))}};
+}
+
+void Worker(kvssd::KVSSD &kv, size_t tid, size_t num_threads, size_t num_ops) {
+    std::mt19937 gen(static_cast<uint32_t>(tid));
+    std::uniform_int_distribution<size_t> key_dist(0, KEYS_PER_THREAD * num_threads - 1);
+    std::vector<ycsbc::DB::Field> value = MakeValue(tid);
+    std::vector<ycsbc::DB::Field> output;
+    for (size_t i = 0; i < num_ops; i++) {
+        std::string key = "key" + std::to_string(key_dist(gen));
+        if (i & 1) {
+            kvssd_hashmap::UpdateRow(kv, key, value);
+        } else {
+            kvssd_hashmap::ReadRow(kv, key, output);
+        }
+    }
+}
+
+double RunOnce(const std::function<kvssd::KVSSD *()> &factory, size_t num_threads,
+               size_t num_ops) {
+    std::unique_ptr<kvssd::KVSSD> kv(factory());
+    for (size_t i = 0; i < KEYS_PER_THREAD * num_threads; i++) {
+        kvssd_hashmap::InsertRow(*kv, "key" + std::to_string(i), MakeValue(i));
+    }
+
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < num_threads; t++) {
+        threads.emplace_back(Worker, std::ref(*kv), t, num_threads, num_ops);
+    }
+    for (auto &th : threads) {
+        th.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(num_ops * num_threads) / elapsed.count();
+}
+
+}  // anonymous namespace
+
+int main(int argc, char *argv[]) {
+    size_t max_threads = argc > 1 ? std::stoul(argv[1]) : std::thread::hardware_concurrency();
+    size_t num_ops = argc > 2 ? std::stoul(argv[2]) : 200'000;
+    size_t num_shards = argc > 3 ? std::stoul(argv[3]) : 64;
+    if (max_threads == 0) {
+        max_threads = 1;
+    }
+
+    auto hashmap = [] { return new kvssd_hashmap::Hashmap_KVSSD(); };
+    auto sharded = [num_shards] { return new kvssd_hashmap::Sharded_KVSSD(num_shards); };
+
+    std::printf("%8s %16s %16s %16s\n", "threads", "hashmap(ops/s)", "sharded(ops/s)",
+                "lockfree(ops/s)");
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        auto lockfree = [threads] {
+            return new kvssd_lockfree::LockFree_KVSSD(KEYS_PER_THREAD * threads * 2);
+        };
+        double single = RunOnce(hashmap, threads, num_ops);
+        double striped = RunOnce(sharded, threads, num_ops);
+        double nonblocking = RunOnce(lockfree, threads, num_ops);
+        std::printf("%8zu %16.0f %16.0f %16.0f\n", threads, single, striped, nonblocking);
+    }
+    return 0;
+}
@@ -1,12 +1,34 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
 #include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
 #include <string>
+#include <thread>
 
+#include "core/client.h"
+#include "core/db_wrapper.h"
 #include "gtest/gtest.h"
+#include "kvssd_file_db.h"
+#include "kvssd_filter.h"
 #include "kvssd_hashmap_db_impl.h"
+#include "kvssd_keyspace.h"
+#include "kvssd_lockfree_db.h"
+#include "kvssd_sharded_db.h"
+#include "kvssd_slab.h"
+#include "kvssd_snapshot.h"
+#include "kvssd_timing.h"
 
 constexpr size_t NUM_KEYS = 100'000;
 constexpr size_t NUM_VALUES = 100'000;
 constexpr size_t NUM_THREADS = 4;
+constexpr size_t NUM_SHARDS = 16;
+
+// Defined by the kvssd binding, which registers it with the DB factory.
+ycsbc::DB *NewKvssdDB();
 
 namespace {
 class KvssdHashMapDbImplTest : public ::testing::Test {
@@ -17,6 +39,33 @@ class KvssdHashMapDbImplTest : public ::testing::Test {
     std::vector<ycsbc::DB::Field> output_value;
 };
 
+class KvssdShardedDbImplTest : public KvssdHashMapDbImplTest {
+   protected:
+    void SetUp() override { kvssd.reset(new kvssd_hashmap::Sharded_KVSSD(NUM_SHARDS)); }
+};
+
+class KvssdLockFreeDbImplTest : public KvssdHashMapDbImplTest {
+   protected:
+    void SetUp() override { kvssd.reset(new kvssd_lockfree::LockFree_KVSSD(NUM_KEYS * 2)); }
+};
+
+class KvssdFileDbImplTest : public KvssdHashMapDbImplTest {
+   protected:
+    void SetUp() override { kvssd.reset(Open(true)); }
+    void TearDown() override {
+        kvssd.reset();
+        unlink(path.c_str());
+    }
+
+    kvssd_file::File_KVSSD *Open(bool destroy) {
+        return new kvssd_file::File_KVSSD(path, destroy, 0.5, io_engine, direct_io);
+    }
+
+    std::string path = ::testing::TempDir() + "kvssd_file_test.log";
+    std::string io_engine = "psync";
+    bool direct_io = false;
+};
+
 static auto MakeRandomString = [](std::mt19937 &gen, size_t len) {
     static std::uniform_int_distribution charDist(32, 126);  // printable ASCII
     std::string s;
@@ -139,6 +188,246 @@ TEST_F(KvssdHashMapDbImplTest, ReadLarge) {
     }
 }
 
+// Reads into a caller buffer report the stored size and refuse to truncate.
+void RunReadIntoCallerBuffer(kvssd::KVSSD &kv) {
+    std::string data;
+    kvssd_hashmap::SerializeRow(value[0], &data);
+    kvssd_hashmap::InsertRow(kv, key[0], value[0]);
+
+    std::vector<char> buffer(data.size() - 1);
+    kvssd::kvs_key k{const_cast<char *>(key[0].data()), static_cast<uint16_t>(key[0].size())};
+    kvssd::kvs_value v{buffer.data(), static_cast<uint32_t>(buffer.size()), 0, 0};
+    EXPECT_EQ(kv.Read(k, v), kvssd::kvs_result::KVS_ERR_BUFFER_SMALL);
+    EXPECT_EQ(v.actual_value_size, data.size());
+
+    buffer.resize(data.size());
+    v = {buffer.data(), static_cast<uint32_t>(buffer.size()), 0, 0};
+    EXPECT_EQ(kv.Read(k, v), kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(std::string(buffer.data(), v.actual_value_size), data);
+
+    // ReadRow grows a short buffer and then keeps reusing it.
+    std::vector<char> reused(8);
+    std::vector<ycsbc::DB::Field> output;
+    kvssd_hashmap::ReadRow(kv, key[0], output, reused);
+    EXPECT_FALSE(FieldVectorCmp(value[0], output));
+    EXPECT_EQ(reused.size(), data.size());
+    EXPECT_FALSE(kvssd_hashmap::TryReadRow(kv, key[1], output, reused));
+    EXPECT_THROW(kvssd_hashmap::ReadRow(kv, key[1], output, reused), ycsbc::utils::Exception);
+}
+
+TEST_F(KvssdHashMapDbImplTest, ReadIntoCallerBuffer) { RunReadIntoCallerBuffer(*kvssd); }
+
+TEST_F(KvssdShardedDbImplTest, RangeReadsAndWrites) {
+    std::string data(2'000, 'a');
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<char>('a' + i % 26);
+    }
+    kvssd::kvs_key k{const_cast<char *>(key[0].data()), static_cast<uint16_t>(key[0].size())};
+    kvssd::kvs_value stored{data.data(), static_cast<uint32_t>(data.size()), 0, 0};
+    ASSERT_EQ(kvssd->Insert(k, stored), kvssd::kvs_result::KVS_SUCCESS);
+
+    std::vector<char> buffer(1'000);
+    kvssd::kvs_value v{buffer.data(), 100, 0, 512};
+    EXPECT_EQ(kvssd->ReadRange(k, v), kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(v.actual_value_size, data.size());
+    EXPECT_EQ(std::string(buffer.data(), 100), data.substr(512, 100));
+    // The range may run past the end of the value.
+    v = {buffer.data(), 1'000, 0, 1'536};
+    EXPECT_EQ(kvssd->ReadRange(k, v), kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(std::string(buffer.data(), 464), data.substr(1'536));
+    // Read starts at the offset but needs room for the rest of the value.
+    v = {buffer.data(), 100, 0, 1'024};
+    EXPECT_EQ(kvssd->Read(k, v), kvssd::kvs_result::KVS_ERR_BUFFER_SMALL);
+    v = {buffer.data(), 976, 0, 1'024};
+    EXPECT_EQ(kvssd->Read(k, v), kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(std::string(buffer.data(), 976), data.substr(1'024));
+    v = {buffer.data(), 100, 0, 2'048};
+    EXPECT_EQ(kvssd->ReadRange(k, v), kvssd::kvs_result::KVS_ERR_VALUE_OFFSET_INVALID);
+    v = {buffer.data(), 100, 0, 100};
+    EXPECT_EQ(kvssd->ReadRange(k, v), kvssd::kvs_result::KVS_ERR_VALUE_OFFSET_MISALIGNED);
+
+    // Partial writes patch in place, grow the value past its end, and append.
+    std::string patch = "PATCH";
+    kvssd::kvs_value w{patch.data(), 5, 5, 10};
+    EXPECT_EQ(kvssd->UpdateRange(k, w), kvssd::kvs_result::KVS_SUCCESS);
+    data.replace(10, 5, patch);
+    std::string tail(100, 'z');
+    w = {tail.data(), 100, 100, 1'990};
+    EXPECT_EQ(kvssd->UpdateRange(k, w), kvssd::kvs_result::KVS_SUCCESS);
+    data.replace(1'990, 10, tail);
+    w = {patch.data(), 5, 5, 0};
+    EXPECT_EQ(kvssd->Append(k, w), kvssd::kvs_result::KVS_SUCCESS);
+    data += patch;
+    w = {patch.data(), 5, 5, 4'000};
+    EXPECT_EQ(kvssd->UpdateRange(k, w), kvssd::kvs_result::KVS_ERR_VALUE_OFFSET_INVALID);
+
+    buffer.resize(data.size());
+    v = {buffer.data(), static_cast<uint32_t>(buffer.size()), 0, 0};
+    ASSERT_EQ(kvssd->Read(k, v), kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(std::string(buffer.data(), v.actual_value_size), data);
+    kvssd::kvs_memory_usage usage;
+    kvssd->GetMemoryUsage(usage);
+    EXPECT_EQ(usage.value_bytes, data.size());
+}
+
+// Rows of FieldLayout's fixed format, read and updated a field at a time.
+void RunFixedLayoutFields(kvssd::KVSSD &kv) {
+    kvssd_hashmap::FieldLayout layout("field", 12, 100);
+    std::vector<ycsbc::DB::Field> row;
+    for (int i = 0; i < 12; i++) {
+        row.push_back({"field" + std::to_string(i), std::string(i * 8, 'a' + i)});
+    }
+    kvssd_hashmap::InsertRow(kv, key[0], row, &layout);
+
+    std::vector<ycsbc::DB::Field> output;
+    kvssd_hashmap::ReadRow(kv, key[0], output);
+    EXPECT_FALSE(FieldVectorCmp(row, output));
+
+    std::vector<char> buffer;
+    EXPECT_TRUE(kvssd_hashmap::ReadFields(kv, key[0], layout, {"field11"}, output, buffer));
+    ASSERT_EQ(output.size(), 1);
+    EXPECT_EQ(output[0].name, "field11");
+    EXPECT_EQ(output[0].value, row[11].value);
+
+    row[3].value = "updated";
+    row[10].value = std::string(100, 'x');
+    kvssd_hashmap::UpdateFields(kv, key[0], layout, {row[3], row[10]}, buffer);
+    kvssd_hashmap::ReadRow(kv, key[0], output);
+    EXPECT_FALSE(FieldVectorCmp(row, output));
+
+    EXPECT_THROW(kvssd_hashmap::UpdateFields(kv, key[0], layout,
+                                             {{"field3", std::string(101, 'x')}}, buffer),
+                 ycsbc::utils::Exception);
+    EXPECT_FALSE(kvssd_hashmap::ReadFields(kv, key[1], layout, {"field11"}, output, buffer));
+    EXPECT_THROW(kvssd_hashmap::ReadFields(kv, key[0], layout, {"field12"}, output, buffer),
+                 ycsbc::utils::Exception);
+}
+
+TEST_F(KvssdHashMapDbImplTest, FixedLayoutFields) { RunFixedLayoutFields(*kvssd); }
+
+// Without ranged access the fields are served from whole rows.
+TEST_F(KvssdLockFreeDbImplTest, FixedLayoutFields) { RunFixedLayoutFields(*kvssd); }
+
+// Batch commands report each request's outcome separately.
+void RunBatchCommands(kvssd::KVSSD &kv) {
+    constexpr size_t BATCH = 64;
+    std::vector<std::string> data(BATCH);
+    std::vector<kvssd::kvs_key> keys(BATCH);
+    std::vector<kvssd::kvs_value> values(BATCH);
+    std::vector<kvssd::kvs_result> results(BATCH);
+    for (size_t i = 0; i < BATCH; i++) {
+        data[i] = "value" + std::to_string(i);
+        keys[i] = {const_cast<char *>(key[i].data()), static_cast<uint16_t>(key[i].size())};
+        values[i] = {data[i].data(), static_cast<uint32_t>(data[i].size()), 0, 0};
+    }
+    // Half the keys exist; the batch inserts the rest and updates these.
+    ASSERT_EQ(kv.BatchStore(keys.data(), values.data(), results.data(), BATCH / 2),
+              kvssd::kvs_result::KVS_SUCCESS);
+    data[0] = "updated";
+    values[0] = {data[0].data(), static_cast<uint32_t>(data[0].size()), 0, 0};
+    ASSERT_EQ(kv.BatchStore(keys.data(), values.data(), results.data(), BATCH),
+              kvssd::kvs_result::KVS_SUCCESS);
+    for (size_t i = 0; i < BATCH; i++) {
+        EXPECT_EQ(results[i], kvssd::kvs_result::KVS_SUCCESS);
+    }
+
+    std::vector<std::vector<char>> buffers(BATCH, std::vector<char>(64));
+    for (size_t i = 0; i < BATCH; i++) {
+        values[i] = {buffers[i].data(), static_cast<uint32_t>(buffers[i].size()), 0, 0};
+    }
+    values[1].length = 2;
+    ASSERT_EQ(kv.BatchRead(keys.data(), values.data(), results.data(), BATCH),
+              kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(results[1], kvssd::kvs_result::KVS_ERR_BUFFER_SMALL);
+    EXPECT_EQ(values[1].actual_value_size, data[1].size());
+    for (size_t i = 0; i < BATCH; i++) {
+        if (i != 1) {
+            ASSERT_EQ(results[i], kvssd::kvs_result::KVS_SUCCESS);
+            EXPECT_EQ(std::string(buffers[i].data(), values[i].actual_value_size), data[i]);
+        }
+    }
+
+    ASSERT_EQ(kv.BatchDelete(keys.data(), results.data(), BATCH / 2),
+              kvssd::kvs_result::KVS_SUCCESS);
+    ASSERT_EQ(kv.BatchDelete(keys.data(), results.data(), BATCH),
+              kvssd::kvs_result::KVS_SUCCESS);
+    for (size_t i = 0; i < BATCH; i++) {
+        EXPECT_EQ(results[i], i < BATCH / 2 ? kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST
+                                            : kvssd::kvs_result::KVS_SUCCESS);
+    }
+
+    // Unlike stores, inserts fail on keys that exist.
+    ASSERT_EQ(kv.BatchInsert(keys.data(), values.data(), results.data(), BATCH / 2),
+              kvssd::kvs_result::KVS_SUCCESS);
+    ASSERT_EQ(kv.BatchInsert(keys.data(), values.data(), results.data(), BATCH),
+              kvssd::kvs_result::KVS_SUCCESS);
+    for (size_t i = 0; i < BATCH; i++) {
+        EXPECT_EQ(results[i], i < BATCH / 2 ? kvssd::kvs_result::KVS_ERR_KS_EXIST
+                                            : kvssd::kvs_result::KVS_SUCCESS);
+    }
+    EXPECT_EQ(kv.BatchRead(nullptr, nullptr, nullptr, 1), kvssd::kvs_result::KVS_ERR_PARAM_INVALID);
+    EXPECT_EQ(kv.BatchDelete(nullptr, nullptr, 0), kvssd::kvs_result::KVS_SUCCESS);
+}
+
+TEST_F(KvssdHashMapDbImplTest, BatchCommands) { RunBatchCommands(*kvssd); }
+
+TEST_F(KvssdShardedDbImplTest, BatchCommands) { RunBatchCommands(*kvssd); }
+
+// The default implementations issue the requests one by one.
+TEST_F(KvssdLockFreeDbImplTest, BatchCommands) { RunBatchCommands(*kvssd); }
+
+TEST_F(KvssdHashMapDbImplTest, RowBatch) {
+    kvssd_hashmap::RowBatch batch(8);
+    kvssd::CompletionQueue cq;
+    kvssd::kvs_completion completion;
+    for (size_t i = 0; i < 10; i++) {
+        batch.Insert(*kvssd, key[i], value[i], cq);
+    }
+    // The first eight were issued when the batch filled up.
+    EXPECT_EQ(batch.Size(), 2);
+    EXPECT_TRUE(batch.Contains(key[9]));
+    EXPECT_FALSE(batch.Contains(key[0]));
+    for (size_t i = 0; i < 8; i++) {
+        ASSERT_TRUE(cq.TryPop(completion));
+        EXPECT_EQ(completion.opcode, kvssd::kvs_opcode::INSERT);
+        EXPECT_TRUE(kvssd_hashmap::CompleteRow(completion, nullptr));
+    }
+    EXPECT_FALSE(cq.TryPop(completion));
+    kvssd_hashmap::ReadRow(*kvssd, key[0], output_value);
+    EXPECT_FALSE(FieldVectorCmp(value[0], output_value));
+    EXPECT_THROW(kvssd_hashmap::ReadRow(*kvssd, key[9], output_value), ycsbc::utils::Exception);
+
+    // A delete issues the pending inserts before it.
+    void *tag = batch.Delete(*kvssd, key[0], cq);
+    EXPECT_EQ(batch.Size(), 1);
+    for (size_t i = 0; i < 2; i++) {
+        ASSERT_TRUE(cq.TryPop(completion));
+        EXPECT_TRUE(kvssd_hashmap::CompleteRow(completion, nullptr));
+    }
+    kvssd_hashmap::ReadRow(*kvssd, key[9], output_value);
+    EXPECT_FALSE(FieldVectorCmp(value[9], output_value));
+    batch.Flush(*kvssd);
+    ASSERT_TRUE(cq.TryPop(completion));
+    EXPECT_EQ(completion.private_data, tag);
+    EXPECT_TRUE(kvssd_hashmap::CompleteRow(completion, nullptr));
+    EXPECT_THROW(kvssd_hashmap::ReadRow(*kvssd, key[0], output_value), ycsbc::utils::Exception);
+
+    // Each request completes with its own outcome; inserts do not overwrite.
+    void *insert = batch.Insert(*kvssd, key[1], value[0], cq);
+    void *store = batch.Store(*kvssd, key[0], value[0], cq);
+    batch.Flush(*kvssd);
+    EXPECT_EQ(batch.Size(), 0);
+    ASSERT_TRUE(cq.TryPop(completion));
+    EXPECT_EQ(completion.private_data, insert);
+    EXPECT_EQ(kvssd_hashmap::TryCompleteRow(completion, nullptr),
+              kvssd::kvs_result::KVS_ERR_KS_EXIST);
+    ASSERT_TRUE(cq.TryPop(completion));
+    EXPECT_EQ(completion.private_data, store);
+    EXPECT_EQ(kvssd_hashmap::TryCompleteRow(completion, nullptr), kvssd::kvs_result::KVS_SUCCESS);
+    kvssd_hashmap::ReadRow(*kvssd, key[1], output_value);
+    EXPECT_FALSE(FieldVectorCmp(value[1], output_value));
+}
+
 TEST_F(KvssdHashMapDbImplTest, Reinsertion) {
     EXPECT_NO_THROW(kvssd_hashmap::InsertRow(*kvssd, key[0], value[0]));
     EXPECT_NO_THROW(kvssd_hashmap::InsertRow(*kvssd, key[1], value[1]));
@@ -244,7 +533,7 @@ TEST_F(KvssdHashMapDbImplTest, DeleteAccessInvalidKey) {
         ycsbc::utils::Exception);
 }
 
-TEST_F(KvssdHashMapDbImplTest, ParallelOperations) {
+void RunParallelOperations(const std::unique_ptr<kvssd::KVSSD> &kvssd) {
     std::array<pthread_t, NUM_THREADS> threads;
     std::array<ThreadArgs, NUM_THREADS> thread_args;
 
@@ -275,4 +564,971 @@ TEST_F(KvssdHashMapDbImplTest, ParallelOperations) {
             << "Thread " << t << " operations failed. Error: " << thread_args[t].error_msg;
     }
 }
-}  // anonymous namespace
\ No newline at end of file
+
+TEST_F(KvssdHashMapDbImplTest, ParallelOperations) { RunParallelOperations(kvssd); }
+
+TEST_F(KvssdShardedDbImplTest, ReadLarge) {
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        EXPECT_NO_THROW(kvssd_hashmap::InsertRow(*kvssd, key[i], value[i]));
+    }
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        EXPECT_NO_THROW(kvssd_hashmap::ReadRow(*kvssd, key[i], output_value));
+        EXPECT_FALSE(FieldVectorCmp(value[i], output_value));
+    }
+}
+
+TEST_F(KvssdShardedDbImplTest, UpdateAccessInvalidKey) {
+    for (size_t i = 0; i < 10; i++) {
+        EXPECT_NO_THROW(kvssd_hashmap::InsertRow(*kvssd, key[i], value[i]));
+    }
+    EXPECT_THROW(
+        {
+            try {
+                kvssd_hashmap::UpdateRow(*kvssd, key[99], value[99]);
+            } catch (const ycsbc::utils::Exception &e) {
+                EXPECT_STREQ("Key space does not exist", e.what());
+                throw;
+            }
+        },
+        ycsbc::utils::Exception);
+}
+
+TEST_F(KvssdShardedDbImplTest, DeleteLarge) {
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        EXPECT_NO_THROW(kvssd_hashmap::InsertRow(*kvssd, key[i], value[i]));
+    }
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        EXPECT_NO_THROW(kvssd_hashmap::DeleteRow(*kvssd, key[i]));
+    }
+    EXPECT_THROW(kvssd_hashmap::ReadRow(*kvssd, key[0], output_value), ycsbc::utils::Exception);
+}
+
+TEST_F(KvssdShardedDbImplTest, ParallelOperations) { RunParallelOperations(kvssd); }
+
+TEST_F(KvssdLockFreeDbImplTest, ReadLarge) {
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        EXPECT_NO_THROW(kvssd_hashmap::InsertRow(*kvssd, key[i], value[i]));
+    }
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        EXPECT_NO_THROW(kvssd_hashmap::ReadRow(*kvssd, key[i], output_value));
+        EXPECT_FALSE(FieldVectorCmp(value[i], output_value));
+    }
+}
+
+TEST_F(KvssdLockFreeDbImplTest, ReadIntoCallerBuffer) { RunReadIntoCallerBuffer(*kvssd); }
+
+TEST_F(KvssdLockFreeDbImplTest, Reinsertion) {
+    EXPECT_NO_THROW(kvssd_hashmap::InsertRow(*kvssd, key[0], value[0]));
+    EXPECT_THROW(
+        {
+            try {
+                kvssd_hashmap::InsertRow(*kvssd, key[0], value[2]);
+            } catch (const ycsbc::utils::Exception &e) {
+                EXPECT_STREQ("Key space is already created", e.what());
+                throw;
+            }
+        },
+        ycsbc::utils::Exception);
+    EXPECT_NO_THROW(kvssd_hashmap::DeleteRow(*kvssd, key[0]));
+    EXPECT_NO_THROW(kvssd_hashmap::InsertRow(*kvssd, key[0], value[2]));
+    EXPECT_NO_THROW(kvssd_hashmap::ReadRow(*kvssd, key[0], output_value));
+    EXPECT_FALSE(FieldVectorCmp(value[2], output_value));
+}
+
+TEST_F(KvssdLockFreeDbImplTest, UpdateLarge) {
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        EXPECT_NO_THROW(kvssd_hashmap::InsertRow(*kvssd, key[i], value[i]));
+    }
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        EXPECT_NO_THROW(kvssd_hashmap::UpdateRow(*kvssd, key[i], value[(i + 500) % NUM_KEYS]));
+    }
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        EXPECT_NO_THROW(kvssd_hashmap::ReadRow(*kvssd, key[i], output_value));
+        EXPECT_FALSE(FieldVectorCmp(value[(i + 500) % NUM_KEYS], output_value));
+    }
+}
+
+TEST_F(KvssdLockFreeDbImplTest, DeleteAccessInvalidKey) {
+    for (size_t i = 0; i < 10; i++) {
+        EXPECT_NO_THROW(kvssd_hashmap::InsertRow(*kvssd, key[i], value[i]));
+        EXPECT_NO_THROW(kvssd_hashmap::DeleteRow(*kvssd, key[i]));
+    }
+    EXPECT_THROW(
+        {
+            try {
+                kvssd_hashmap::DeleteRow(*kvssd, key[0]);
+            } catch (const ycsbc::utils::Exception &e) {
+                EXPECT_STREQ("Key space does not exist", e.what());
+                throw;
+            }
+        },
+        ycsbc::utils::Exception);
+    EXPECT_THROW(kvssd_hashmap::UpdateRow(*kvssd, key[1], value[1]), ycsbc::utils::Exception);
+    EXPECT_THROW(kvssd_hashmap::ReadRow(*kvssd, key[2], output_value), ycsbc::utils::Exception);
+}
+
+TEST_F(KvssdLockFreeDbImplTest, CapacityExhausted) {
+    kvssd.reset(new kvssd_lockfree::LockFree_KVSSD(4));
+    for (size_t i = 0; i < 4; i++) {
+        EXPECT_NO_THROW(kvssd_hashmap::InsertRow(*kvssd, key[i], value[i]));
+    }
+    EXPECT_THROW(
+        {
+            try {
+                kvssd_hashmap::InsertRow(*kvssd, key[4], value[4]);
+            } catch (const ycsbc::utils::Exception &e) {
+                EXPECT_STREQ("Device does not have enough space", e.what());
+                throw;
+            }
+        },
+        ycsbc::utils::Exception);
+}
+
+TEST_F(KvssdLockFreeDbImplTest, ParallelOperations) { RunParallelOperations(kvssd); }
+
+// Readers race with updaters on the same few keys; every read must observe
+// one of the values that was written, never a freed or torn record.
+TEST_F(KvssdLockFreeDbImplTest, ConcurrentReadUpdateSameKeys) {
+    constexpr size_t HOT_KEYS = 8;
+    constexpr size_t ROUNDS = 20'000;
+    for (size_t i = 0; i < HOT_KEYS; i++) {
+        kvssd_hashmap::InsertRow(*kvssd, key[i], value[0]);
+    }
+    std::atomic<bool> ok{true};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < NUM_THREADS; t++) {
+        threads.emplace_back([&, t] {
+            std::vector<ycsbc::DB::Field> out;
+            for (size_t i = 0; i < ROUNDS; i++) {
+                const std::string &k = key[i % HOT_KEYS];
+                if (t & 1) {
+                    kvssd_hashmap::UpdateRow(*kvssd, k, value[i & 1]);
+                } else {
+                    out.clear();
+                    kvssd_hashmap::ReadRow(*kvssd, k, out);
+                    if (FieldVectorCmp(out, value[0]) && FieldVectorCmp(out, value[1])) {
+                        ok = false;
+                    }
+                }
+            }
+        });
+    }
+    for (auto &th : threads) {
+        th.join();
+    }
+    EXPECT_TRUE(ok);
+}
+
+// Keeps queue_depth requests in flight: inserts every key, reads each one
+// back through the completion queue and checks the returned rows.
+void RunAsyncInsertRead(kvssd::KVSSD &kv, size_t queue_depth, size_t num_keys) {
+    kvssd::CompletionQueue cq;
+    size_t outstanding = 0;
+    auto reap = [&](size_t max_outstanding) {
+        while (outstanding > max_outstanding) {
+            kvssd_hashmap::CompleteRow(cq.Wait(), nullptr);
+            outstanding--;
+        }
+    };
+    for (size_t i = 0; i < num_keys; i++) {
+        kvssd_hashmap::SubmitInsertRow(kv, key[i], value[i], cq);
+        outstanding++;
+        reap(queue_depth - 1);
+    }
+    reap(0);
+
+    // Every other read gets a buffer too small for its row and is retried.
+    std::vector<std::vector<char>> buffers(num_keys);
+    std::unordered_map<void *, size_t> pending;
+    std::vector<ycsbc::DB::Field> output;
+    for (size_t i = 0; i < num_keys; i++) {
+        buffers[i].resize(i % 2 ? 16 : 1024);
+        pending[kvssd_hashmap::SubmitReadRow(kv, key[i], cq, buffers[i])] = i;
+        while (pending.size() >= queue_depth || (i + 1 == num_keys && !pending.empty())) {
+            kvssd::kvs_completion completion = cq.Wait();
+            size_t idx = pending.at(completion.private_data);
+            pending.erase(completion.private_data);
+            if (!kvssd_hashmap::CompleteRow(completion, &output)) {
+                EXPECT_EQ(idx % 2, 1);
+                kvssd_hashmap::ReadRow(kv, key[idx], output, buffers[idx]);
+            }
+            EXPECT_FALSE(FieldVectorCmp(value[idx], output));
+        }
+    }
+}
+
+TEST(KvssdAsyncTest, HashmapWorkerPool) {
+    kvssd_hashmap::Hashmap_KVSSD kv(4);
+    RunAsyncInsertRead(kv, 32, 10'000);
+}
+
+TEST(KvssdAsyncTest, ShardedWorkerPool) {
+    kvssd_hashmap::Sharded_KVSSD kv(NUM_SHARDS, 4);
+    RunAsyncInsertRead(kv, 32, 10'000);
+}
+
+TEST(KvssdAsyncTest, InlineCompletion) {
+    kvssd_lockfree::LockFree_KVSSD kv(NUM_KEYS);
+    RunAsyncInsertRead(kv, 8, 1'000);
+}
+
+TEST(KvssdAsyncTest, ErrorsAreCompleted) {
+    kvssd_hashmap::Hashmap_KVSSD kv(2);
+    kvssd::CompletionQueue cq;
+    kvssd_hashmap::SubmitUpdateRow(kv, key[0], value[0], cq);
+    EXPECT_THROW(kvssd_hashmap::CompleteRow(cq.Wait(), nullptr), ycsbc::utils::Exception);
+
+    // TryCompleteRow hands the results back instead, by the request's tag.
+    void *tag = kvssd_hashmap::SubmitUpdateRow(kv, key[0], value[0], cq);
+    kvssd::kvs_completion completion = cq.Wait();
+    EXPECT_EQ(completion.private_data, tag);
+    EXPECT_EQ(kvssd_hashmap::TryCompleteRow(completion, nullptr),
+              kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST);
+    std::vector<char> buffer;
+    std::vector<ycsbc::DB::Field> output;
+    kvssd_hashmap::SubmitReadRow(kv, key[0], cq, buffer);
+    EXPECT_EQ(kvssd_hashmap::TryCompleteRow(cq.Wait(), &output),
+              kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST);
+    EXPECT_TRUE(output.empty());
+}
+
+// Loads a small table through the kvssd binding and returns the average
+// READ latency, in nanoseconds, of reading it at ops_per_sec with
+// outstanding operations in flight.
+double RateLimitedReadAvg(int outstanding, int64_t ops_per_sec) {
+    ycsbc::utils::Properties props;
+    props.SetProperty("recordcount", "1000");
+    props.SetProperty("readproportion", "1");
+    props.SetProperty("updateproportion", "0");
+    props.SetProperty("kvssd.async_workers", "2");
+    ycsbc::BasicMeasurements measurements;
+    ycsbc::DB *kvssd_db = NewKvssdDB();
+    kvssd_db->SetProps(&props);
+    ycsbc::DBWrapper db(kvssd_db, &measurements, ycsbc::LatencyInterval::OP,
+                        ycsbc::LatencyClock::STEADY);
+    db.Init();
+    ycsbc::CoreWorkload wl;
+    wl.Init(props);
+
+    ycsbc::utils::OpCounter load(1'000, 0);
+    ycsbc::AsyncClientLoop(&db, &wl, &load, true, outstanding, nullptr, nullptr);
+    measurements.Reset();
+    ycsbc::utils::OpCounter run(300, 0);
+    ycsbc::utils::RateLimiter rlim(ops_per_sec, ops_per_sec);
+    ycsbc::AsyncClientLoop(&db, &wl, &run, false, outstanding, &rlim, nullptr);
+    db.Cleanup();
+
+    for (const ycsbc::SeriesSummary &series : measurements.GetSummary()) {
+        if (series.name == "READ") {
+            EXPECT_EQ(series.count, 300);
+            EXPECT_EQ(series.failures, 0);
+            return series.avg;
+        }
+    }
+    ADD_FAILURE() << "no READ latencies";
+    return 0;
+}
+
+// Waiting for the rate limit is not charged to the operations in flight, so
+// their latency does not grow with how many the client keeps in flight.
+TEST(KvssdClientTest, RateLimitedLatencyIsFlat) {
+    double avg_one = RateLimitedReadAvg(1, 1'000);
+    double avg_eight = RateLimitedReadAvg(8, 1'000);
+    EXPECT_LT(avg_eight, avg_one + 500'000) << "1 ms between operations";
+}
+
+// Inserts num_keys rows and scans a window of them in key order.
+void RunScanInOrder(kvssd::KVSSD &kv, size_t num_keys) {
+    std::vector<size_t> order(num_keys);
+    for (size_t i = 0; i < num_keys; i++) {
+        order[i] = i;
+        kvssd_hashmap::InsertRow(kv, key[i], value[i]);
+    }
+    std::sort(order.begin(), order.end(), [](size_t a, size_t b) { return key[a] < key[b]; });
+
+    std::vector<std::vector<ycsbc::DB::Field>> rows;
+    std::vector<char> key_buffer, value_buffer;
+    ASSERT_TRUE(
+        kvssd_hashmap::ScanRows(kv, key[order[100]], 500, rows, key_buffer, value_buffer));
+    ASSERT_EQ(rows.size(), 500);
+    for (size_t i = 0; i < rows.size(); i++) {
+        EXPECT_FALSE(FieldVectorCmp(value[order[100 + i]], rows[i]));
+    }
+
+    // Scanning past the last key stops early.
+    ASSERT_TRUE(kvssd_hashmap::ScanRows(kv, key[order[num_keys - 10]], 100, rows, key_buffer,
+                                        value_buffer));
+    EXPECT_EQ(rows.size(), 10);
+}
+
+std::vector<std::string> DrainIterator(kvssd::KVSSD &kv, kvssd::kvs_iterator_handle handle,
+                                       uint32_t buffer_size) {
+    std::vector<char> buffer(buffer_size);
+    kvssd::kvs_iterator_list list{buffer.data(), buffer_size, 0, false};
+    std::vector<std::string> keys;
+    while (!list.end) {
+        EXPECT_EQ(kv.IteratorNext(handle, list), kvssd::kvs_result::KVS_SUCCESS);
+        const char *p = buffer.data();
+        for (uint32_t i = 0; i < list.num_entries; i++) {
+            uint32_t length;
+            std::memcpy(&length, p, sizeof(length));
+            keys.emplace_back(p + sizeof(length), length);
+            p += sizeof(length) + length;
+        }
+    }
+    return keys;
+}
+
+TEST(KvssdIteratorTest, HashmapScan) {
+    kvssd_hashmap::Hashmap_KVSSD kv;
+    RunScanInOrder(kv, 10'000);
+}
+
+TEST(KvssdIteratorTest, ShardedScan) {
+    kvssd_hashmap::Sharded_KVSSD kv(NUM_SHARDS);
+    RunScanInOrder(kv, 10'000);
+}
+
+TEST(KvssdIteratorTest, ScanSkipsDeletedKeys) {
+    kvssd_hashmap::Hashmap_KVSSD kv;
+    for (size_t i = 0; i < 10; i++) {
+        kvssd_hashmap::InsertRow(kv, key[i], value[i]);
+    }
+    kvssd_hashmap::DeleteRow(kv, key[1]);
+    std::vector<std::vector<ycsbc::DB::Field>> rows;
+    std::vector<char> key_buffer, value_buffer;
+    ASSERT_TRUE(kvssd_hashmap::ScanRows(kv, key[0], 3, rows, key_buffer, value_buffer));
+    ASSERT_EQ(rows.size(), 3);
+    EXPECT_FALSE(FieldVectorCmp(value[0], rows[0]));  // key0, key2, key3
+    EXPECT_FALSE(FieldVectorCmp(value[2], rows[1]));
+}
+
+TEST(KvssdIteratorTest, KeyGroupFilterInSmallBatches) {
+    kvssd_hashmap::Sharded_KVSSD kv(4);
+    std::vector<std::string> expected;
+    for (size_t i = 0; i < 1'000; i++) {
+        std::string name = (i % 2 ? "odd_" : "even") + std::to_string(i);
+        kvssd_hashmap::InsertRow(kv, name, value[i]);
+        if (i % 2 == 0) {
+            expected.push_back(name);
+        }
+    }
+    std::sort(expected.begin(), expected.end());
+
+    kvssd::kvs_key_group_filter filter{{0xff, 0xff, 0xff, 0xff}, {'e', 'v', 'e', 'n'}};
+    kvssd::kvs_iterator_handle handle;
+    ASSERT_EQ(kv.OpenIterator(filter, nullptr, handle), kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(DrainIterator(kv, handle, 64), expected);
+    EXPECT_EQ(kv.CloseIterator(handle), kvssd::kvs_result::KVS_SUCCESS);
+}
+
+TEST(KvssdIteratorTest, IteratorErrors) {
+    kvssd_hashmap::Hashmap_KVSSD kv;
+    kvssd_hashmap::InsertRow(kv, key[0], value[0]);
+
+    kvssd::kvs_key_group_filter all{};
+    kvssd::kvs_key_group_filter invalid{{0x0f, 0, 0, 0}, {0xf0, 0, 0, 0}};
+    kvssd::kvs_iterator_handle handle;
+    EXPECT_EQ(kv.OpenIterator(invalid, nullptr, handle),
+              kvssd::kvs_result::KVS_ERR_ITERATOR_FILTER_INVALID);
+
+    ASSERT_EQ(kv.OpenIterator(all, nullptr, handle), kvssd::kvs_result::KVS_SUCCESS);
+    char small[4];
+    kvssd::kvs_iterator_list list{small, sizeof(small), 0, false};
+    EXPECT_EQ(kv.IteratorNext(handle, list), kvssd::kvs_result::KVS_ERR_BUFFER_SMALL);
+    EXPECT_EQ(kv.CloseIterator(handle), kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(kv.IteratorNext(handle, list), kvssd::kvs_result::KVS_ERR_ITERATOR_NOT_EXIST);
+    EXPECT_EQ(kv.CloseIterator(handle), kvssd::kvs_result::KVS_ERR_ITERATOR_NOT_EXIST);
+
+    std::vector<kvssd::kvs_iterator_handle> handles(KVS_MAX_ITERATE_HANDLE);
+    for (auto &h : handles) {
+        ASSERT_EQ(kv.OpenIterator(all, nullptr, h), kvssd::kvs_result::KVS_SUCCESS);
+    }
+    EXPECT_EQ(kv.OpenIterator(all, nullptr, handle), kvssd::kvs_result::KVS_ERR_ITERATOR_MAX);
+    for (auto h : handles) {
+        EXPECT_EQ(kv.CloseIterator(h), kvssd::kvs_result::KVS_SUCCESS);
+    }
+}
+
+TEST(KvssdIteratorTest, LockFreeHasNoIterators) {
+    kvssd_lockfree::LockFree_KVSSD kv(NUM_KEYS);
+    std::vector<std::vector<ycsbc::DB::Field>> rows;
+    std::vector<char> key_buffer, value_buffer;
+    EXPECT_FALSE(kvssd_hashmap::ScanRows(kv, key[0], 10, rows, key_buffer, value_buffer));
+}
+
+TEST(KvssdSlabTest, SizeClassesAndReuse) {
+    kvssd::SlabAllocator slab(KVS_ALIGNMENT_UNIT);
+    EXPECT_EQ(slab.Capacity(0), 0);
+    EXPECT_EQ(slab.Capacity(1), KVS_ALIGNMENT_UNIT);
+    EXPECT_EQ(slab.Capacity(KVS_ALIGNMENT_UNIT + 1), 2 * KVS_ALIGNMENT_UNIT);
+    EXPECT_EQ(slab.Capacity(16 * KVS_ALIGNMENT_UNIT + 1), 32 * KVS_ALIGNMENT_UNIT);
+    EXPECT_EQ(slab.Capacity(KVS_MAX_VALUE_LENGTH), KVS_MAX_VALUE_LENGTH);
+
+    void *a = slab.Allocate(1000);
+    void *b = slab.Allocate(1000);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % KVS_ALIGNMENT_UNIT, 0);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % KVS_ALIGNMENT_UNIT, 0);
+    EXPECT_NE(a, b);
+    size_t allocated = slab.AllocatedBytes();
+    slab.Free(a, 1000);
+    EXPECT_EQ(slab.Allocate(600), a);
+    EXPECT_EQ(slab.AllocatedBytes(), allocated);
+
+    void *large = slab.Allocate(KVS_MAX_VALUE_LENGTH);
+    EXPECT_EQ(slab.AllocatedBytes(), allocated + KVS_MAX_VALUE_LENGTH);
+    slab.Free(large, KVS_MAX_VALUE_LENGTH);
+}
+
+kvssd::NandTimingModel::Config SmallDevice() {
+    kvssd::NandTimingModel::Config config;
+    config.read_ns = 100;
+    config.write_ns = 50;
+    config.delete_ns = 10;
+    config.bus_bytes_per_ns = 1;
+    config.channels = 2;
+    config.dies_per_channel = 2;
+    return config;
+}
+
+TEST(KvssdTimingTest, RequestsQueueOnDiesAndChannels) {
+    kvssd::NandTimingModel model(SmallDevice());
+    using kvssd::kvs_opcode;
+    // Dies 0 and 1 share channel 0, die 2 is on channel 1.
+    EXPECT_EQ(model.Schedule(kvs_opcode::READ, 0, 0, 0), 100);
+    EXPECT_EQ(model.Schedule(kvs_opcode::READ, 0, 0, 0), 200);
+    EXPECT_EQ(model.Schedule(kvs_opcode::READ, 1, 0, 0), 100);
+    EXPECT_EQ(model.Schedule(kvs_opcode::READ, 1, 300, 0), 500);
+    // Die 0 is done sensing at 300 but the bus is held by die 1 until 500.
+    EXPECT_EQ(model.Schedule(kvs_opcode::READ, 0, 300, 0), 800);
+    EXPECT_EQ(model.Schedule(kvs_opcode::READ, 2, 300, 0), 400);
+    // A write transfers first, then programs.
+    EXPECT_EQ(model.Schedule(kvs_opcode::UPDATE, 6, 100, 1'000), 1'150);
+    EXPECT_EQ(model.Schedule(kvs_opcode::DELETE, 6, 0, 1'000), 1'160);
+    EXPECT_EQ(model.GcStalls(), 0);
+}
+
+TEST(KvssdTimingTest, WriteAmplificationStallsDies) {
+    kvssd::NandTimingModel::Config config = SmallDevice();
+    config.write_amplification = 3;
+    config.gc_block_bytes = 1'000;
+    config.gc_stall_ns = 10'000;
+    kvssd::NandTimingModel model(config);
+    // 400 bytes leave 800 bytes of relocation; the next 400 push it past a block.
+    EXPECT_EQ(model.Schedule(kvssd::kvs_opcode::INSERT, 0, 400, 0), 450);
+    EXPECT_EQ(model.Schedule(kvssd::kvs_opcode::INSERT, 0, 400, 0), 10'850);
+    EXPECT_EQ(model.GcStalls(), 1);
+}
+
+TEST_F(KvssdHashMapDbImplTest, TimingModelDelaysRequests) {
+    kvssd::NandTimingModel::Config config = SmallDevice();
+    config.read_ns = 2'000'000;
+    static_cast<kvssd_hashmap::Hashmap_KVSSD &>(*kvssd).SetTimingModel(
+        std::make_shared<kvssd::NandTimingModel>(config));
+    kvssd_hashmap::InsertRow(*kvssd, key[0], value[0]);
+    uint64_t start = kvssd::NowNs();
+    kvssd_hashmap::ReadRow(*kvssd, key[0], output_value);
+    EXPECT_GE(kvssd::NowNs() - start, config.read_ns);
+    EXPECT_FALSE(FieldVectorCmp(value[0], output_value));
+}
+
+TEST_F(KvssdShardedDbImplTest, ReserveKeepsRecords) {
+    auto &sharded = static_cast<kvssd_hashmap::Sharded_KVSSD &>(*kvssd);
+    sharded.Reserve(1'000, 0.5);
+    for (size_t i = 0; i < 1'000; i++) {
+        kvssd_hashmap::InsertRow(*kvssd, key[i], value[i]);
+    }
+    // Growing a populated map rehashes it without losing anything.
+    sharded.Reserve(100'000, 0);
+    for (size_t i = 0; i < 1'000; i++) {
+        kvssd_hashmap::ReadRow(*kvssd, key[i], output_value);
+        EXPECT_FALSE(FieldVectorCmp(value[i], output_value));
+    }
+}
+
+// Writes past the capacity fail and leave the device as it was.
+void RunCapacityQuota(kvssd::KVSSD &kv) {
+    std::string data(400, 'v');
+    kvssd::kvs_key k{const_cast<char *>(key[0].data()), static_cast<uint16_t>(key[0].size())};
+    kvssd::kvs_value v{data.data(), 100, 0, 0};
+    ASSERT_EQ(kv.SetCapacity(200), kvssd::kvs_result::KVS_SUCCESS);
+    ASSERT_EQ(kv.Insert(k, v), kvssd::kvs_result::KVS_SUCCESS);
+    v.length = 400;
+    EXPECT_EQ(kv.Update(k, v), kvssd::kvs_result::KVS_ERR_KS_CAPACITY);
+    v.length = 150;
+    EXPECT_EQ(kv.Append(k, v), kvssd::kvs_result::KVS_ERR_KS_CAPACITY);
+    v.length = 50;
+    EXPECT_EQ(kv.Update(k, v), kvssd::kvs_result::KVS_SUCCESS);
+    kvssd::kvs_memory_usage usage;
+    kv.GetMemoryUsage(usage);
+    EXPECT_EQ(usage.value_bytes, 50);
+
+    ASSERT_EQ(kv.SetCapacity(0), kvssd::kvs_result::KVS_SUCCESS);
+    v.length = 400;
+    EXPECT_EQ(kv.Update(k, v), kvssd::kvs_result::KVS_SUCCESS);
+}
+
+TEST_F(KvssdHashMapDbImplTest, CapacityQuota) { RunCapacityQuota(*kvssd); }
+
+// A single shard holds the key, with its part of the capacity.
+TEST(KvssdShardedCapacityTest, CapacityQuota) {
+    kvssd_hashmap::Sharded_KVSSD kv(1);
+    RunCapacityQuota(kv);
+}
+
+TEST(KvssdKeySpaceTest, Lifecycle) {
+    kvssd::KeySpaceTable spaces([](const std::string &) {
+        return std::make_unique<kvssd_hashmap::Hashmap_KVSSD>();
+    });
+    EXPECT_EQ(spaces.Create("", 0), kvssd::kvs_result::KVS_ERR_KS_NAME);
+    EXPECT_EQ(spaces.Create(std::string(KVS_MAX_KEY_SPACE_NAME_LENGTH + 1, 'a'), 0),
+              kvssd::kvs_result::KVS_ERR_KS_NAME);
+    ASSERT_EQ(spaces.Create("hot", 0), kvssd::kvs_result::KVS_SUCCESS);
+    ASSERT_EQ(spaces.Create("cold", 1'000), kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(spaces.Create("hot", 0), kvssd::kvs_result::KVS_ERR_KS_EXIST);
+
+    kvssd::KVSSD *hot;
+    kvssd::KVSSD *cold;
+    EXPECT_EQ(spaces.Open("warm", hot), kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST);
+    ASSERT_EQ(spaces.Open("hot", hot), kvssd::kvs_result::KVS_SUCCESS);
+    ASSERT_EQ(spaces.Open("cold", cold), kvssd::kvs_result::KVS_SUCCESS);
+    ASSERT_NE(hot, cold);
+
+    // The same key lives independently in each key space.
+    std::vector<ycsbc::DB::Field> output;
+    kvssd_hashmap::InsertRow(*hot, key[0], value[0]);
+    kvssd_hashmap::InsertRow(*cold, key[0], value[1]);
+    kvssd_hashmap::ReadRow(*hot, key[0], output);
+    EXPECT_FALSE(FieldVectorCmp(value[0], output));
+    kvssd_hashmap::ReadRow(*cold, key[0], output);
+    EXPECT_FALSE(FieldVectorCmp(value[1], output));
+    // Only the cold key space has a quota.
+    for (size_t i = 1; i < 100; i++) {
+        kvssd_hashmap::InsertRow(*hot, key[i], value[i]);
+    }
+    EXPECT_THROW(
+        for (size_t i = 1; i < 100; i++) { kvssd_hashmap::InsertRow(*cold, key[i], value[i]); },
+        ycsbc::utils::Exception);
+
+    std::vector<std::string> names;
+    spaces.ForEach([&names](const std::string &name, kvssd::KVSSD &) { names.push_back(name); });
+    EXPECT_EQ(names, (std::vector<std::string>{"cold", "hot"}));
+
+    // Opens nest, and a key space can only be deleted once all are closed.
+    kvssd::KVSSD *again;
+    ASSERT_EQ(spaces.Open("hot", again), kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(again, hot);
+    EXPECT_EQ(spaces.Close(hot), kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(spaces.Delete("hot"), kvssd::kvs_result::KVS_ERR_KS_OPEN);
+    EXPECT_EQ(spaces.Close(hot), kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(spaces.Close(hot), kvssd::kvs_result::KVS_ERR_KS_NOT_OPEN);
+    EXPECT_EQ(spaces.Delete("hot"), kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(spaces.Delete("hot"), kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST);
+    EXPECT_EQ(spaces.Close(cold), kvssd::kvs_result::KVS_SUCCESS);
+}
+
+// Backends that cannot enforce a quota refuse key spaces with one.
+TEST(KvssdKeySpaceTest, QuotaNeedsBackendSupport) {
+    kvssd::KeySpaceTable spaces([](const std::string &) {
+        return std::make_unique<kvssd_lockfree::LockFree_KVSSD>(1'024);
+    });
+    EXPECT_EQ(spaces.Create("usertable", 1'000), kvssd::kvs_result::KVS_ERR_OPTION_INVALID);
+    EXPECT_EQ(spaces.Create("usertable", 0), kvssd::kvs_result::KVS_SUCCESS);
+}
+
+size_t KeyHash(const std::string &k) {
+    return std::hash<kvssd::kvs_key>{}(
+        {const_cast<char *>(k.data()), static_cast<uint16_t>(k.size())});
+}
+
+TEST(KvssdFilterTest, FalsePositivesAndRemoval) {
+    constexpr size_t KEYS = 10'000;
+    kvssd::CountingBloomFilter filter(KEYS, 10);
+    for (size_t i = 0; i < KEYS; i++) {
+        filter.Add(KeyHash(key[i]));
+    }
+    size_t false_positives = 0;
+    for (size_t i = 0; i < KEYS; i++) {
+        ASSERT_TRUE(filter.MayContain(KeyHash(key[i])));
+        false_positives += filter.MayContain(KeyHash(key[KEYS + i]));
+    }
+    EXPECT_LT(false_positives, KEYS * 3 / 100);
+
+    // Removing the keys empties the filter again, bar saturated counters.
+    for (size_t i = 0; i < KEYS; i++) {
+        filter.Remove(KeyHash(key[i]));
+    }
+    size_t remaining = 0;
+    for (size_t i = 0; i < KEYS; i++) {
+        remaining += filter.MayContain(KeyHash(key[i]));
+    }
+    EXPECT_LT(remaining, KEYS / 100);
+}
+
+// Reads of absent keys are counted either as filter negatives or as false
+// positives, and present keys are never filtered out.
+void RunFilteredReads(kvssd::KVSSD &kv) {
+    for (size_t i = 0; i < 1'000; i++) {
+        kvssd_hashmap::InsertRow(kv, key[i], value[i]);
+    }
+    kvssd_hashmap::DeleteRow(kv, key[0]);
+    std::vector<char> buffer(4'096);
+    kvssd::kvs_value v{buffer.data(), static_cast<uint32_t>(buffer.size()), 0, 0};
+    for (size_t i = 0; i < 2'000; i++) {
+        kvssd::kvs_key k{const_cast<char *>(key[i].data()), static_cast<uint16_t>(key[i].size())};
+        EXPECT_EQ(kv.Read(k, v), 0 < i && i < 1'000 ? kvssd::kvs_result::KVS_SUCCESS
+                                                     : kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST);
+    }
+    kvssd::kvs_filter_stats stats;
+    ASSERT_EQ(kv.GetFilterStats(stats), kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(stats.negatives + stats.false_positives, 1'001);
+    EXPECT_GT(stats.negatives, 900);
+
+    // Batches settle the filtered keys and read the others.
+    std::vector<kvssd::kvs_key> keys;
+    std::vector<std::vector<char>> buffers(2, std::vector<char>(4'096));
+    std::vector<kvssd::kvs_value> values;
+    for (size_t i : {1'500, 1}) {
+        keys.push_back({const_cast<char *>(key[i].data()), static_cast<uint16_t>(key[i].size())});
+        values.push_back({buffers[keys.size() - 1].data(), 4'096, 0, 0});
+    }
+    kvssd::kvs_result results[2];
+    ASSERT_EQ(kv.BatchRead(keys.data(), values.data(), results, 2),
+              kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(results[0], kvssd::kvs_result::KVS_ERR_KS_NOT_EXIST);
+    EXPECT_EQ(results[1], kvssd::kvs_result::KVS_SUCCESS);
+}
+
+TEST_F(KvssdHashMapDbImplTest, FilteredReads) {
+    auto &hashmap = static_cast<kvssd_hashmap::Hashmap_KVSSD &>(*kvssd);
+    kvssd::kvs_filter_stats stats;
+    EXPECT_EQ(hashmap.GetFilterStats(stats), kvssd::kvs_result::KVS_ERR_OPTION_INVALID);
+    // A filter enabled on a populated map starts out with its keys.
+    kvssd_hashmap::InsertRow(*kvssd, key[1], value[1]);
+    hashmap.EnableFilter(1'000, 10);
+    kvssd_hashmap::ReadRow(*kvssd, key[1], output_value);
+    kvssd_hashmap::DeleteRow(*kvssd, key[1]);
+    RunFilteredReads(*kvssd);
+}
+
+TEST_F(KvssdShardedDbImplTest, FilteredReads) {
+    static_cast<kvssd_hashmap::Sharded_KVSSD &>(*kvssd).EnableFilter(1'000, 10);
+    RunFilteredReads(*kvssd);
+}
+
+// Images are independent of the sharding: one taken from a sharded device
+// restores into a single map.
+TEST_F(KvssdShardedDbImplTest, SnapshotRoundTrip) {
+    std::string path = ::testing::TempDir() + "kvssd_snapshot_test.img";
+    for (size_t i = 0; i < 5'000; i++) {
+        kvssd_hashmap::InsertRow(*kvssd, key[i], value[i]);
+    }
+    const kvssd::SnapshotWorkload workload{5'000, 10};
+    uint64_t records;
+    ASSERT_EQ(kvssd::DumpSnapshot(*kvssd, path, workload, records),
+              kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(records, 5'000);
+
+    auto *hashmap = new kvssd_hashmap::Hashmap_KVSSD();
+    hashmap->EnableFilter(5'000, 10);
+    kvssd.reset(hashmap);
+    // Images of another workload are refused before anything is restored.
+    EXPECT_EQ(kvssd::LoadSnapshot(*kvssd, path, {10'000, 10}, records),
+              kvssd::kvs_result::KVS_ERR_PARAM_INVALID);
+    EXPECT_EQ(kvssd::LoadSnapshot(*kvssd, path, {5'000, 1}, records),
+              kvssd::kvs_result::KVS_ERR_PARAM_INVALID);
+    EXPECT_EQ(records, 0);
+    ASSERT_EQ(kvssd::LoadSnapshot(*kvssd, path, workload, records),
+              kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(records, 5'000);
+    for (size_t i = 0; i < 5'000; i++) {
+        kvssd_hashmap::ReadRow(*kvssd, key[i], output_value);
+        EXPECT_FALSE(FieldVectorCmp(value[i], output_value));
+    }
+    std::vector<char> buffer;
+    EXPECT_FALSE(kvssd_hashmap::TryReadRow(*kvssd, key[5'000], output_value, buffer));
+    kvssd::kvs_memory_usage usage;
+    kvssd->GetMemoryUsage(usage);
+    EXPECT_EQ(usage.records, 5'000);
+
+    // Truncated images are refused.
+    truncate(path.c_str(), 1'000);
+    kvssd.reset(new kvssd_hashmap::Hashmap_KVSSD());
+    EXPECT_EQ(kvssd::LoadSnapshot(*kvssd, path, workload, records),
+              kvssd::kvs_result::KVS_ERR_SYS_IO);
+    unlink(path.c_str());
+    EXPECT_EQ(kvssd::LoadSnapshot(*kvssd, path, workload, records),
+              kvssd::kvs_result::KVS_ERR_SYS_IO);
+}
+
+TEST_F(KvssdLockFreeDbImplTest, SnapshotNeedsBackendSupport) {
+    std::string path = ::testing::TempDir() + "kvssd_snapshot_test.img";
+    kvssd_hashmap::InsertRow(*kvssd, key[0], value[0]);
+    uint64_t records;
+    EXPECT_EQ(kvssd::DumpSnapshot(*kvssd, path, {1, 10}, records),
+              kvssd::kvs_result::KVS_ERR_OPTION_INVALID);
+    EXPECT_NE(access(path.c_str(), F_OK), 0);
+    EXPECT_NE(access((path + ".tmp").c_str(), F_OK), 0);
+}
+
+TEST_F(KvssdHashMapDbImplTest, MemoryUsage) {
+    for (size_t i = 0; i < 1'000; i++) {
+        kvssd_hashmap::InsertRow(*kvssd, key[i], value[i]);
+    }
+    kvssd::kvs_memory_usage usage;
+    ASSERT_EQ(kvssd->GetMemoryUsage(usage), kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(usage.records, 1'000);
+    EXPECT_GE(usage.allocated_bytes, usage.key_bytes + usage.value_bytes);
+
+    // Rows of the same size class are overwritten in place.
+    for (size_t i = 0; i < 1'000; i++) {
+        kvssd_hashmap::UpdateRow(*kvssd, key[i], value[999 - i]);
+    }
+    kvssd::kvs_memory_usage updated;
+    kvssd->GetMemoryUsage(updated);
+    EXPECT_EQ(updated.allocated_bytes, usage.allocated_bytes);
+    for (size_t i = 0; i < 1'000; i++) {
+        kvssd_hashmap::ReadRow(*kvssd, key[i], output_value);
+        EXPECT_FALSE(FieldVectorCmp(value[999 - i], output_value));
+    }
+
+    for (size_t i = 0; i < 1'000; i++) {
+        kvssd_hashmap::DeleteRow(*kvssd, key[i]);
+    }
+    kvssd->GetMemoryUsage(usage);
+    EXPECT_EQ(usage.records, 0);
+    EXPECT_EQ(usage.key_bytes, 0);
+    EXPECT_EQ(usage.value_bytes, 0);
+}
+
+TEST_F(KvssdShardedDbImplTest, MemoryUsage) {
+    for (size_t i = 0; i < 1'000; i++) {
+        kvssd_hashmap::InsertRow(*kvssd, key[i], value[i]);
+    }
+    kvssd::kvs_memory_usage usage;
+    ASSERT_EQ(kvssd->GetMemoryUsage(usage), kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(usage.records, 1'000);
+}
+
+TEST_F(KvssdFileDbImplTest, ReadLarge) {
+    for (size_t i = 0; i < NUM_KEYS / 10; i++) {
+        EXPECT_NO_THROW(kvssd_hashmap::InsertRow(*kvssd, key[i], value[i]));
+    }
+    for (size_t i = 0; i < NUM_KEYS / 10; i++) {
+        EXPECT_NO_THROW(kvssd_hashmap::ReadRow(*kvssd, key[i], output_value));
+        EXPECT_FALSE(FieldVectorCmp(value[i], output_value));
+    }
+    auto &file = static_cast<kvssd_file::File_KVSSD &>(*kvssd);
+    EXPECT_EQ(file.LogSize() % KVS_ALIGNMENT_UNIT, 0);
+}
+
+TEST_F(KvssdFileDbImplTest, UpdateAccessInvalidKey) {
+    kvssd_hashmap::InsertRow(*kvssd, key[0], value[0]);
+    EXPECT_THROW(
+        {
+            try {
+                kvssd_hashmap::UpdateRow(*kvssd, key[99], value[99]);
+            } catch (const ycsbc::utils::Exception &e) {
+                EXPECT_STREQ("Key space does not exist", e.what());
+                throw;
+            }
+        },
+        ycsbc::utils::Exception);
+    EXPECT_THROW(kvssd_hashmap::InsertRow(*kvssd, key[0], value[1]), ycsbc::utils::Exception);
+}
+
+TEST_F(KvssdFileDbImplTest, ReopenRebuildsIndex) {
+    for (size_t i = 0; i < 1'000; i++) {
+        kvssd_hashmap::InsertRow(*kvssd, key[i], value[i]);
+    }
+    for (size_t i = 0; i < 1'000; i += 2) {
+        kvssd_hashmap::UpdateRow(*kvssd, key[i], value[i + 1]);
+    }
+    for (size_t i = 0; i < 1'000; i += 3) {
+        kvssd_hashmap::DeleteRow(*kvssd, key[i]);
+    }
+    uint64_t garbage = static_cast<kvssd_file::File_KVSSD &>(*kvssd).GarbageBytes();
+
+    kvssd.reset(Open(false));
+    EXPECT_EQ(static_cast<kvssd_file::File_KVSSD &>(*kvssd).GarbageBytes(), garbage);
+    for (size_t i = 0; i < 1'000; i++) {
+        if (i % 3 == 0) {
+            EXPECT_THROW(kvssd_hashmap::ReadRow(*kvssd, key[i], output_value),
+                         ycsbc::utils::Exception);
+            continue;
+        }
+        kvssd_hashmap::ReadRow(*kvssd, key[i], output_value);
+        EXPECT_FALSE(FieldVectorCmp(value[i % 2 ? i : i + 1], output_value));
+    }
+}
+
+TEST_F(KvssdFileDbImplTest, CompactionDropsGarbage) {
+    auto *file = static_cast<kvssd_file::File_KVSSD *>(kvssd.get());
+    for (size_t i = 0; i < 100; i++) {
+        kvssd_hashmap::InsertRow(*kvssd, key[i], value[i]);
+    }
+    uint64_t live_size = file->LogSize();
+    for (size_t round = 0; round < 5; round++) {
+        for (size_t i = 0; i < 100; i++) {
+            kvssd_hashmap::UpdateRow(*kvssd, key[i], value[(i + round + 1) % 100]);
+        }
+    }
+    EXPECT_GT(file->GarbageBytes(), 0);
+    ASSERT_EQ(file->Compact(), kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(file->GarbageBytes(), 0);
+    EXPECT_EQ(file->LogSize(), live_size);
+    for (size_t i = 0; i < 100; i++) {
+        kvssd_hashmap::ReadRow(*kvssd, key[i], output_value);
+        EXPECT_FALSE(FieldVectorCmp(value[(i + 5) % 100], output_value));
+    }
+
+    // The compacted log is what a reopen sees.
+    kvssd.reset(Open(false));
+    for (size_t i = 0; i < 100; i++) {
+        kvssd_hashmap::ReadRow(*kvssd, key[i], output_value);
+        EXPECT_FALSE(FieldVectorCmp(value[(i + 5) % 100], output_value));
+    }
+}
+
+TEST_F(KvssdFileDbImplTest, CompactionKeepsConcurrentWrites) {
+    auto *file = static_cast<kvssd_file::File_KVSSD *>(kvssd.get());
+    for (size_t i = 0; i < 100; i++) {
+        kvssd_hashmap::InsertRow(*kvssd, key[i], value[i]);
+    }
+    for (size_t i = 0; i < 100; i++) {
+        kvssd_hashmap::UpdateRow(*kvssd, key[i], value[(i + 1) % 100]);
+    }
+    std::thread writer([&] {
+        for (size_t round = 2; round < 20; round++) {
+            for (size_t i = 0; i < 100; i++) {
+                kvssd_hashmap::UpdateRow(*kvssd, key[i], value[(i + round) % 100]);
+            }
+        }
+        for (size_t i = 0; i < 100; i += 2) {
+            kvssd_hashmap::DeleteRow(*kvssd, key[i]);
+        }
+    });
+    for (size_t i = 0; i < 5; i++) {
+        ASSERT_EQ(file->Compact(), kvssd::kvs_result::KVS_SUCCESS);
+    }
+    writer.join();
+    ASSERT_EQ(file->Compact(), kvssd::kvs_result::KVS_SUCCESS);
+
+    for (int reopen = 0; reopen < 2; reopen++) {
+        for (size_t i = 0; i < 100; i++) {
+            if (i % 2 == 0) {
+                EXPECT_THROW(kvssd_hashmap::ReadRow(*kvssd, key[i], output_value),
+                             ycsbc::utils::Exception);
+                continue;
+            }
+            kvssd_hashmap::ReadRow(*kvssd, key[i], output_value);
+            EXPECT_FALSE(FieldVectorCmp(value[(i + 19) % 100], output_value));
+        }
+        kvssd.reset(Open(false));
+    }
+}
+
+TEST_F(KvssdFileDbImplTest, TornTailIsTruncated) {
+    for (size_t i = 0; i < 10; i++) {
+        kvssd_hashmap::InsertRow(*kvssd, key[i], value[i]);
+    }
+    uint64_t size = static_cast<kvssd_file::File_KVSSD &>(*kvssd).LogSize();
+    kvssd.reset();
+    {
+        std::ofstream log(path, std::ios::binary | std::ios::app);
+        log << "a partially written record";
+    }
+    kvssd.reset(Open(false));
+    EXPECT_EQ(static_cast<kvssd_file::File_KVSSD &>(*kvssd).LogSize(), size);
+    for (size_t i = 0; i < 10; i++) {
+        kvssd_hashmap::ReadRow(*kvssd, key[i], output_value);
+        EXPECT_FALSE(FieldVectorCmp(value[i], output_value));
+    }
+    EXPECT_NO_THROW(kvssd_hashmap::InsertRow(*kvssd, key[10], value[10]));
+}
+
+TEST_F(KvssdFileDbImplTest, ParallelOperations) { RunParallelOperations(kvssd); }
+
+TEST_F(KvssdFileDbImplTest, Scan) { RunScanInOrder(*kvssd, 1'000); }
+
+// Inserts, overwrites, compacts and reopens through the given engine, and
+// checks that every request shows up in the I/O statistics.
+void RunIoEngineRoundTrip(std::unique_ptr<kvssd::KVSSD> &kvssd,
+                          const std::function<kvssd_file::File_KVSSD *(bool)> &open) {
+    for (size_t i = 0; i < 100; i++) {
+        kvssd_hashmap::InsertRow(*kvssd, key[i], value[i]);
+        kvssd_hashmap::UpdateRow(*kvssd, key[i], value[(i + 1) % 100]);
+    }
+    std::vector<ycsbc::DB::Field> output_value;
+    for (size_t i = 0; i < 100; i++) {
+        kvssd_hashmap::ReadRow(*kvssd, key[i], output_value);
+        EXPECT_FALSE(FieldVectorCmp(value[(i + 1) % 100], output_value));
+    }
+    kvssd::kvs_io_stats stats;
+    ASSERT_EQ(kvssd->GetIoStats(stats), kvssd::kvs_result::KVS_SUCCESS);
+    EXPECT_EQ(stats.writes, 200);
+    EXPECT_EQ(stats.reads, 100);
+    EXPECT_GT(stats.read_device_ns, 0);
+
+    ASSERT_EQ(static_cast<kvssd_file::File_KVSSD &>(*kvssd).Compact(),
+              kvssd::kvs_result::KVS_SUCCESS);
+    for (size_t i = 0; i < 100; i += 2) {
+        kvssd_hashmap::DeleteRow(*kvssd, key[i]);
+    }
+    kvssd.reset(open(false));
+    for (size_t i = 1; i < 100; i += 2) {
+        kvssd_hashmap::ReadRow(*kvssd, key[i], output_value);
+        EXPECT_FALSE(FieldVectorCmp(value[(i + 1) % 100], output_value));
+    }
+    EXPECT_THROW(kvssd_hashmap::ReadRow(*kvssd, key[0], output_value), ycsbc::utils::Exception);
+}
+
+class KvssdIoEngineTest : public KvssdFileDbImplTest {
+   protected:
+    void SetUp() override {}
+
+    // Opens the log with the engine under test, or returns false if this
+    // machine cannot run it.
+    bool Start(const std::string &engine, bool direct) {
+        io_engine = engine;
+        direct_io = direct;
+        try {
+            kvssd.reset(Open(true));
+        } catch (const ycsbc::utils::Exception &e) {
+            std::cerr << e.what() << std::endl;
+            return false;
+        }
+        return true;
+    }
+    void Run() {
+        RunIoEngineRoundTrip(kvssd, [this](bool destroy) { return Open(destroy); });
+    }
+};
+
+TEST_F(KvssdIoEngineTest, Psync) {
+    ASSERT_TRUE(Start("psync", false));
+    Run();
+}
+
+TEST_F(KvssdIoEngineTest, IoUring) {
+    if (!Start("io_uring", false)) {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+    Run();
+}
+
+// Skipped where the filesystem rejects O_DIRECT, e.g. tmpfs.
+TEST_F(KvssdIoEngineTest, DirectIo) {
+    for (const char *engine : {"psync", "io_uring"}) {
+        if (!Start(engine, true)) {
+            GTEST_SKIP() << "direct " << engine << " is not available";
+        }
+        Run();
+    }
+}
+
+TEST_F(KvssdIoEngineTest, UnknownEngine) {
+    EXPECT_FALSE(Start("aio", false));
+}
+
+}  // anonymous namespace
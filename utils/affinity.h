@@ -0,0 +1,192 @@
+//
+//  affinity.h
+//  YCSB-cpp
+//
+
+#ifndef YCSB_C_AFFINITY_H_
+#define YCSB_C_AFFINITY_H_
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "utils.h"
+
+namespace ycsbc {
+
+namespace utils {
+
+// Where a thread's memory comes from: wherever the kernel's default policy
+// puts it, preferably its own node (falling back to others when that node is
+// full), or only its own node
+enum class NumaPolicy {
+  NONE,
+  LOCAL,
+  BIND
+};
+
+// CPUs a thread may run on, any if empty, and the NUMA policy of its memory
+struct Placement {
+  std::vector<int> cpus;
+  NumaPolicy numa = NumaPolicy::NONE;
+};
+
+// Parses a CPU list such as "0-3,8,10-11"; an empty list is empty
+inline std::vector<int> ParseCpuList(const std::string &list) {
+  std::vector<int> cpus;
+  std::istringstream stream(list);
+  std::string range;
+  while (std::getline(stream, range, ',')) {
+    std::string item = Trim(range);
+    if (item.empty()) {
+      continue;
+    }
+    size_t dash = item.find('-');
+    int first, last;
+    try {
+      first = std::stoi(item.substr(0, dash));
+      last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+    } catch (const std::logic_error &) {
+      throw Exception("invalid cpu list: " + list);
+    }
+    if (first < 0 || last < first) {
+      throw Exception("invalid cpu list: " + list);
+    }
+    for (int cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+inline NumaPolicy ParseNumaPolicy(const std::string &policy) {
+  if (policy == "none") {
+    return NumaPolicy::NONE;
+  } else if (policy == "local") {
+    return NumaPolicy::LOCAL;
+  } else if (policy == "bind") {
+    return NumaPolicy::BIND;
+  }
+  throw Exception("invalid numa policy: " + policy);
+}
+
+// NUMA node of cpu, or -1 if unknown
+inline int CpuNode(int cpu) {
+#ifdef __linux__
+  std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+  DIR *dir = opendir(path.c_str());
+  if (dir == nullptr) {
+    return -1;
+  }
+  int node = -1;
+  while (dirent *entry = readdir(dir)) {
+    if (std::string(entry->d_name).rfind("node", 0) == 0) {
+      node = std::atoi(entry->d_name + 4);
+      break;
+    }
+  }
+  closedir(dir);
+  return node;
+#else
+  return -1;
+#endif
+}
+
+// Describes placement as "cpus 0-1,3 (node 0), numa local"
+inline std::string PlacementString(const Placement &placement) {
+  if (placement.cpus.empty()) {
+    return "any cpu";
+  }
+  std::string cpus;
+  std::string nodes;
+  std::vector<int> seen_nodes;
+  for (size_t i = 0; i < placement.cpus.size(); i++) {
+    size_t j = i;
+    while (j + 1 < placement.cpus.size() && placement.cpus[j + 1] == placement.cpus[j] + 1) {
+      j++;
+    }
+    cpus += (cpus.empty() ? "" : ",") + std::to_string(placement.cpus[i]);
+    if (j > i) {
+      cpus += "-" + std::to_string(placement.cpus[j]);
+    }
+    for (size_t k = i; k <= j; k++) {
+      int node = CpuNode(placement.cpus[k]);
+      if (std::find(seen_nodes.begin(), seen_nodes.end(), node) == seen_nodes.end()) {
+        seen_nodes.push_back(node);
+        nodes += (nodes.empty() ? "" : ",") + (node < 0 ? std::string("?") : std::to_string(node));
+      }
+    }
+    i = j;
+  }
+  std::string msg = (placement.cpus.size() == 1 ? "cpu " : "cpus ") + cpus +
+                    (seen_nodes.size() == 1 ? " (node " : " (nodes ") + nodes + ")";
+  if (placement.numa == NumaPolicy::LOCAL) {
+    msg += ", numa local";
+  } else if (placement.numa == NumaPolicy::BIND) {
+    msg += ", numa bind";
+  }
+  return msg;
+}
+
+// Moves the calling thread to its placement; memory it allocates from then
+// on follows the NUMA policy
+inline void ApplyPlacement(const Placement &placement) {
+  if (placement.cpus.empty()) {
+    return;
+  }
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : placement.cpus) {
+    if (cpu >= CPU_SETSIZE) {
+      throw Exception("cpu out of range: " + std::to_string(cpu));
+    }
+    CPU_SET(cpu, &set);
+  }
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    throw Exception("failed to pin thread to " + PlacementString(placement));
+  }
+
+  // MPOL_* of <linux/mempolicy.h>, to go without libnuma
+  constexpr int MPOL_BIND_MODE = 2;
+  constexpr int MPOL_LOCAL_MODE = 4;
+  constexpr size_t MAX_NODES = 1024;
+  constexpr size_t WORD_BITS = 8 * sizeof(unsigned long);
+  long ret = 0;
+  if (placement.numa == NumaPolicy::LOCAL) {
+    ret = syscall(SYS_set_mempolicy, MPOL_LOCAL_MODE, nullptr, 0);
+  } else if (placement.numa == NumaPolicy::BIND) {
+    unsigned long nodes[MAX_NODES / WORD_BITS] = {};
+    for (int cpu : placement.cpus) {
+      int node = CpuNode(cpu);
+      if (node < 0 || static_cast<size_t>(node) >= MAX_NODES) {
+        throw Exception("unknown numa node of cpu " + std::to_string(cpu));
+      }
+      nodes[node / WORD_BITS] |= 1ul << (node % WORD_BITS);
+    }
+    ret = syscall(SYS_set_mempolicy, MPOL_BIND_MODE, nodes, MAX_NODES);
+  }
+  if (ret != 0) {
+    throw Exception("failed to set numa policy for " + PlacementString(placement));
+  }
+#else
+  throw Exception("thread pinning is only supported on linux");
+#endif
+}
+
+} // utils
+
+} // ycsbc
+
+#endif // YCSB_C_AFFINITY_H_
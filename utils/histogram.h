@@ -0,0 +1,176 @@
+//
+//  histogram.h
+//  YCSB-cpp
+//
+
+#ifndef YCSB_C_HISTOGRAM_H_
+#define YCSB_C_HISTOGRAM_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ycsbc {
+
+namespace utils {
+
+// Log-linear buckets of latencies in nanoseconds: one per value below 128,
+// then 64 per power of two, so that a bucket's midpoint is within 1% of any
+// value in it
+class HistogramBuckets {
+ public:
+  static constexpr int kSubBucketBits = 7;
+  static constexpr int kHalf = 1 << (kSubBucketBits - 1);
+  static constexpr int kCount = (64 - kSubBucketBits + 1) * kHalf + kHalf;
+
+  static int Index(uint64_t value) {
+    if (value < 2 * kHalf) {
+      return static_cast<int>(value);
+    }
+    int shift = HighestBit(value) - (kSubBucketBits - 1);
+    return shift * kHalf + static_cast<int>(value >> shift);
+  }
+
+  // Midpoint of the values in bucket index
+  static uint64_t Value(int index) {
+    if (index < 2 * kHalf) {
+      return index;
+    }
+    int shift = index / kHalf - 1;
+    uint64_t low = static_cast<uint64_t>(index - shift * kHalf) << shift;
+    return low + ((uint64_t{1} << shift) >> 1);
+  }
+
+ private:
+  static int HighestBit(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+  }
+};
+
+// Bucket counts for reading: merged from recorders, differenced between
+// snapshots, and queried for percentiles
+class Histogram {
+ public:
+  void Add(int index, uint64_t n) {
+    if (counts_.empty()) {
+      counts_.resize(HistogramBuckets::kCount);
+    }
+    counts_[index] += n;
+    total_ += n;
+  }
+
+  void Add(const Histogram &other) {
+    for (size_t i = 0; i < other.counts_.size(); i++) {
+      if (other.counts_[i] != 0) {
+        Add(i, other.counts_[i]);
+      }
+    }
+  }
+
+  // Removes the values of other, which must be a subset of this one's
+  void Subtract(const Histogram &other) {
+    for (size_t i = 0; i < other.counts_.size(); i++) {
+      counts_[i] -= other.counts_[i];
+      total_ -= other.counts_[i];
+    }
+  }
+
+  void Reset() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    total_ = 0;
+  }
+
+  uint64_t Count() const {
+    return total_;
+  }
+
+  // Smallest bucket value with at least percentile % of the values at or
+  // below it; 0 if empty
+  uint64_t ValueAtPercentile(double percentile) const {
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(percentile / 100 * total_ + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); i++) {
+      seen += counts_[i];
+      if (seen >= rank) {
+        return HistogramBuckets::Value(i);
+      }
+    }
+    return 0;
+  }
+
+  // Calls f(value, count) on every bucket with values, in ascending order
+  template <typename F>
+  void ForEach(F f) const {
+    for (size_t i = 0; i < counts_.size(); i++) {
+      if (counts_[i] != 0) {
+        f(HistogramBuckets::Value(i), counts_[i]);
+      }
+    }
+  }
+
+  uint64_t Min() const {
+    return ValueAtPercentile(0);
+  }
+
+  uint64_t Max() const {
+    for (size_t i = counts_.size(); i > 0; i--) {
+      if (counts_[i - 1] != 0) {
+        return HistogramBuckets::Value(i - 1);
+      }
+    }
+    return 0;
+  }
+
+ private:
+  std::vector<uint64_t> counts_;  // empty until the first value
+  uint64_t total_ = 0;
+};
+
+// Recording side of a histogram: written by one thread only, so without
+// read-modify-writes, and read by any
+class HistogramRecorder {
+ public:
+  HistogramRecorder() {
+    Reset();
+  }
+
+  void Record(uint64_t value) {
+    std::atomic<uint64_t> &count = counts_[HistogramBuckets::Index(value)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  void AddTo(Histogram &histogram) const {
+    for (int i = 0; i < HistogramBuckets::kCount; i++) {
+      uint64_t n = counts_[i].load(std::memory_order_relaxed);
+      if (n != 0) {
+        histogram.Add(i, n);
+      }
+    }
+  }
+
+  void Reset() {
+    for (std::atomic<uint64_t> &count : counts_) {
+      count.store(0, std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  std::atomic<uint64_t> counts_[HistogramBuckets::kCount];
+};
+
+} // utils
+
+} // ycsbc
+
+#endif // YCSB_C_HISTOGRAM_H_
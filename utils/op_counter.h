@@ -0,0 +1,57 @@
+//
+//  op_counter.h
+//  YCSB-cpp
+//
+
+#ifndef YCSB_C_OP_COUNTER_H_
+#define YCSB_C_OP_COUNTER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace ycsbc {
+
+namespace utils {
+
+// Operations of a phase shared by all its client threads: each thread claims
+// one at a time, so that faster threads do more of them, until the count is
+// used up or the deadline passes
+class OpCounter {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // total operations, no deadline if max_seconds <= 0; the deadline counts
+  // from construction until Start
+  OpCounter(int64_t total, double max_seconds)
+      : total_(total), claimed_(0), has_deadline_(max_seconds > 0),
+        max_duration_(std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(max_seconds))),
+        deadline_(Clock::now() + max_duration_) {}
+
+  // Starts the deadline over from now; not while operations are being claimed
+  inline void Start() {
+    deadline_ = Clock::now() + max_duration_;
+  }
+
+  // Returns whether the caller should run one more operation
+  inline bool Claim() {
+    if (has_deadline_ && Clock::now() >= deadline_) {
+      return false;
+    }
+    return claimed_.fetch_add(1, std::memory_order_relaxed) < total_;
+  }
+
+ private:
+  const int64_t total_;
+  std::atomic<int64_t> claimed_;
+  const bool has_deadline_;
+  const Clock::duration max_duration_;
+  Clock::time_point deadline_;
+};
+
+} // utils
+
+} // ycsbc
+
+#endif // YCSB_C_OP_COUNTER_H_
@@ -0,0 +1,91 @@
+//
+//  open_loop.h
+//  YCSB-cpp
+//
+
+#ifndef YCSB_C_OPEN_LOOP_H_
+#define YCSB_C_OPEN_LOOP_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace ycsbc {
+
+namespace utils {
+
+// Open-loop arrival schedule for single client: the intended start of each
+// operation follows from the arrival rate alone, not from when the previous
+// operation completed, so a stalled DB leaves the client behind schedule
+// instead of slowing it down
+class OpenLoopScheduler {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // r arrivals per second, evenly spaced or as a Poisson process
+  OpenLoopScheduler(int64_t r, bool poisson, uint64_t seed)
+      : r_(r), poisson_(poisson), rng_(seed), gap_(1.0), next_(Clock::now()) {}
+
+  // Returns the intended start of the next operation, which is in the past
+  // when the client is behind, and advances the schedule
+  inline Clock::time_point Next() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (r_ <= 0) {
+      next_ = Clock::now();
+      return next_;
+    }
+
+    Clock::time_point intended = next_;
+    double gap = (poisson_ ? gap_(rng_) : 1.0) / r_;
+    next_ += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(gap));
+    return intended;
+  }
+
+  // Waits until t: sleeps until shortly before it and spins the rest, since
+  // sleep_until overshoots by the timer slack and the wake-up latency, which
+  // would count as the response time of the operation due at t
+  static void WaitUntil(Clock::time_point t) {
+    constexpr auto kSpin = std::chrono::microseconds(100);
+    if (t - Clock::now() > kSpin) {
+      std::this_thread::sleep_until(t - kSpin);
+    }
+    while (Clock::now() < t) {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#endif
+    }
+  }
+
+  // Starts the schedule over from now, dropping any backlog
+  inline void Restart() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    next_ = Clock::now();
+  }
+
+  inline void SetRate(int64_t r) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // an unlimited schedule has no backlog to keep
+    if (r_ <= 0) {
+      next_ = Clock::now();
+    }
+    r_ = r;
+  }
+
+ private:
+  std::mutex mutex_;
+  int64_t r_;
+  bool poisson_;
+  std::mt19937_64 rng_;
+  std::exponential_distribution<double> gap_;
+  Clock::time_point next_;
+};
+
+} // utils
+
+} // ycsbc
+
+#endif // YCSB_C_OPEN_LOOP_H_
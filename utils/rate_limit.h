@@ -25,27 +25,30 @@ class RateLimiter {
   RateLimiter(int64_t r, int64_t b) : r_(r * TOKEN_PRECISION), b_(b * TOKEN_PRECISION), tokens_(0), last_(Clock::now()) {}
 
   inline void Consume(int64_t n) {
-    std::unique_lock<std::mutex> lock(mutex_);
+    std::this_thread::sleep_until(Reserve(n));
+  }
+
+  // Takes n tokens without waiting for them and returns when they are due
+  inline std::chrono::steady_clock::time_point Reserve(int64_t n) {
+    std::lock_guard<std::mutex> lock(mutex_);
 
+    auto now = Clock::now();
     if (r_ <= 0) {
-      return;
+      return now;
     }
 
     // refill tokens
-    auto now = Clock::now();
     auto diff = std::chrono::duration_cast<Duration>(now - last_);
     tokens_ = std::min(b_, tokens_ + diff.count() * r_ / 1000000000);
     last_ = now;
 
     // check tokens
     tokens_ -= n * TOKEN_PRECISION;
-
-    // sleep
-    if (tokens_ < 0) {
-      lock.unlock();
-      int64_t wait_time = -tokens_ * 1000000000 / r_;
-      std::this_thread::sleep_for(std::chrono::nanoseconds(wait_time));
+    if (tokens_ >= 0) {
+      return now;
     }
+    int64_t wait_time = -tokens_ * 1000000000 / r_;
+    return now + std::chrono::nanoseconds(wait_time);
   }
 
   inline void SetRate(int64_t r) {
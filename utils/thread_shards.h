@@ -0,0 +1,95 @@
+//
+//  thread_shards.h
+//  YCSB-cpp
+//
+
+#ifndef YCSB_C_THREAD_SHARDS_H_
+#define YCSB_C_THREAD_SHARDS_H_
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ycsbc {
+
+namespace utils {
+
+// One T per thread, so that threads can record without writing to shared
+// cache lines: each thread writes to its own shard only, and readers visit
+// all shards while the threads keep writing, so T must be safe for that (for
+// instance atomics that only their owner updates). A thread's shard outlives
+// it and passes to the next thread that asks, data included, so that threads
+// of successive phases reuse rather than add shards.
+template <typename T>
+class ThreadShards {
+ public:
+  ThreadShards() : state_(std::make_shared<State>()) {}
+
+  // The calling thread's shard
+  T &Local() {
+    thread_local Handle handle;
+    if (handle.state_id != state_.get()) {
+      handle.Release();
+      handle.Acquire(state_);
+    }
+    return *handle.shard;
+  }
+
+  // Calls f on every shard, including those of exited threads
+  template <typename F>
+  void ForEach(F f) {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    for (auto &shard : state_->shards) {
+      f(*shard);
+    }
+  }
+
+ private:
+  struct State {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<T>> shards;
+    std::vector<T *> free;  // of exited threads
+  };
+
+  // A thread's hold on its shard, given back when the thread exits. The weak
+  // reference keeps the State's storage, so that no later State reuses the
+  // address in state_id.
+  struct Handle {
+    std::weak_ptr<State> state;
+    const State *state_id = nullptr;
+    T *shard = nullptr;
+
+    void Acquire(const std::shared_ptr<State> &s) {
+      std::lock_guard<std::mutex> lock(s->mutex);
+      if (s->free.empty()) {
+        s->shards.emplace_back(new T());
+        shard = s->shards.back().get();
+      } else {
+        shard = s->free.back();
+        s->free.pop_back();
+      }
+      state = s;
+      state_id = s.get();
+    }
+    void Release() {
+      if (std::shared_ptr<State> s = state.lock()) {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        s->free.push_back(shard);
+      }
+      state.reset();
+      state_id = nullptr;
+      shard = nullptr;
+    }
+    ~Handle() {
+      Release();
+    }
+  };
+
+  std::shared_ptr<State> state_;
+};
+
+} // utils
+
+} // ycsbc
+
+#endif // YCSB_C_THREAD_SHARDS_H_
@@ -10,6 +10,9 @@
 #define YCSB_C_TIMER_H_
 
 #include <chrono>
+#include <cstdint>
+
+#include "tsc.h"
 
 namespace ycsbc {
 
@@ -36,6 +39,34 @@ class Timer {
   Clock::time_point time_;
 };
 
+// Nanosecond timer of operation latencies, on the invariant TSC if tsc (see
+// Tsc::Available), otherwise on steady_clock
+class LatencyTimer {
+ public:
+  explicit LatencyTimer(bool tsc) : ns_per_tick_(tsc ? 1 / Tsc::TicksPerNs() : 0) {}
+
+  void Start() {
+    if (ns_per_tick_ > 0) {
+      ticks_ = Tsc::Start();
+    } else {
+      time_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  uint64_t End() {
+    if (ns_per_tick_ > 0) {
+      return static_cast<uint64_t>((Tsc::End() - ticks_) * ns_per_tick_);
+    }
+    auto span = std::chrono::steady_clock::now() - time_;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(span).count();
+  }
+
+ private:
+  double ns_per_tick_;  // 0 for steady_clock
+  uint64_t ticks_ = 0;
+  std::chrono::steady_clock::time_point time_;
+};
+
 } // utils
 
 } // ycsbc
@@ -0,0 +1,129 @@
+//
+//  tsc.h
+//  YCSB-cpp
+//
+
+#ifndef YCSB_C_TSC_H_
+#define YCSB_C_TSC_H_
+
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define YCSB_C_HAVE_TSC
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace ycsbc {
+
+namespace utils {
+
+// Time stamp counter of x86-64 CPUs. Where it is invariant, it ticks at a
+// constant rate whatever the core's frequency or power state, and reading it
+// costs a fraction of a clock_gettime call.
+class Tsc {
+ public:
+  // Whether the CPU has an invariant TSC (CPUID 0x80000007, EDX bit 8)
+  static bool Available() {
+#if defined(YCSB_C_HAVE_TSC) && defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0x80000000);
+    if (static_cast<unsigned>(regs[0]) < 0x80000007u) {
+      return false;
+    }
+    __cpuid(regs, 0x80000007);
+    return (regs[3] >> 8) & 1;
+#elif defined(YCSB_C_HAVE_TSC)
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+      return false;
+    }
+    return (edx >> 8) & 1;
+#else
+    return false;
+#endif
+  }
+
+  // Reading at the start of an interval: not before earlier instructions
+  // have completed
+  static uint64_t Start() {
+#ifdef YCSB_C_HAVE_TSC
+    _mm_lfence();
+    return __rdtsc();
+#else
+    return 0;
+#endif
+  }
+
+  // Reading at the end of an interval: not before earlier instructions have
+  // completed, nor after later ones have started
+  static uint64_t End() {
+#ifdef YCSB_C_HAVE_TSC
+    unsigned aux;
+    uint64_t ticks = __rdtscp(&aux);
+    _mm_lfence();
+    return ticks;
+#else
+    return 0;
+#endif
+  }
+
+  // Ticks per nanosecond, measured against steady_clock on the first call
+  static double TicksPerNs() {
+    static const double ticks_per_ns = Calibrate(std::chrono::milliseconds(50));
+    return ticks_per_ns;
+  }
+
+  // Describes the rate, the error of a second calibration against it and the
+  // cost of a reading, next to that of steady_clock
+  static std::string SelfTest() {
+    double ticks_per_ns = TicksPerNs();
+    double error = Calibrate(std::chrono::milliseconds(10)) / ticks_per_ns - 1;
+
+    constexpr int kReads = 1 << 16;
+    // neither reading is one that the compiler may leave out
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < kReads; i++) {
+      Start();
+      End();
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (int i = 0; i < kReads; i++) {
+      std::chrono::steady_clock::now();
+    }
+    auto end = std::chrono::steady_clock::now();
+    double tsc_ns = std::chrono::duration<double, std::nano>(middle - begin).count() / kReads / 2;
+    double steady_ns = std::chrono::duration<double, std::nano>(end - middle).count() / kReads;
+
+    std::ostringstream msg;
+    msg.precision(3);
+    msg << std::fixed << ticks_per_ns << " GHz, " << error * 100 << "% off on recalibration, "
+        << tsc_ns << " ns per reading (steady_clock " << steady_ns << " ns)";
+    return msg.str();
+  }
+
+ private:
+  static double Calibrate(std::chrono::steady_clock::duration span) {
+    auto begin = std::chrono::steady_clock::now();
+    uint64_t begin_ticks = Start();
+    auto end = begin;
+    while (end - begin < span) {
+      end = std::chrono::steady_clock::now();
+    }
+    uint64_t end_ticks = End();
+    return (end_ticks - begin_ticks) / std::chrono::duration<double, std::nano>(end - begin).count();
+  }
+};
+
+} // utils
+
+} // ycsbc
+
+#endif // YCSB_C_TSC_H_